@@ -299,6 +299,7 @@ glitz_agl_context_get (glitz_agl_thread_info_t *thread_info,
     context->backend.destroy = glitz_agl_destroy;
     context->backend.push_current = glitz_agl_push_current;
     context->backend.pop_current = glitz_agl_pop_current;
+    context->backend.release_current = NULL;
     context->backend.attach_notify = _glitz_agl_notify_dummy;
     context->backend.detach_notify = _glitz_agl_notify_dummy;
     context->backend.swap_buffers = glitz_agl_swap_buffers;
@@ -335,6 +336,9 @@ glitz_agl_context_get (glitz_agl_thread_info_t *thread_info,
     context->backend.n_formats = 0;
 
     context->backend.program_map = &thread_info->program_map;
+
+    context->backend.texture_memory = &thread_info->texture_memory;
+    context->backend.damage_policy = &thread_info->damage_policy;
     context->backend.feature_mask = 0;
 
     context->initialized = 0;
@@ -43,6 +43,7 @@ glitz_gl_proc_address_list_t _glitz_agl_gl_proc_address = {
     (glitz_gl_vertex_pointer_t) glVertexPointer,
     (glitz_gl_tex_coord_pointer_t) glTexCoordPointer,
     (glitz_gl_draw_arrays_t) glDrawArrays,
+    (glitz_gl_draw_elements_t) glDrawElements,
     (glitz_gl_tex_env_f_t) glTexEnvf,
     (glitz_gl_tex_env_fv_t) glTexEnvfv,
     (glitz_gl_tex_gen_i_t) glTexGeni,
@@ -56,6 +57,8 @@ glitz_gl_proc_address_list_t _glitz_agl_gl_proc_address = {
     (glitz_gl_clear_stencil_t) glClearStencil,
     (glitz_gl_stencil_func_t) glStencilFunc,
     (glitz_gl_stencil_op_t) glStencilOp,
+    (glitz_gl_cull_face_t) glCullFace,
+    (glitz_gl_alpha_func_t) glAlphaFunc,
     (glitz_gl_push_attrib_t) glPushAttrib,
     (glitz_gl_pop_attrib_t) glPopAttrib,
     (glitz_gl_matrix_mode_t) glMatrixMode,
@@ -123,7 +126,20 @@ glitz_gl_proc_address_list_t _glitz_agl_gl_proc_address = {
     (glitz_gl_delete_renderbuffers_t) 0,
     (glitz_gl_bind_renderbuffer_t) 0,
     (glitz_gl_renderbuffer_storage_t) 0,
-    (glitz_gl_get_renderbuffer_parameter_iv_t) 0
+    (glitz_gl_get_renderbuffer_parameter_iv_t) 0,
+    (glitz_gl_tex_storage_2d_t) 0,
+    (glitz_gl_clear_tex_sub_image_t) 0,
+    (glitz_gl_renderbuffer_storage_multisample_t) 0,
+    (glitz_gl_blit_framebuffer_t) 0,
+    (glitz_gl_multi_draw_elements_t) 0,
+    (glitz_gl_primitive_restart_index_t) 0,
+    (glitz_gl_map_buffer_range_t) 0,
+    (glitz_gl_flush_mapped_buffer_range_t) 0,
+    (glitz_gl_buffer_storage_t) 0,
+    (glitz_gl_fence_sync_t) 0,
+    (glitz_gl_delete_sync_t) 0,
+    (glitz_gl_client_wait_sync_t) 0,
+    (glitz_gl_wait_sync_t) 0
 };
 
 static void
@@ -242,6 +258,11 @@ glitz_agl_thread_info_init (glitz_agl_thread_info_t *thread_info)
 
     glitz_program_map_init (&thread_info->program_map);
 
+    glitz_texture_memory_init (&thread_info->texture_memory);
+
+    glitz_damage_policy_init (&thread_info->damage_policy,
+			      GLITZ_DAMAGE_CALL_COST_DEFAULT);
+
     if (!glitz_agl_query_extensions (thread_info))
 	glitz_agl_query_formats (thread_info);
 }
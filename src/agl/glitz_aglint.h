@@ -71,6 +71,8 @@ typedef struct _glitz_agl_thread_info_t {
     unsigned long               agl_feature_mask;
     glitz_context_t             *cctx;
     glitz_program_map_t         program_map;
+    glitz_texture_memory_t      texture_memory;
+    glitz_damage_policy_t       damage_policy;
 } glitz_agl_thread_info_t;
 
 struct _glitz_agl_drawable {
@@ -27,10 +27,17 @@
 #define GLITZ_EGL_H_INCLUDED
 
 #include <GL/gl.h>
-#include <GLES/egl.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
 
 #include <glitz.h>
 
+/* screens only select per screen state in glitz. current EGL headers
+   no longer have them and screen 0 is used with any display there. */
+#ifndef EGL_MESA_screen_surface
+typedef EGLint EGLScreenMESA;
+#endif
+
 #if defined(__cplusplus) || defined(c_plusplus)
 extern "C" {
 #endif
@@ -43,6 +50,9 @@ glitz_egl_init (const char *gl_library);
 void
 glitz_egl_fini (void);
 
+EGLDisplay
+glitz_egl_get_headless_display (void);
+
 
 /* glitz_egl_config.c */
 
@@ -60,6 +70,12 @@ glitz_egl_find_pbuffer_config (EGLDisplay                    egl_display,
 			       const glitz_drawable_format_t *templ,
 			       int                           count);
 
+glitz_drawable_format_t *
+glitz_egl_find_headless_config (EGLDisplay                    egl_display,
+				unsigned long                 mask,
+				const glitz_drawable_format_t *templ,
+				int                           count);
+
 
 /* glitz_egl_surface.c */
 
@@ -78,6 +94,16 @@ glitz_egl_create_pbuffer_surface (EGLDisplay               egl_display,
 				  unsigned int            width,
 				  unsigned int            height);
 
+glitz_drawable_t *
+glitz_egl_create_headless_surface (EGLDisplay              egl_display,
+				   glitz_drawable_format_t *format);
+
+
+/* glitz_egl_context.c */
+
+unsigned long
+glitz_egl_get_make_current_count (void);
+
 
 #if defined(__cplusplus) || defined(c_plusplus)
 }
@@ -131,9 +131,20 @@ _glitz_egl_query_configs (glitz_egl_screen_info_t *screen_info)
     {
 	int value;
 
+#ifdef EGL_OPENGL_BIT
+	eglGetConfigAttrib (egl_display, egl_configs[i], EGL_RENDERABLE_TYPE,
+			    &value);
+	if (!(value & EGL_OPENGL_BIT))
+	    continue;
+#endif
+
+	/* configs without surfaces are only of use with surfaceless
+	   contexts */
 	eglGetConfigAttrib (egl_display, egl_configs[i], EGL_SURFACE_TYPE,
 			    &value);
-	if (!((value & EGL_WINDOW_BIT) || (value & EGL_PBUFFER_BIT)))
+	if (!((value & EGL_WINDOW_BIT) || (value & EGL_PBUFFER_BIT)) &&
+	    !(screen_info->egl_feature_mask &
+	      GLITZ_EGL_FEATURE_SURFACELESS_CONTEXT_MASK))
 	    continue;
 
 	format.types = 0;
@@ -245,3 +256,27 @@ glitz_egl_find_pbuffer_config (EGLDisplay                    egl_display,
 				       mask, &itempl, count);
 }
 slim_hidden_def(glitz_egl_find_pbuffer_config);
+
+/* any config that can be used with a surfaceless context, see
+   glitz_egl_create_headless_surface */
+glitz_drawable_format_t *
+glitz_egl_find_headless_config (EGLDisplay                    egl_display,
+				unsigned long                 mask,
+				const glitz_drawable_format_t *templ,
+				int                           count)
+{
+    glitz_int_drawable_format_t itempl;
+    glitz_egl_screen_info_t *screen_info =
+	glitz_egl_screen_info_get (egl_display, 0);
+
+    if (!(screen_info->egl_feature_mask &
+	  GLITZ_EGL_FEATURE_SURFACELESS_CONTEXT_MASK))
+	return NULL;
+
+    glitz_drawable_format_copy (templ, &itempl.d, mask);
+
+    return glitz_drawable_format_find (screen_info->formats,
+				       screen_info->n_formats,
+				       mask, &itempl, count);
+}
+slim_hidden_def(glitz_egl_find_headless_config);
@@ -35,14 +35,33 @@ extern glitz_gl_proc_address_list_t _glitz_egl_gl_proc_address;
 
 static void
 _glitz_egl_context_create (glitz_egl_screen_info_t *screen_info,
-			   EGLConfig               egl_config,
+			   EGLint                  egl_config_id,
 			   EGLContext              egl_share_list,
 			   glitz_egl_context_t     *context)
 {
-    context->id = egl_config;
+    EGLDisplay egl_display = screen_info->display_info->egl_display;
+    EGLint     attributes[3];
+    EGLint     n_configs = 0;
+
+    attributes[0] = EGL_CONFIG_ID;
+    attributes[1] = egl_config_id;
+    attributes[2] = EGL_NONE;
+
+    context->id = egl_config_id;
+    context->egl_config = (EGLConfig) 0;
+    context->egl_context = EGL_NO_CONTEXT;
+
+    if (!eglChooseConfig (egl_display, attributes, &context->egl_config, 1,
+			  &n_configs) || !n_configs)
+	return;
+
+#ifdef EGL_OPENGL_API
+    eglBindAPI (EGL_OPENGL_API);
+#endif
+
     context->egl_context =
-	eglCreateContext (screen_info->display_info->egl_display,
-			  egl_config, egl_share_list, NULL);
+	eglCreateContext (egl_display, context->egl_config, egl_share_list,
+			  NULL);
 }
 
 static glitz_context_t *
@@ -51,9 +70,13 @@ _glitz_egl_create_context (void                    *abstract_drawable,
 {
     glitz_egl_surface_t *drawable = (glitz_egl_surface_t *) abstract_drawable;
     glitz_egl_screen_info_t *screen_info = drawable->screen_info;
-    int format_id = screen_info->formats[format->id].u.uval;
+    EGLint format_id = drawable->context->id;
     glitz_egl_context_t *context;
 
+    /* formats past the screen formats are framebuffer object formats */
+    if (format->id < screen_info->n_formats)
+	format_id = screen_info->formats[format->id].u.uval;
+
     context = malloc (sizeof (glitz_egl_context_t));
     if (!context)
 	return NULL;
@@ -74,14 +97,16 @@ _glitz_egl_context_destroy (void *abstract_context)
     glitz_egl_context_t *context = (glitz_egl_context_t *) abstract_context;
     glitz_egl_surface_t *drawable = (glitz_egl_surface_t *)
 	context->base.drawable;
+    glitz_egl_thread_info_t *thread_info = glitz_egl_thread_info_get ();
 
-    if (drawable->screen_info->display_info->thread_info->cctx ==
+    if (thread_info->cctx ==
 	&context->base)
     {
-	eglMakeCurrent (drawable->screen_info->display_info->egl_display,
-			EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	glitz_egl_set_current (thread_info,
+			       drawable->screen_info->display_info->egl_display,
+			       EGL_NO_SURFACE, EGL_NO_CONTEXT);
 
-	drawable->screen_info->display_info->thread_info->cctx = NULL;
+	thread_info->cctx = NULL;
     }
 
     eglDestroyContext (drawable->screen_info->display_info->egl_display,
@@ -97,6 +122,8 @@ _glitz_egl_copy_context (void          *abstract_src,
 			 void          *abstract_dst,
 			 unsigned long mask)
 {
+/* context copying went away with the MESA screen extensions */
+#ifdef EGL_MESA_copy_context
     glitz_egl_context_t  *src = (glitz_egl_context_t *) abstract_src;
     glitz_egl_context_t  *dst = (glitz_egl_context_t *) abstract_dst;
     glitz_egl_surface_t *drawable = (glitz_egl_surface_t *)
@@ -104,6 +131,7 @@ _glitz_egl_copy_context (void          *abstract_src,
 
     eglCopyContextMESA (drawable->screen_info->display_info->egl_display,
 			src->egl_context, dst->egl_context, mask);
+#endif
 }
 
 static void
@@ -114,6 +142,7 @@ _glitz_egl_make_current (void *abstract_drawable,
     glitz_egl_surface_t *drawable = (glitz_egl_surface_t *) abstract_drawable;
     glitz_egl_display_info_t *display_info =
 	drawable->screen_info->display_info;
+    glitz_egl_thread_info_t *thread_info = glitz_egl_thread_info_get ();
 
     if (drawable->base.width  != drawable->width ||
 	drawable->base.height != drawable->height)
@@ -121,22 +150,22 @@ _glitz_egl_make_current (void *abstract_drawable,
 					 drawable->base.width,
 					 drawable->base.height);
 
-    if ((eglGetCurrentContext () != context->egl_context) ||
-	(eglGetCurrentSurface ( EGL_READ ) != drawable->egl_surface))
+    if ((thread_info->current_context != context->egl_context) ||
+	(thread_info->current_surface != drawable->egl_surface))
     {
-	if (display_info->thread_info->cctx)
+	if (thread_info->cctx)
 	{
-	    glitz_context_t *ctx = display_info->thread_info->cctx;
+	    glitz_context_t *ctx = thread_info->cctx;
 
 	    if (ctx->lose_current)
 		ctx->lose_current (ctx->closure);
 	}
 
-	eglMakeCurrent (display_info->egl_display, drawable->egl_surface,
-			drawable->egl_surface, context->egl_context);
+	glitz_egl_set_current (thread_info, display_info->egl_display,
+			       drawable->egl_surface, context->egl_context);
     }
 
-    display_info->thread_info->cctx = &context->base;
+    thread_info->cctx = &context->base;
 }
 
 static void
@@ -186,6 +215,12 @@ glitz_egl_context_get (glitz_egl_screen_info_t *screen_info,
 			       screen_info->formats[format->id].u.uval,
 			       screen_info->egl_root_context,
 			       context);
+    if (context->egl_context == EGL_NO_CONTEXT)
+    {
+	screen_info->n_contexts--;
+	free (context);
+	return NULL;
+    }
 
     if (!screen_info->egl_root_context)
 	screen_info->egl_root_context = context->egl_context;
@@ -196,6 +231,7 @@ glitz_egl_context_get (glitz_egl_screen_info_t *screen_info,
     context->backend.destroy = glitz_egl_destroy;
     context->backend.push_current = glitz_egl_push_current;
     context->backend.pop_current = glitz_egl_pop_current;
+    context->backend.release_current = glitz_egl_release_current;
     context->backend.attach_notify = _glitz_egl_notify_dummy;
     context->backend.detach_notify = _glitz_egl_notify_dummy;
     context->backend.swap_buffers = glitz_egl_swap_buffers;
@@ -232,6 +268,9 @@ glitz_egl_context_get (glitz_egl_screen_info_t *screen_info,
     context->backend.n_formats = 0;
 
     context->backend.program_map = &screen_info->program_map;
+
+    context->backend.texture_memory = &screen_info->texture_memory;
+    context->backend.damage_policy = &screen_info->damage_policy;
     context->backend.feature_mask = 0;
 
     context->initialized = 0;
@@ -294,23 +333,24 @@ _glitz_egl_context_make_current (glitz_egl_surface_t *drawable,
 {
     glitz_egl_display_info_t *display_info =
 	drawable->screen_info->display_info;
+    glitz_egl_thread_info_t *thread_info = glitz_egl_thread_info_get ();
 
     if (finish)
 	glFinish ();
 
-    if (display_info->thread_info->cctx)
+    if (thread_info->cctx)
     {
-	glitz_context_t *ctx = display_info->thread_info->cctx;
+	glitz_context_t *ctx = thread_info->cctx;
 
 	if (ctx->lose_current)
 	    ctx->lose_current (ctx->closure);
 
-	display_info->thread_info->cctx = NULL;
+	thread_info->cctx = NULL;
     }
 
-    eglMakeCurrent (display_info->egl_display,
-		    drawable->egl_surface, drawable->egl_surface,
-		    drawable->context->egl_context);
+    glitz_egl_set_current (thread_info, display_info->egl_display,
+			   drawable->egl_surface,
+			   drawable->context->egl_context);
 
     drawable->base.update_all = 1;
 
@@ -323,6 +363,7 @@ static void
 _glitz_egl_context_update (glitz_egl_surface_t *drawable,
 			   glitz_constraint_t   constraint)
 {
+    glitz_egl_thread_info_t *thread_info = glitz_egl_thread_info_get ();
     EGLContext egl_context;
 
     drawable->base.flushed = drawable->base.finished = 0;
@@ -330,22 +371,20 @@ _glitz_egl_context_update (glitz_egl_surface_t *drawable,
     switch (constraint) {
     case GLITZ_NONE:
 	break;
-    case GLITZ_ANY_CONTEXT_CURRENT: {
-	glitz_egl_display_info_t *dinfo = drawable->screen_info->display_info;
-
-	if (dinfo->thread_info->cctx)
+    case GLITZ_ANY_CONTEXT_CURRENT:
+	if (thread_info->cctx)
 	{
 	    _glitz_egl_context_make_current (drawable, 0);
 	}
 	else
 	{
-	    egl_context = eglGetCurrentContext ();
+	    egl_context = thread_info->current_context;
 	    if (egl_context == (EGLContext) 0)
 		_glitz_egl_context_make_current (drawable, 0);
 	}
-    } break;
+	break;
     case GLITZ_CONTEXT_CURRENT:
-	egl_context = eglGetCurrentContext ();
+	egl_context = thread_info->current_context;
 	if (egl_context != drawable->context->egl_context)
 	    _glitz_egl_context_make_current (drawable, (egl_context)? 1: 0);
 	break;
@@ -356,9 +395,9 @@ _glitz_egl_context_update (glitz_egl_surface_t *drawable,
 					     drawable->base.width,
 					     drawable->base.height);
 
-	egl_context = eglGetCurrentContext ();
+	egl_context = thread_info->current_context;
 	if ((egl_context != drawable->context->egl_context) ||
-	    (eglGetCurrentSurface ( 0 ) != drawable->egl_surface))
+	    (thread_info->current_surface != drawable->egl_surface))
 	    _glitz_egl_context_make_current (drawable, (egl_context)? 1: 0);
 	break;
     }
@@ -371,15 +410,16 @@ glitz_egl_push_current (void               *abstract_drawable,
 			glitz_bool_t       *restore_state)
 {
     glitz_egl_surface_t *drawable = (glitz_egl_surface_t *) abstract_drawable;
+    glitz_egl_thread_info_t *thread_info = glitz_egl_thread_info_get ();
     glitz_egl_context_info_t *context_info;
     int index;
 
     if (restore_state)
 	*restore_state = 0;
 
-    index = drawable->screen_info->context_stack_size++;
+    index = thread_info->context_stack_size++;
 
-    context_info = &drawable->screen_info->context_stack[index];
+    context_info = &thread_info->context_stack[index];
     context_info->drawable = drawable;
     context_info->surface = surface;
     context_info->constraint = constraint;
@@ -392,14 +432,14 @@ glitz_egl_push_current (void               *abstract_drawable,
 glitz_surface_t *
 glitz_egl_pop_current (void *abstract_drawable)
 {
-    glitz_egl_surface_t *drawable = (glitz_egl_surface_t *) abstract_drawable;
+    glitz_egl_thread_info_t *thread_info = glitz_egl_thread_info_get ();
     glitz_egl_context_info_t *context_info = NULL;
     int index;
 
-    drawable->screen_info->context_stack_size--;
-    index = drawable->screen_info->context_stack_size - 1;
+    thread_info->context_stack_size--;
+    index = thread_info->context_stack_size - 1;
 
-    context_info = &drawable->screen_info->context_stack[index];
+    context_info = &thread_info->context_stack[index];
 
     if (context_info->drawable)
 	_glitz_egl_context_update (context_info->drawable,
@@ -410,3 +450,47 @@ glitz_egl_pop_current (void *abstract_drawable)
 
     return NULL;
 }
+
+void
+glitz_egl_release_current (void *abstract_drawable)
+{
+    glitz_egl_surface_t *drawable = (glitz_egl_surface_t *)
+	abstract_drawable;
+    glitz_egl_thread_info_t *thread_info = glitz_egl_thread_info_get ();
+
+    if (thread_info->current_context == drawable->context->egl_context)
+	glitz_egl_set_current (thread_info,
+			       drawable->screen_info->display_info->egl_display,
+			       EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+/* glitz keeps track of what it has made current on each thread, so code
+   that calls eglMakeCurrent on its own has to restore the previous
+   context before calling into glitz again */
+void
+glitz_egl_set_current (glitz_egl_thread_info_t *thread_info,
+		       EGLDisplay              egl_display,
+		       EGLSurface              egl_surface,
+		       EGLContext              egl_context)
+{
+    /* what is current after a failed switch isn't known, so the next
+       switch must not be skipped */
+    if (!eglMakeCurrent (egl_display, egl_surface, egl_surface, egl_context))
+    {
+	thread_info->current_context = EGL_NO_CONTEXT;
+	thread_info->current_surface = EGL_NO_SURFACE;
+	return;
+    }
+
+    thread_info->current_context = egl_context;
+    thread_info->current_surface = egl_surface;
+    thread_info->make_current_count++;
+}
+
+/* number of times glitz changed the current context on the calling
+   thread */
+unsigned long
+glitz_egl_get_make_current_count (void)
+{
+    return glitz_egl_thread_info_get ()->make_current_count;
+}
@@ -29,6 +29,22 @@
 
 #include "glitz_eglint.h"
 
+static glitz_extension_map egl_display_extensions[] = {
+  { 0.0, "EGL_KHR_surfaceless_context",
+    GLITZ_EGL_FEATURE_SURFACELESS_CONTEXT_MASK },
+  { 0.0, NULL, 0 }
+};
+
+static glitz_extension_map egl_client_extensions[] = {
+  { 0.0, "EGL_EXT_platform_base", GLITZ_EGL_CLIENT_PLATFORM_BASE_MASK },
+  { 0.0, "EGL_MESA_platform_surfaceless",
+    GLITZ_EGL_CLIENT_PLATFORM_SURFACELESS_MASK },
+  { 0.0, "EGL_EXT_platform_device", GLITZ_EGL_CLIENT_PLATFORM_DEVICE_MASK },
+  { 0.0, "EGL_EXT_device_enumeration",
+    GLITZ_EGL_CLIENT_DEVICE_ENUMERATION_MASK },
+  { 0.0, NULL, 0 }
+};
+
 #if 0
 static glitz_extension_map egl_extensions[] = {
   { 0.0, "EGL_SGIX_fbconfig", GLITZ_EGL_FEATURE_FBCONFIG_MASK },
@@ -44,6 +60,20 @@ void
 glitz_egl_query_extensions (glitz_egl_screen_info_t *screen_info,
                             glitz_gl_float_t        egl_version)
 {
+  const char *extensions_string;
+
+  /* eglGetProcAddress is core EGL and glitz only asks it for extension
+     entry points */
+  screen_info->egl_feature_mask = GLITZ_EGL_FEATURE_GET_PROC_ADDRESS_MASK;
+
+  extensions_string =
+    eglQueryString (screen_info->display_info->egl_display, EGL_EXTENSIONS);
+  if (extensions_string)
+    screen_info->egl_feature_mask |=
+      glitz_extensions_query (egl_version,
+                              extensions_string,
+                              egl_display_extensions);
+
 #if 0
   const char *egl_extensions_string;
 
@@ -72,3 +102,21 @@ glitz_egl_query_extensions (glitz_egl_screen_info_t *screen_info,
   }
 #endif
 }
+
+/* extensions of the EGL client library itself, they are known before
+   any display exists */
+unsigned long
+glitz_egl_query_client_extensions (void)
+{
+  const char *extensions_string;
+
+  extensions_string = eglQueryString (EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (!extensions_string)
+  {
+    eglGetError ();
+    return 0;
+  }
+
+  return glitz_extensions_query (0.0, extensions_string,
+                                 egl_client_extensions);
+}
@@ -30,6 +30,7 @@
 #include "glitz_eglint.h"
 
 #include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 #include <dlfcn.h>
 
@@ -45,6 +46,7 @@ glitz_gl_proc_address_list_t _glitz_egl_gl_proc_address = {
     (glitz_gl_vertex_pointer_t) glVertexPointer,
     (glitz_gl_tex_coord_pointer_t) glTexCoordPointer,
     (glitz_gl_draw_arrays_t) glDrawArrays,
+    (glitz_gl_draw_elements_t) glDrawElements,
     (glitz_gl_tex_env_f_t) glTexEnvf,
     (glitz_gl_tex_env_fv_t) glTexEnvfv,
     (glitz_gl_tex_gen_i_t) glTexGeni,
@@ -58,6 +60,8 @@ glitz_gl_proc_address_list_t _glitz_egl_gl_proc_address = {
     (glitz_gl_clear_stencil_t) glClearStencil,
     (glitz_gl_stencil_func_t) glStencilFunc,
     (glitz_gl_stencil_op_t) glStencilOp,
+    (glitz_gl_cull_face_t) glCullFace,
+    (glitz_gl_alpha_func_t) glAlphaFunc,
     (glitz_gl_push_attrib_t) glPushAttrib,
     (glitz_gl_pop_attrib_t) glPopAttrib,
     (glitz_gl_matrix_mode_t) glMatrixMode,
@@ -125,7 +129,20 @@ glitz_gl_proc_address_list_t _glitz_egl_gl_proc_address = {
     (glitz_gl_delete_renderbuffers_t) 0,
     (glitz_gl_bind_renderbuffer_t) 0,
     (glitz_gl_renderbuffer_storage_t) 0,
-    (glitz_gl_get_renderbuffer_parameter_iv_t) 0
+    (glitz_gl_get_renderbuffer_parameter_iv_t) 0,
+    (glitz_gl_tex_storage_2d_t) 0,
+    (glitz_gl_clear_tex_sub_image_t) 0,
+    (glitz_gl_renderbuffer_storage_multisample_t) 0,
+    (glitz_gl_blit_framebuffer_t) 0,
+    (glitz_gl_multi_draw_elements_t) 0,
+    (glitz_gl_primitive_restart_index_t) 0,
+    (glitz_gl_map_buffer_range_t) 0,
+    (glitz_gl_flush_mapped_buffer_range_t) 0,
+    (glitz_gl_buffer_storage_t) 0,
+    (glitz_gl_fence_sync_t) 0,
+    (glitz_gl_delete_sync_t) 0,
+    (glitz_gl_client_wait_sync_t) 0,
+    (glitz_gl_wait_sync_t) 0
 };
 
 glitz_function_pointer_t
@@ -185,6 +202,9 @@ _glitz_egl_thread_info_fini (glitz_egl_thread_info_t *thread_info)
     }
 
     thread_info->cctx = NULL;
+
+    thread_info->current_context = EGL_NO_CONTEXT;
+    thread_info->current_surface = EGL_NO_SURFACE;
 }
 
 #ifdef PTHREADS
@@ -201,6 +221,15 @@ _glitz_egl_thread_info_init (glitz_egl_thread_info_t *thread_info)
     thread_info->gl_library = NULL;
     thread_info->dlhand = NULL;
     thread_info->cctx = NULL;
+
+    thread_info->context_stack_size = 1;
+    thread_info->context_stack->drawable = NULL;
+    thread_info->context_stack->surface = NULL;
+    thread_info->context_stack->constraint = GLITZ_NONE;
+
+    thread_info->current_context = EGL_NO_CONTEXT;
+    thread_info->current_surface = EGL_NO_SURFACE;
+    thread_info->make_current_count = 0;
 }
 
 static void
@@ -269,7 +298,13 @@ static glitz_egl_thread_info_t thread_info = {
     NULL,
     0,
     NULL,
-    NULL
+    NULL,
+    NULL,
+    { { NULL, NULL, GLITZ_NONE } },
+    1,
+    EGL_NO_CONTEXT,
+    EGL_NO_SURFACE,
+    0
 };
 
 static void
@@ -302,6 +337,12 @@ _glitz_egl_thread_info_get (const char *gl_library)
 
 #endif
 
+glitz_egl_thread_info_t *
+glitz_egl_thread_info_get (void)
+{
+    return _glitz_egl_thread_info_get (NULL);
+}
+
 static glitz_egl_display_info_t *
 _glitz_egl_display_info_get (EGLDisplay egl_display)
 {
@@ -355,6 +396,7 @@ glitz_egl_screen_info_get (EGLDisplay    display,
 	_glitz_egl_display_info_get (display);
     glitz_egl_screen_info_t **screens = display_info->screens;
     int index, n_screens = display_info->n_screens;
+    const char *version;
 
 #if 0
     int error_base, event_base;
@@ -384,6 +426,11 @@ glitz_egl_screen_info_get (EGLDisplay    display,
 
     glitz_program_map_init (&screen_info->program_map);
 
+    glitz_texture_memory_init (&screen_info->texture_memory);
+
+    glitz_damage_policy_init (&screen_info->damage_policy,
+			      GLITZ_DAMAGE_CALL_COST_DEFAULT);
+
     screen_info->egl_root_context = (EGLContext) 0;
     screen_info->egl_feature_mask = 0;
 
@@ -403,14 +450,15 @@ glitz_egl_screen_info_get (EGLDisplay    display,
     }
 #endif
 
+    version = eglQueryString (display, EGL_VERSION);
+    if (version)
+	screen_info->egl_version = (glitz_gl_float_t) atof (version);
+    else
+	screen_info->egl_version = 1.0f;
+
     glitz_egl_query_extensions (screen_info, screen_info->egl_version);
     glitz_egl_query_configs (screen_info);
 
-    screen_info->context_stack_size = 1;
-    screen_info->context_stack->drawable = NULL;
-    screen_info->context_stack->surface = NULL;
-    screen_info->context_stack->constraint = GLITZ_NONE;
-
     return screen_info;
 }
 
@@ -421,8 +469,8 @@ _glitz_egl_screen_destroy (glitz_egl_screen_info_t *screen_info)
     int     i;
 
     if (screen_info->egl_root_context)
-	eglMakeCurrent (egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
-			EGL_NO_CONTEXT);
+	glitz_egl_set_current (screen_info->display_info->thread_info,
+			       egl_display, EGL_NO_SURFACE, EGL_NO_CONTEXT);
 
     for (i = 0; i < screen_info->n_contexts; i++)
 	glitz_egl_context_destroy (screen_info, screen_info->contexts[i]);
@@ -447,3 +495,59 @@ glitz_egl_fini (void)
     _glitz_egl_thread_info_destroy (info);
 }
 slim_hidden_def(glitz_egl_fini);
+
+static EGLDisplay
+_glitz_egl_display_initialize (EGLDisplay egl_display)
+{
+    if (egl_display == EGL_NO_DISPLAY)
+	return EGL_NO_DISPLAY;
+
+    if (!eglInitialize (egl_display, NULL, NULL))
+	return EGL_NO_DISPLAY;
+
+    return egl_display;
+}
+
+/* returns an initialized display that needs no window system, from the
+   Mesa surfaceless platform or else the first EGL device. the caller
+   terminates it with eglTerminate. */
+EGLDisplay
+glitz_egl_get_headless_display (void)
+{
+    glitz_egl_get_platform_display_t get_platform_display;
+    glitz_egl_query_devices_t        query_devices;
+    EGLDisplay                       egl_display = EGL_NO_DISPLAY;
+    unsigned long                    mask;
+
+    mask = glitz_egl_query_client_extensions ();
+    if (!(mask & GLITZ_EGL_CLIENT_PLATFORM_BASE_MASK))
+	return EGL_NO_DISPLAY;
+
+    get_platform_display = (glitz_egl_get_platform_display_t)
+	eglGetProcAddress ("eglGetPlatformDisplayEXT");
+    if (!get_platform_display)
+	return EGL_NO_DISPLAY;
+
+    if (mask & GLITZ_EGL_CLIENT_PLATFORM_SURFACELESS_MASK)
+	egl_display = _glitz_egl_display_initialize (
+	    get_platform_display (EGL_PLATFORM_SURFACELESS_MESA,
+				  (void *) EGL_DEFAULT_DISPLAY, NULL));
+
+    if (egl_display == EGL_NO_DISPLAY &&
+	(mask & GLITZ_EGL_CLIENT_PLATFORM_DEVICE_MASK) &&
+	(mask & GLITZ_EGL_CLIENT_DEVICE_ENUMERATION_MASK))
+    {
+	void   *device;
+	EGLint n_devices = 0;
+
+	query_devices = (glitz_egl_query_devices_t)
+	    eglGetProcAddress ("eglQueryDevicesEXT");
+	if (query_devices && query_devices (1, &device, &n_devices) &&
+	    n_devices)
+	    egl_display = _glitz_egl_display_initialize (
+		get_platform_display (EGL_PLATFORM_DEVICE_EXT, device, NULL));
+    }
+
+    return egl_display;
+}
+slim_hidden_def(glitz_egl_get_headless_display);
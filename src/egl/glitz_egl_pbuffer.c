@@ -44,6 +44,8 @@ glitz_egl_pbuffer_create (glitz_egl_screen_info_t *screen_info,
 	attributes[2] = EGL_HEIGHT;
 	attributes[3] = height;
 
+	attributes[4] = EGL_NONE;
+
 #if 0
 	attributes[4] = EGL_LARGEST_PBUFFER;
 	attributes[5] = 0;
@@ -199,11 +199,54 @@ glitz_egl_create_pbuffer_surface (EGLDisplay              display,
 }
 slim_hidden_def(glitz_egl_create_pbuffer_surface);
 
+/* a drawable with a surfaceless context and no framebuffer of its own.
+   rendering goes to framebuffer object drawables created from it with
+   glitz_create_drawable, so no window system is involved. */
+glitz_drawable_t *
+glitz_egl_create_headless_surface (EGLDisplay              egl_display,
+				   glitz_drawable_format_t *format)
+{
+    glitz_egl_surface_t     *surface;
+    glitz_egl_screen_info_t *screen_info;
+    glitz_egl_context_t     *context;
+
+    screen_info = glitz_egl_screen_info_get (egl_display, 0);
+    if (!screen_info)
+	return NULL;
+
+    if (!(screen_info->egl_feature_mask &
+	  GLITZ_EGL_FEATURE_SURFACELESS_CONTEXT_MASK))
+	return NULL;
+
+    if (format->id >= screen_info->n_formats)
+	return NULL;
+
+    context = glitz_egl_context_get (screen_info, format);
+    if (!context)
+	return NULL;
+
+    surface = _glitz_egl_create_surface (screen_info, context, format,
+					 EGL_NO_SURFACE, 1, 1);
+    if (!surface)
+	return NULL;
+
+    if (!(surface->base.backend->feature_mask &
+	  GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK))
+    {
+	glitz_drawable_destroy (&surface->base);
+	return NULL;
+    }
+
+    return &surface->base;
+}
+slim_hidden_def(glitz_egl_create_headless_surface);
+
 void
 glitz_egl_destroy (void *abstract_drawable)
 {
     EGLint value;
     glitz_egl_surface_t *surface = (glitz_egl_surface_t *) abstract_drawable;
+    glitz_egl_thread_info_t *thread_info = glitz_egl_thread_info_get ();
 
     surface->screen_info->drawables--;
     if (surface->screen_info->drawables == 0) {
@@ -219,15 +262,20 @@ glitz_egl_destroy (void *abstract_drawable)
 	glitz_egl_pop_current (abstract_drawable);
     }
 
-    if (eglGetCurrentSurface (0) == surface->egl_surface)
-	eglMakeCurrent (surface->screen_info->display_info->egl_display,
-			EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (thread_info->current_surface == surface->egl_surface)
+	glitz_egl_set_current (thread_info,
+			       surface->screen_info->display_info->egl_display,
+			       EGL_NO_SURFACE, EGL_NO_CONTEXT);
 
-    eglQuerySurface (surface->screen_info->display_info->egl_display,
-		     surface->egl_surface,
-		     EGL_SURFACE_TYPE, &value);
-    if (value == EGL_PBUFFER_BIT)
-	glitz_egl_pbuffer_destroy (surface->screen_info, surface->egl_surface);
+    if (surface->egl_surface != EGL_NO_SURFACE)
+    {
+	eglQuerySurface (surface->screen_info->display_info->egl_display,
+			 surface->egl_surface,
+			 EGL_SURFACE_TYPE, &value);
+	if (value == EGL_PBUFFER_BIT)
+	    glitz_egl_pbuffer_destroy (surface->screen_info,
+				       surface->egl_surface);
+    }
 
     free (surface);
 }
@@ -237,6 +285,9 @@ glitz_egl_swap_buffers (void *abstract_drawable)
 {
     glitz_egl_surface_t *surface = (glitz_egl_surface_t *) abstract_drawable;
 
+    if (surface->egl_surface == EGL_NO_SURFACE)
+	return 0;
+
     eglSwapBuffers (surface->screen_info->display_info->egl_display,
 		    surface->egl_surface);
 
@@ -35,17 +35,51 @@
 #define GLITZ_EGL_FEATURE_GET_PROC_ADDRESS_MASK    (1L << 3)
 #define GLITZ_EGL_FEATURE_MULTISAMPLE_MASK         (1L << 4)
 #define GLITZ_EGL_FEATURE_PBUFFER_MULTISAMPLE_MASK (1L << 5)
+#define GLITZ_EGL_FEATURE_SURFACELESS_CONTEXT_MASK (1L << 6)
+
+#define GLITZ_EGL_CLIENT_PLATFORM_BASE_MASK        (1L << 0)
+#define GLITZ_EGL_CLIENT_PLATFORM_SURFACELESS_MASK (1L << 1)
+#define GLITZ_EGL_CLIENT_PLATFORM_DEVICE_MASK      (1L << 2)
+#define GLITZ_EGL_CLIENT_DEVICE_ENUMERATION_MASK   (1L << 3)
+
+#ifndef EGL_PLATFORM_DEVICE_EXT
+#define EGL_PLATFORM_DEVICE_EXT       0x313F
+#endif
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+typedef EGLDisplay (* glitz_egl_get_platform_display_t)
+     (EGLenum platform, void *native_display, const EGLint *attrib_list);
+typedef EGLBoolean (* glitz_egl_query_devices_t)
+     (EGLint max_devices, void **devices, EGLint *num_devices);
 
 typedef struct _glitz_egl_surface glitz_egl_surface_t;
 typedef struct _glitz_egl_screen_info_t glitz_egl_screen_info_t;
 typedef struct _glitz_egl_display_info_t glitz_egl_display_info_t;
 
+typedef struct _glitz_egl_context_info_t {
+    glitz_egl_surface_t *drawable;
+    glitz_surface_t     *surface;
+    glitz_constraint_t  constraint;
+} glitz_egl_context_info_t;
+
+/* the context stack is per thread so that threads rendering to
+   different drawables never see each other's push_current calls.
+   current_context and current_surface mirror what glitz last made
+   current on the thread so that EGL doesn't have to be asked. */
 typedef struct _glitz_egl_thread_info_t {
     glitz_egl_display_info_t **displays;
     int                      n_displays;
     char                     *gl_library;
     void                     *dlhand;
     glitz_context_t          *cctx;
+    glitz_egl_context_info_t context_stack[GLITZ_CONTEXT_STACK_SIZE];
+    int                      context_stack_size;
+    EGLContext               current_context;
+    EGLSurface               current_surface;
+    unsigned long            make_current_count;
 } glitz_egl_thread_info_t;
 
 struct _glitz_egl_display_info_t {
@@ -55,12 +89,6 @@ struct _glitz_egl_display_info_t {
     int n_screens;
 };
 
-typedef struct _glitz_egl_context_info_t {
-    glitz_egl_surface_t *drawable;
-    glitz_surface_t     *surface;
-    glitz_constraint_t  constraint;
-} glitz_egl_context_info_t;
-
 typedef struct _glitz_egl_context_t {
     glitz_context_t   base;
     EGLContext        egl_context;
@@ -78,12 +106,12 @@ struct _glitz_egl_screen_info_t {
     int                         n_formats;
     glitz_egl_context_t         **contexts;
     int                         n_contexts;
-    glitz_egl_context_info_t    context_stack[GLITZ_CONTEXT_STACK_SIZE];
-    int                         context_stack_size;
     EGLContext                  egl_root_context;
     unsigned long               egl_feature_mask;
     glitz_gl_float_t            egl_version;
     glitz_program_map_t         program_map;
+    glitz_texture_memory_t      texture_memory;
+    glitz_damage_policy_t       damage_policy;
 };
 
 struct _glitz_egl_surface {
@@ -100,10 +128,22 @@ extern void __internal_linkage
 glitz_egl_query_extensions (glitz_egl_screen_info_t *screen_info,
 			    glitz_gl_float_t        egl_version);
 
+extern unsigned long __internal_linkage
+glitz_egl_query_client_extensions (void);
+
 extern glitz_egl_screen_info_t __internal_linkage *
 glitz_egl_screen_info_get (EGLDisplay egl_display,
 			   EGLScreenMESA  egl_screen);
 
+extern glitz_egl_thread_info_t __internal_linkage *
+glitz_egl_thread_info_get (void);
+
+extern void __internal_linkage
+glitz_egl_set_current (glitz_egl_thread_info_t *thread_info,
+		       EGLDisplay              egl_display,
+		       EGLSurface              egl_surface,
+		       EGLContext              egl_context);
+
 extern glitz_function_pointer_t __internal_linkage
 glitz_egl_get_proc_address (const char *name,
 			    void       *closure);
@@ -149,6 +189,9 @@ glitz_egl_push_current (void               *abstract_drawable,
 extern glitz_surface_t __internal_linkage *
 glitz_egl_pop_current (void *abstract_drawable);
 
+extern void __internal_linkage
+glitz_egl_release_current (void *abstract_drawable);
+
 void
 glitz_egl_make_current (void               *abstract_drawable,
 			glitz_constraint_t constraint);
@@ -177,5 +220,8 @@ slim_hidden_proto(glitz_egl_find_window_config)
 slim_hidden_proto(glitz_egl_find_pbuffer_config)
 slim_hidden_proto(glitz_egl_create_surface)
 slim_hidden_proto(glitz_egl_create_pbuffer_surface)
+slim_hidden_proto(glitz_egl_get_headless_display)
+slim_hidden_proto(glitz_egl_find_headless_config)
+slim_hidden_proto(glitz_egl_create_headless_surface)
 
 #endif /* GLITZ_EGLINT_H_INCLUDED */
@@ -66,6 +66,24 @@ glitz_composite (glitz_operator_t op,
 
     GLITZ_GL_SURFACE (dst);
 
+    if (SURFACE_QUEUED (dst))
+    {
+	glitz_queue_composite (op, src, mask, dst,
+			       x_src, y_src, x_mask, y_mask,
+			       x_dst, y_dst, width, height);
+	return;
+    }
+
+    if (SURFACE_TILED (dst)           ||
+	(src && SURFACE_TILED (src)) ||
+	(mask && SURFACE_TILED (mask)))
+    {
+	glitz_tiled_composite (op, src, mask, dst,
+			       x_src, y_src, x_mask, y_mask,
+			       x_dst, y_dst, width, height);
+	return;
+    }
+
     bounds.x1 = MAX (x_dst, 0);
     bounds.y1 = MAX (y_dst, 0);
     bounds.x2 = x_dst + width;
@@ -82,6 +100,24 @@ glitz_composite (glitz_operator_t op,
     if (dst->geometry.buffer && (!dst->geometry.count))
 	return;
 
+    glitz_texture_memory_begin (dst);
+
+    if (src)
+	glitz_atlas_validate_source (src, dst,
+				     GLITZ_VERTEX_ATTRIBUTE_SRC_COORD_MASK,
+				     x_src + (bounds.x1 - x_dst),
+				     y_src + (bounds.y1 - y_dst),
+				     bounds.x2 - bounds.x1,
+				     bounds.y2 - bounds.y1);
+
+    if (mask)
+	glitz_atlas_validate_source (mask, dst,
+				     GLITZ_VERTEX_ATTRIBUTE_MASK_COORD_MASK,
+				     x_mask + (bounds.x1 - x_dst),
+				     y_mask + (bounds.y1 - y_dst),
+				     bounds.x2 - bounds.x1,
+				     bounds.y2 - bounds.y1);
+
     glitz_composite_op_init (&comp_op, op, src, mask, dst);
     if (comp_op.type == GLITZ_COMBINE_TYPE_NA)
     {
@@ -121,6 +157,17 @@ glitz_composite (glitz_operator_t op,
     no_border_clamp = !(dst->drawable->backend->feature_mask &
 			GLITZ_FEATURE_TEXTURE_BORDER_CLAMP_MASK);
 
+    /* clamp to border sampling reaches the padding of the textures */
+    if (mtexture && !SURFACE_REPEAT (mask) && !SURFACE_PAD (mask))
+	glitz_texture_clear_padding (gl, mtexture,
+				     dst->drawable->backend->feature_mask,
+				     dst->fb);
+
+    if (stexture && !SURFACE_REPEAT (src) && !SURFACE_PAD (src))
+	glitz_texture_clear_padding (gl, stexture,
+				     dst->drawable->backend->feature_mask,
+				     dst->fb);
+
     if (mtexture)
     {
 	textures[0].texture = mtexture;
@@ -135,7 +182,7 @@ glitz_composite (glitz_operator_t op,
 	{
 	    flags &= ~GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK;
 
-	    if (dst->geometry.u.v.mask.size == 2)
+	    if (dst->geometry.u.v.mask.size >= 2)
 		flags &= ~GLITZ_SURFACE_FLAG_GEN_T_COORDS_MASK;
 	}
 
@@ -213,7 +260,7 @@ glitz_composite (glitz_operator_t op,
 	{
 	    flags &= ~GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK;
 
-	    if (dst->geometry.u.v.src.size == 2)
+	    if (dst->geometry.u.v.src.size >= 2)
 		flags &= ~GLITZ_SURFACE_FLAG_GEN_T_COORDS_MASK;
 	}
 
@@ -358,6 +405,20 @@ glitz_copy_area (glitz_surface_t *src,
 
     GLITZ_GL_SURFACE (dst);
 
+    if (SURFACE_QUEUED (dst))
+    {
+	glitz_queue_copy_area (src, dst, x_src, y_src, width, height,
+			       x_dst, y_dst);
+	return;
+    }
+
+    if (SURFACE_TILED (src) || SURFACE_TILED (dst))
+    {
+	glitz_tiled_copy_area (src, dst, x_src, y_src, width, height,
+			       x_dst, y_dst);
+	return;
+    }
+
     if (x_src < 0)
     {
 	bounds.x1 = x_dst - x_src;
@@ -402,6 +463,8 @@ glitz_copy_area (glitz_surface_t *src,
     if (bounds.x2 <= bounds.x1 || bounds.y2 <= bounds.y1)
 	return;
 
+    glitz_texture_memory_begin (dst);
+
     status = GLITZ_STATUS_NOT_SUPPORTED;
     if ((!src->attached) ||
 	(src->attached == dst->attached) ||
@@ -411,7 +474,9 @@ glitz_copy_area (glitz_surface_t *src,
 	{
 	    int target_height = dst->attached->height;
 
-	    if (src->attached == dst->attached)
+	    /* multisampled buffers can't be copied from directly */
+	    if (src->attached == dst->attached &&
+		!DRAWABLE_IS_MULTISAMPLE_FBO (src->attached))
 	    {
 		glitz_box_t box, *clip = dst->clip;
 		int         n_clip = dst->n_clip;
@@ -505,81 +570,14 @@ glitz_copy_area (glitz_surface_t *src,
 
 		    glitz_set_operator (gl, GLITZ_OPERATOR_SRC);
 
-		    if (dst->n_clip > 1)
-		    {
-			glitz_float_t *data;
-			void          *ptr;
-			int           vertices = 0;
-			glitz_box_t   box, *clip = dst->clip;
-			int           n_clip = dst->n_clip;
-
-			ptr = malloc (n_clip * 8 * sizeof (glitz_float_t));
-			if (!ptr)
-			{
-			    mask = GLITZ_STATUS_NO_MEMORY_MASK;
-			    glitz_surface_pop_current (dst);
-			    glitz_surface_status_add (dst, mask);
-			    return;
-			}
-
-			data = (glitz_float_t *) ptr;
-
-			while (n_clip--)
-			{
-			    box.x1 = clip->x1 + dst->x_clip;
-			    box.y1 = clip->y1 + dst->y_clip;
-			    box.x2 = clip->x2 + dst->x_clip;
-			    box.y2 = clip->y2 + dst->y_clip;
-			    if (bounds.x1 > box.x1)
-				box.x1 = bounds.x1;
-			    if (bounds.y1 > box.y1)
-				box.y1 = bounds.y1;
-			    if (bounds.x2 < box.x2)
-				box.x2 = bounds.x2;
-			    if (bounds.y2 < box.y2)
-				box.y2 = bounds.y2;
-
-			    if (box.x1 < box.x2 && box.y1 < box.y2)
-			    {
-				*data++ = (glitz_float_t) box.x1;
-				*data++ = (glitz_float_t) box.y1;
-				*data++ = (glitz_float_t) box.x2;
-				*data++ = (glitz_float_t) box.y1;
-				*data++ = (glitz_float_t) box.x2;
-				*data++ = (glitz_float_t) box.y2;
-				*data++ = (glitz_float_t) box.x1;
-				*data++ = (glitz_float_t) box.y2;
-
-				vertices += 4;
-				glitz_surface_damage (dst, &box,
-						      GLITZ_DAMAGE_TEXTURE_MASK |
-						      GLITZ_DAMAGE_SOLID_MASK);
-			    }
-
-			    clip++;
-			}
-
-			if (vertices)
-			{
-			    gl->scissor (bounds.x1 + dst->x,
-					 (target_height - dst->y) - bounds.y2,
-					 bounds.x2 - bounds.x1,
-					 bounds.y2 - bounds.y1);
-
-			    gl->vertex_pointer (2, GLITZ_GL_FLOAT, 0, ptr);
-			    gl->draw_arrays (GLITZ_GL_QUADS, 0, vertices);
-			}
-
-			free (ptr);
-		    }
-		    else
-		    {
-			glitz_geometry_enable_none (gl, dst, &bounds);
-			glitz_geometry_draw_arrays (gl, dst,
-						    GLITZ_GEOMETRY_TYPE_NONE,
-						    &bounds,
+		    if (!glitz_geometry_draw_boxes (gl, dst, &bounds, 1,
 						    GLITZ_DAMAGE_TEXTURE_MASK |
-						    GLITZ_DAMAGE_SOLID_MASK);
+						    GLITZ_DAMAGE_SOLID_MASK))
+		    {
+			mask = GLITZ_STATUS_NO_MEMORY_MASK;
+			glitz_surface_pop_current (dst);
+			glitz_surface_status_add (dst, mask);
+			return;
 		    }
 
 		    glitz_texture_unbind (gl, texture);
@@ -596,22 +594,37 @@ glitz_copy_area (glitz_surface_t *src,
     {
 	if (glitz_surface_push_current (src, GLITZ_DRAWABLE_CURRENT))
 	{
-	    glitz_texture_t *texture;
+	    glitz_texture_t *texture, *src_texture = NULL;
+
+	    texture = glitz_surface_get_texture (dst, 1);
+
+	    /* a multisampled source is resolved into its own texture, which
+	       has the format of its renderbuffer, and copied from there */
+	    if (texture && DRAWABLE_IS_MULTISAMPLE_FBO (src->attached))
+	    {
+		src_texture = glitz_surface_get_texture (src, 1);
+		if (!src_texture)
+		    texture = NULL;
+	    }
 
 	    src->drawable->backend->read_buffer (src->drawable, src->buffer);
 
-	    texture = glitz_surface_get_texture (dst, 1);
 	    if (texture)
 	    {
 		glitz_box_t box, *clip  = dst->clip;
 		int         n_clip = dst->n_clip;
 
+		status = GLITZ_STATUS_SUCCESS;
+
 		gl->disable (GLITZ_GL_SCISSOR_TEST);
 
 		glitz_texture_bind (gl, texture);
 
-		x_src += src->x;
-		y_src += src->y;
+		if (!src_texture)
+		{
+		    x_src += src->x;
+		    y_src += src->y;
+		}
 
 		while (n_clip--)
 		{
@@ -630,15 +643,31 @@ glitz_copy_area (glitz_surface_t *src,
 
 		    if (box.x1 < box.x2 && box.y1 < box.y2)
 		    {
-			glitz_texture_copy_drawable (gl,
-						     texture,
-						     src->attached,
-						     x_src + (box.x1 - x_dst),
-						     y_src + (box.y1 - y_dst),
-						     box.x2 - box.x1,
-						     box.y2 - box.y1,
-						     box.x1,
-						     box.y1);
+			if (!src_texture)
+			    glitz_texture_copy_drawable (gl,
+							 texture,
+							 src->attached,
+							 x_src + (box.x1 - x_dst),
+							 y_src + (box.y1 - y_dst),
+							 box.x2 - box.x1,
+							 box.y2 - box.y1,
+							 box.x1,
+							 box.y1);
+			else if (!glitz_framebuffer_copy_texture (src->attached,
+								  src_texture,
+								  texture,
+								  x_src +
+								  (box.x1 - x_dst),
+								  y_src +
+								  (box.y1 - y_dst),
+								  box.x2 - box.x1,
+								  box.y2 - box.y1,
+								  box.x1,
+								  box.y1))
+			{
+			    status = GLITZ_STATUS_NOT_SUPPORTED;
+			    break;
+			}
 
 			glitz_surface_damage (dst, &box,
 					      GLITZ_DAMAGE_DRAWABLE_MASK |
@@ -651,8 +680,6 @@ glitz_copy_area (glitz_surface_t *src,
 		glitz_texture_unbind (gl, texture);
 
 		gl->enable (GLITZ_GL_SCISSOR_TEST);
-
-		status = GLITZ_STATUS_SUCCESS;
 	    }
 	}
 	glitz_surface_pop_current (src);
@@ -93,7 +93,8 @@ typedef enum {
   GLITZ_FILTER_CONVOLUTION,
   GLITZ_FILTER_GAUSSIAN,
   GLITZ_FILTER_LINEAR_GRADIENT,
-  GLITZ_FILTER_RADIAL_GRADIENT
+  GLITZ_FILTER_RADIAL_GRADIENT,
+  GLITZ_FILTER_EDGE_COVERAGE
 } glitz_filter_t;
 
 typedef enum {
@@ -131,6 +132,13 @@ typedef enum {
 #define GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK       (1L << 16)
 #define GLITZ_FEATURE_COPY_SUB_BUFFER_MASK          (1L << 17)
 #define GLITZ_FEATURE_DIRECT_RENDERING_MASK         (1L << 18)
+#define GLITZ_FEATURE_TEXTURE_STORAGE_MASK          (1L << 19)
+#define GLITZ_FEATURE_CLEAR_TEXTURE_MASK            (1L << 20)
+#define GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK  (1L << 21)
+#define GLITZ_FEATURE_PRIMITIVE_RESTART_MASK        (1L << 22)
+#define GLITZ_FEATURE_MAP_BUFFER_RANGE_MASK         (1L << 23)
+#define GLITZ_FEATURE_SYNC_MASK                     (1L << 24)
+#define GLITZ_FEATURE_BUFFER_STORAGE_MASK           (1L << 25)
 
 
 /* glitz_format.c */
@@ -294,13 +302,60 @@ const char *
 glitz_drawable_get_gl_string (glitz_drawable_t  *drawable,
 			      glitz_gl_string_t name);
 
+void
+glitz_drawable_set_damage_call_cost (glitz_drawable_t *drawable,
+				     unsigned long    cost);
+
+unsigned long
+glitz_drawable_get_damage_over_copy (glitz_drawable_t *drawable);
+
+
+/* glitz_memory.c */
+
+void
+glitz_drawable_set_texture_memory_budget (glitz_drawable_t *drawable,
+					  unsigned long    size);
+
+unsigned long
+glitz_drawable_get_texture_memory_usage (glitz_drawable_t *drawable);
+
+
+/* glitz_arena.c */
+
+void
+glitz_drawable_set_buffer_arena (glitz_drawable_t *drawable,
+				 unsigned int     max_size);
+
+
+/* glitz_queue.c */
+
+glitz_status_t
+glitz_drawable_start_submission (glitz_drawable_t *drawable);
+
+void
+glitz_drawable_stop_submission (glitz_drawable_t *drawable);
+
+
+/* glitz_upload.c */
+
+glitz_status_t
+glitz_drawable_start_uploads (glitz_drawable_t *drawable,
+			      int              n_workers);
+
+void
+glitz_drawable_stop_uploads (glitz_drawable_t *drawable);
+
 
 /* glitz_surface.c */
 
 #define GLITZ_SURFACE_UNNORMALIZED_MASK (1L << 0)
+#define GLITZ_SURFACE_TILED_MASK        (1L << 1)
+#define GLITZ_SURFACE_ATLAS_MASK        (1L << 2)
 
 typedef struct _glitz_surface_attributes_t {
   glitz_bool_t unnormalized;
+  glitz_bool_t tiled;
+  glitz_bool_t atlas;
 } glitz_surface_attributes_t;
 
 glitz_surface_t *
@@ -328,6 +383,12 @@ glitz_surface_detach (glitz_surface_t *surface);
 void
 glitz_surface_flush (glitz_surface_t *surface);
 
+void
+glitz_surface_begin_batch (glitz_surface_t *surface);
+
+void
+glitz_surface_end_batch (glitz_surface_t *surface);
+
 glitz_drawable_t *
 glitz_surface_get_drawable (glitz_surface_t *surface);
 
@@ -558,6 +619,16 @@ glitz_pixel_buffer_create (glitz_drawable_t    *drawable,
 glitz_buffer_t *
 glitz_buffer_create_for_data (void *data);
 
+glitz_buffer_t *
+glitz_buffer_create_for_fd (int           fd,
+			    unsigned long offset,
+			    unsigned int  size,
+			    unsigned int  chunk_size);
+
+glitz_buffer_t *
+glitz_stream_buffer_create (glitz_drawable_t *drawable,
+			    unsigned int     size);
+
 void
 glitz_buffer_destroy (glitz_buffer_t *buffer);
 
@@ -583,6 +654,22 @@ glitz_buffer_map (glitz_buffer_t        *buffer,
 glitz_status_t
 glitz_buffer_unmap (glitz_buffer_t *buffer);
 
+#define GLITZ_BUFFER_MAP_INVALIDATE_RANGE_MASK (1L << 0)
+#define GLITZ_BUFFER_MAP_UNSYNCHRONIZED_MASK   (1L << 1)
+#define GLITZ_BUFFER_MAP_FLUSH_EXPLICIT_MASK   (1L << 2)
+
+void *
+glitz_buffer_map_range (glitz_buffer_t        *buffer,
+			int                   offset,
+			unsigned int          size,
+			glitz_buffer_access_t access,
+			unsigned long         flags);
+
+void
+glitz_buffer_flush_range (glitz_buffer_t *buffer,
+			  int            offset,
+			  unsigned int   size);
+
 
 /* glitz_pixel.c */
 
@@ -651,7 +738,8 @@ typedef enum {
 
 typedef enum {
   GLITZ_COORDINATE_SIZE_X,
-  GLITZ_COORDINATE_SIZE_XY
+  GLITZ_COORDINATE_SIZE_XY,
+  GLITZ_COORDINATE_SIZE_XYZW
 } glitz_coordinate_size_t;
 
 typedef struct _glitz_coordinate_attribute {
@@ -695,6 +783,26 @@ glitz_set_geometry (glitz_surface_t         *dst,
 		    glitz_geometry_format_t *format,
 		    glitz_buffer_t          *buffer);
 
+typedef enum {
+  GLITZ_INDEX_TYPE_UNSIGNED_SHORT,
+  GLITZ_INDEX_TYPE_UNSIGNED_INT
+} glitz_index_type_t;
+
+typedef struct _glitz_index_format {
+  glitz_index_type_t type;
+  int                primitive_restart;
+  unsigned int       restart_index;
+} glitz_index_format_t;
+
+void
+glitz_set_index_buffer (glitz_surface_t      *dst,
+			glitz_index_format_t *format,
+			glitz_buffer_t       *buffer);
+
+void
+glitz_set_bitmap_repeat (glitz_surface_t *dst,
+			 int             repeat);
+
 void
 glitz_set_array (glitz_surface_t    *dst,
 		 int                first,
@@ -754,6 +862,50 @@ glitz_add_traps (glitz_buffer_t    *buffer,
 		 int               n_traps,
 		 int               *n_added);
 
+int
+glitz_add_trapezoid_edges (glitz_buffer_t    *buffer,
+			   int               offset,
+			   unsigned int      size,
+			   glitz_data_type_t type,
+			   glitz_trapezoid_t *traps,
+			   int               n_traps,
+			   int               *n_added);
+
+int
+glitz_add_trap_edges (glitz_buffer_t    *buffer,
+		      int               offset,
+		      unsigned int      size,
+		      glitz_data_type_t type,
+		      glitz_trap_t      *traps,
+		      int               n_traps,
+		      int               *n_added);
+
+
+/* glitz_path.c */
+
+typedef enum {
+  GLITZ_FILL_RULE_WINDING,
+  GLITZ_FILL_RULE_EVEN_ODD
+} glitz_fill_rule_t;
+
+typedef struct _glitz_polygon {
+  glitz_point_fixed_t *points;
+  int                 n_points;
+} glitz_polygon_t;
+
+void
+glitz_fill_path (glitz_operator_t  op,
+		 glitz_surface_t   *src,
+		 glitz_surface_t   *mask,
+		 glitz_surface_t   *dst,
+		 int               x_src,
+		 int               y_src,
+		 int               x_mask,
+		 int               y_mask,
+		 glitz_fill_rule_t fill_rule,
+		 glitz_polygon_t   *polygons,
+		 int               n_polygons);
+
 
 /* glitz.c */
 
@@ -0,0 +1,317 @@
+/*
+ * Copyright © 2006 David Reveman
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * David Reveman not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * David Reveman makes no representations about the suitability of this
+ * software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * DAVID REVEMAN DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL DAVID REVEMAN BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Author: David Reveman <davidr@novell.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#include <stdlib.h>
+
+#define GLITZ_ARENA_BLOCK_SIZE (1 << 20)
+#define GLITZ_ARENA_MIN_SHIFT  6
+#define GLITZ_ARENA_MAX_SHIFT  16
+#define GLITZ_ARENA_CLASSES    (GLITZ_ARENA_MAX_SHIFT -		     \
+				GLITZ_ARENA_MIN_SHIFT + 1)
+
+#define GLITZ_ARENA_MAX_SIZE   (1 << GLITZ_ARENA_MAX_SHIFT)
+
+typedef struct _glitz_arena_range glitz_arena_range_t;
+
+struct _glitz_arena_range {
+    unsigned int        offset;
+    glitz_arena_range_t *next;
+};
+
+/* a buffer object carved into power of two sized ranges. ranges are
+   taken from the top of the block until it is full and are reused
+   through per size class free lists after that. */
+struct _glitz_arena_block {
+    glitz_gl_uint_t     name;
+    glitz_gl_enum_t     usage;
+    unsigned int        top;
+    int                 n_used;
+    glitz_arena_range_t *free[GLITZ_ARENA_CLASSES];
+    glitz_arena_block_t *next;
+};
+
+struct _glitz_arena {
+    unsigned int        max_size;
+    glitz_arena_block_t *blocks;
+};
+
+static int
+_glitz_arena_class (unsigned int size)
+{
+    int n = 0;
+
+    while ((1U << (n + GLITZ_ARENA_MIN_SHIFT)) < size)
+	n++;
+
+    return n;
+}
+
+static glitz_arena_block_t *
+_glitz_arena_block_create (glitz_gl_proc_address_list_t *gl,
+			   glitz_arena_t                *arena,
+			   glitz_gl_enum_t              usage)
+{
+    glitz_arena_block_t *block;
+    int                 i;
+
+    block = malloc (sizeof (glitz_arena_block_t));
+    if (!block)
+	return NULL;
+
+    block->name = 0;
+    gl->gen_buffers (1, &block->name);
+    if (!block->name)
+    {
+	free (block);
+	return NULL;
+    }
+
+    gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, block->name);
+    gl->buffer_data (GLITZ_GL_ARRAY_BUFFER, GLITZ_ARENA_BLOCK_SIZE, NULL,
+		     usage);
+    gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, 0);
+
+    block->usage  = usage;
+    block->top    = 0;
+    block->n_used = 0;
+
+    for (i = 0; i < GLITZ_ARENA_CLASSES; i++)
+	block->free[i] = NULL;
+
+    block->next   = arena->blocks;
+    arena->blocks = block;
+
+    return block;
+}
+
+static void
+_glitz_arena_block_reset (glitz_arena_block_t *block)
+{
+    glitz_arena_range_t *range;
+    int                 i;
+
+    for (i = 0; i < GLITZ_ARENA_CLASSES; i++)
+    {
+	while (block->free[i])
+	{
+	    range = block->free[i];
+	    block->free[i] = range->next;
+	    free (range);
+	}
+    }
+
+    block->top = 0;
+}
+
+static void
+_glitz_arena_block_destroy (glitz_gl_proc_address_list_t *gl,
+			    glitz_arena_block_t          *block)
+{
+    _glitz_arena_block_reset (block);
+
+    gl->delete_buffers (1, &block->name);
+    free (block);
+}
+
+/* buffers of at most max_size bytes created for drawable from now on
+   share buffer objects with each other. 0 turns sub-allocation off for
+   new buffers. */
+void
+glitz_drawable_set_buffer_arena (glitz_drawable_t *drawable,
+				 unsigned int     max_size)
+{
+    glitz_arena_t *arena = drawable->arena;
+
+    if (!(drawable->backend->feature_mask &
+	  GLITZ_FEATURE_VERTEX_BUFFER_OBJECT_MASK) ||
+	!(drawable->backend->feature_mask &
+	  GLITZ_FEATURE_MAP_BUFFER_RANGE_MASK))
+	return;
+
+    if (!arena)
+    {
+	if (!max_size)
+	    return;
+
+	arena = malloc (sizeof (glitz_arena_t));
+	if (!arena)
+	    return;
+
+	arena->blocks = NULL;
+
+	drawable->arena = arena;
+    }
+
+    arena->max_size = MIN (max_size, GLITZ_ARENA_MAX_SIZE);
+}
+
+/* called with a context current */
+void
+glitz_arena_destroy (glitz_drawable_t *drawable)
+{
+    glitz_arena_t       *arena = drawable->arena;
+    glitz_arena_block_t *block;
+
+    if (!arena)
+	return;
+
+    while (arena->blocks)
+    {
+	block = arena->blocks;
+	arena->blocks = block->next;
+
+	_glitz_arena_block_destroy (drawable->backend->gl, block);
+    }
+
+    free (arena);
+
+    drawable->arena = NULL;
+}
+
+/* reserves a range of size bytes and returns the buffer object holding
+   it in block and its offset in offset. returns false when size is too
+   large for the arena or when no range could be allocated. called with
+   a context current. */
+glitz_bool_t
+glitz_arena_alloc (glitz_drawable_t    *drawable,
+		   unsigned int        size,
+		   glitz_gl_enum_t     usage,
+		   glitz_arena_block_t **block,
+		   unsigned int        *offset)
+{
+    glitz_arena_t       *arena = drawable->arena;
+    glitz_arena_block_t *b;
+    glitz_arena_range_t *range;
+    unsigned int        class_size;
+    int                 size_class;
+
+    if (!arena || size == 0 || size > arena->max_size)
+	return 0;
+
+    size_class = _glitz_arena_class (size);
+    class_size = 1U << (size_class + GLITZ_ARENA_MIN_SHIFT);
+
+    for (b = arena->blocks; b; b = b->next)
+    {
+	if (b->usage != usage)
+	    continue;
+
+	if (b->free[size_class])
+	{
+	    range = b->free[size_class];
+	    b->free[size_class] = range->next;
+
+	    *offset = range->offset;
+	    free (range);
+	    break;
+	}
+
+	if (b->top + class_size <= GLITZ_ARENA_BLOCK_SIZE)
+	{
+	    *offset = b->top;
+	    b->top += class_size;
+	    break;
+	}
+    }
+
+    if (!b)
+    {
+	b = _glitz_arena_block_create (drawable->backend->gl, arena, usage);
+	if (!b)
+	    return 0;
+
+	*offset = 0;
+	b->top = class_size;
+    }
+
+    b->n_used++;
+    *block = b;
+
+    return 1;
+}
+
+/* called with a context current */
+void
+glitz_arena_free (glitz_drawable_t    *drawable,
+		  glitz_arena_block_t *block,
+		  unsigned int        offset,
+		  unsigned int        size)
+{
+    glitz_arena_t       *arena = drawable->arena;
+    glitz_arena_block_t **prev;
+    glitz_arena_block_t *b;
+    glitz_arena_range_t *range;
+    int                 size_class = _glitz_arena_class (size);
+
+    /* empty blocks are released unless they are the last one for their
+       usage, which keeps create and destroy cycles off the driver */
+    if (--block->n_used == 0)
+    {
+	for (b = arena->blocks; b; b = b->next)
+	{
+	    if (b != block && b->usage == block->usage)
+		break;
+	}
+
+	if (b)
+	{
+	    for (prev = &arena->blocks; *prev; prev = &(*prev)->next)
+	    {
+		if (*prev == block)
+		{
+		    *prev = block->next;
+		    break;
+		}
+	    }
+
+	    _glitz_arena_block_destroy (drawable->backend->gl, block);
+	}
+	else
+	    _glitz_arena_block_reset (block);
+
+	return;
+    }
+
+    /* the range is lost if it can't be tracked */
+    range = malloc (sizeof (glitz_arena_range_t));
+    if (!range)
+	return;
+
+    range->offset = offset;
+    range->next   = block->free[size_class];
+    block->free[size_class] = range;
+}
+
+glitz_gl_uint_t
+glitz_arena_name (glitz_arena_block_t *block)
+{
+    return block->name;
+}
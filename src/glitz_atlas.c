@@ -0,0 +1,316 @@
+/*
+ * Copyright © 2006 David Reveman
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * David Reveman not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * David Reveman makes no representations about the suitability of this
+ * software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * DAVID REVEMAN DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL DAVID REVEMAN BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Author: David Reveman <davidr@novell.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#include <stdlib.h>
+
+#define GLITZ_ATLAS_SIZE     512
+#define GLITZ_ATLAS_MIN_CELL 16
+#define GLITZ_ATLAS_MAX_CELL 64
+
+#define GLITZ_ATLAS_MAX_CELLS					     \
+    ((GLITZ_ATLAS_SIZE / GLITZ_ATLAS_MIN_CELL) *		     \
+     (GLITZ_ATLAS_SIZE / GLITZ_ATLAS_MIN_CELL))
+
+#define GLITZ_ATLAS_MAP_SIZE (GLITZ_ATLAS_MAX_CELLS / 32)
+
+/* a texture page split into equally sized square cells. pages are
+   shared by all atlas surfaces with the same texture format and cell
+   size on a screen. */
+struct _glitz_atlas {
+    glitz_texture_t texture;
+    int             cell_size;
+    int             n_cells;
+    int             n_used;
+    unsigned long   size;
+    unsigned int    used[GLITZ_ATLAS_MAP_SIZE];
+    glitz_atlas_t   *next;
+};
+
+static glitz_atlas_t *
+_glitz_atlas_create (glitz_surface_t        *surface,
+		     glitz_texture_memory_t *memory,
+		     int                    cell_size)
+{
+    unsigned long feature_mask = surface->drawable->backend->feature_mask;
+    glitz_atlas_t *atlas;
+
+    GLITZ_GL_SURFACE (surface);
+
+    atlas = calloc (1, sizeof (glitz_atlas_t));
+    if (!atlas)
+	return NULL;
+
+    glitz_texture_init (&atlas->texture,
+			GLITZ_ATLAS_SIZE, GLITZ_ATLAS_SIZE,
+			surface->texture.format,
+			GLITZ_FOURCC_RGB,
+			feature_mask, 0);
+
+    glitz_texture_allocate (gl, &atlas->texture, feature_mask);
+    if (!atlas->texture.name)
+    {
+	free (atlas);
+	return NULL;
+    }
+
+    atlas->cell_size = cell_size;
+    atlas->n_cells   = (GLITZ_ATLAS_SIZE / cell_size) *
+	(GLITZ_ATLAS_SIZE / cell_size);
+    atlas->size      = GLITZ_ATLAS_SIZE * GLITZ_ATLAS_SIZE *
+	(glitz_backing_store_format (surface)->masks.bpp / 8);
+
+    atlas->next   = memory->atlas;
+    memory->atlas = atlas;
+
+    memory->size += atlas->size;
+
+    return atlas;
+}
+
+static void
+_glitz_atlas_destroy (glitz_surface_t        *surface,
+		      glitz_texture_memory_t *memory,
+		      glitz_atlas_t          *atlas)
+{
+    glitz_atlas_t **prev;
+
+    GLITZ_GL_SURFACE (surface);
+
+    for (prev = &memory->atlas; *prev; prev = &(*prev)->next)
+    {
+	if (*prev == atlas)
+	{
+	    *prev = atlas->next;
+	    break;
+	}
+    }
+
+    memory->size -= atlas->size;
+
+    glitz_texture_fini (gl, &atlas->texture);
+    free (atlas);
+}
+
+static int
+_glitz_atlas_find_cell (glitz_atlas_t *atlas)
+{
+    int i, bit;
+
+    for (i = 0; i < GLITZ_ATLAS_MAP_SIZE; i++)
+    {
+	if (atlas->used[i] == ~0U)
+	    continue;
+
+	for (bit = 0; bit < 32; bit++)
+	{
+	    if (i * 32 + bit >= atlas->n_cells)
+		return -1;
+
+	    if (!(atlas->used[i] & (1U << bit)))
+		return i * 32 + bit;
+	}
+    }
+
+    return -1;
+}
+
+glitz_bool_t
+glitz_atlas_allocate (glitz_surface_t *surface)
+{
+    glitz_texture_memory_t *memory = surface->drawable->backend->texture_memory;
+    glitz_texture_t        *texture = &surface->texture;
+    glitz_atlas_t          *atlas;
+    int                    cell_size, cell, per_row, x, y;
+
+    if (!memory ||
+	surface->drawable->backend->max_texture_2d_size < GLITZ_ATLAS_SIZE)
+    {
+	surface->flags &= ~GLITZ_SURFACE_FLAG_ATLAS_MASK;
+	return 0;
+    }
+
+    cell_size = GLITZ_ATLAS_MIN_CELL;
+    while (cell_size < surface->box.x2 || cell_size < surface->box.y2)
+	cell_size <<= 1;
+
+    for (atlas = memory->atlas; atlas; atlas = atlas->next)
+    {
+	if (atlas->cell_size      == cell_size       &&
+	    atlas->texture.format == texture->format &&
+	    atlas->n_used < atlas->n_cells)
+	    break;
+    }
+
+    if (!atlas)
+    {
+	atlas = _glitz_atlas_create (surface, memory, cell_size);
+	if (!atlas)
+	{
+	    surface->flags &= ~GLITZ_SURFACE_FLAG_ATLAS_MASK;
+	    return 0;
+	}
+    }
+
+    cell = _glitz_atlas_find_cell (atlas);
+
+    atlas->used[cell / 32] |= 1U << (cell % 32);
+    atlas->n_used++;
+
+    per_row = GLITZ_ATLAS_SIZE / cell_size;
+    x = (cell % per_row) * cell_size;
+    y = (cell / per_row) * cell_size;
+
+    texture->name   = atlas->texture.name;
+    texture->target = atlas->texture.target;
+    texture->width  = atlas->texture.width;
+    texture->height = atlas->texture.height;
+    texture->param  = atlas->texture.param;
+
+    texture->texcoord_width_unit  = atlas->texture.texcoord_width_unit;
+    texture->texcoord_height_unit = atlas->texture.texcoord_height_unit;
+
+    texture->box.x1 = x;
+    texture->box.y1 = y;
+    texture->box.x2 = x + surface->box.x2;
+    texture->box.y2 = y + surface->box.y2;
+
+    /* neighbouring cells make the texture unusable for anything but
+       sampling inside the box */
+    texture->flags = GLITZ_TEXTURE_FLAG_ALLOCATED_MASK |
+	GLITZ_TEXTURE_FLAG_SHARED_MASK;
+
+    surface->atlas      = atlas;
+    surface->atlas_cell = cell;
+
+    return 1;
+}
+
+void
+glitz_atlas_release (glitz_surface_t *surface)
+{
+    glitz_atlas_t *atlas = surface->atlas;
+    int           cell = surface->atlas_cell;
+
+    if (!atlas)
+	return;
+
+    atlas->used[cell / 32] &= ~(1U << (cell % 32));
+    atlas->n_used--;
+
+    if (!atlas->n_used)
+	_glitz_atlas_destroy (surface,
+			      surface->drawable->backend->texture_memory,
+			      atlas);
+
+    surface->atlas = NULL;
+
+    surface->texture.name   = 0;
+    surface->texture.flags &= ~(GLITZ_TEXTURE_FLAG_ALLOCATED_MASK |
+				GLITZ_TEXTURE_FLAG_SHARED_MASK);
+}
+
+/* move surface contents out of the atlas and into a texture of its own */
+void
+glitz_atlas_migrate (glitz_surface_t *surface)
+{
+    glitz_pixel_format_t format;
+    glitz_buffer_t       *buffer = NULL;
+    void                 *data;
+    unsigned long        status_mask = surface->status_mask;
+
+    if (!surface->atlas)
+    {
+	surface->flags &= ~GLITZ_SURFACE_FLAG_ATLAS_MASK;
+	return;
+    }
+
+    format = *glitz_backing_store_format (surface);
+    format.bytes_per_line =
+	(((surface->box.x2 * format.masks.bpp) / 8) + 3) & -4;
+
+    data = malloc (format.bytes_per_line * surface->box.y2);
+    if (data)
+    {
+	buffer = glitz_buffer_create_for_data (data);
+	if (buffer)
+	    glitz_surface_transfer (surface, &format, buffer, 1);
+    }
+
+    if (!buffer)
+	glitz_surface_status_add (surface, GLITZ_STATUS_NO_MEMORY_MASK);
+
+    glitz_surface_push_current (surface, GLITZ_ANY_CONTEXT_CURRENT);
+    glitz_atlas_release (surface);
+    glitz_surface_pop_current (surface);
+
+    surface->flags &= ~GLITZ_SURFACE_FLAG_ATLAS_MASK;
+
+    glitz_texture_init (&surface->texture,
+			surface->box.x2, surface->box.y2,
+			surface->texture.format,
+			surface->format->color.fourcc,
+			surface->drawable->backend->feature_mask, 0);
+
+    if (buffer)
+    {
+	if (surface->status_mask == status_mask)
+	    glitz_surface_transfer (surface, &format, buffer, 0);
+
+	glitz_buffer_destroy (buffer);
+    }
+
+    if (data)
+	free (data);
+}
+
+/* atlas surfaces can only be sampled with nearest filtering inside their
+   own box. anything else needs a dedicated texture. */
+void
+glitz_atlas_validate_source (glitz_surface_t *surface,
+			     glitz_surface_t *dst,
+			     unsigned long   coord_attribute,
+			     int             x,
+			     int             y,
+			     int             width,
+			     int             height)
+{
+    if (!SURFACE_ATLAS (surface))
+	return;
+
+    if (SURFACE_REPEAT (surface)			   ||
+	SURFACE_PAD (surface)				   ||
+	SURFACE_TRANSFORM (surface)			   ||
+	SURFACE_FRAGMENT_FILTER (surface)		   ||
+	(dst->geometry.attributes & coord_attribute)	   ||
+	x < 0 || x + width > surface->box.x2		   ||
+	y < 0 || y + height > surface->box.y2)
+	glitz_atlas_migrate (surface);
+}
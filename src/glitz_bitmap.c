@@ -0,0 +1,316 @@
+/*
+ * Copyright © 2006 David Reveman
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * David Reveman not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * David Reveman makes no representations about the suitability of this
+ * software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * DAVID REVEMAN DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL DAVID REVEMAN BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Author: David Reveman <davidr@novell.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#include <stdlib.h>
+
+#define GLITZ_BITMAP_CACHE_SIZE 256
+
+#define N_STACK_EXPAND 1024
+
+/* bitmap geometry expanded to an alpha texture. entries hang off the
+   buffer holding the bits and are keyed by the bitmap's location in it. */
+struct _glitz_bitmap_texture {
+    glitz_texture_t        texture;
+    glitz_drawable_t       *drawable;
+    int                    first;
+    int                    width;
+    int                    height;
+    int                    stride;
+    int                    repeat;
+    glitz_bool_t           top_down;
+    unsigned int           serial;
+    glitz_bitmap_texture_t *next;
+};
+
+static int
+_glitz_bitmap_stride (glitz_geometry_t *geometry,
+		      int              first,
+		      int              width)
+{
+    int bits = geometry->u.b.pad << 3;
+
+    if (geometry->stride)
+	return geometry->stride;
+
+    if (geometry->u.b.top_down)
+	return (((first & 3) + width + bits - 1) / bits) * geometry->u.b.pad;
+
+    return ((width + bits - 1) / bits) * geometry->u.b.pad;
+}
+
+/* one byte per bit, bottom row first */
+static void
+_glitz_bitmap_expand (glitz_gl_ubyte_t       *dst,
+		      const glitz_gl_ubyte_t *bits,
+		      glitz_bitmap_texture_t *entry)
+{
+    const glitz_gl_ubyte_t *line;
+    int                    x, y, row, bit;
+
+    for (y = 0; y < entry->height; y++)
+    {
+	row = (entry->top_down)? entry->height - 1 - y: y;
+	line = bits + (entry->first >> 3) + row * entry->stride;
+
+	for (x = 0; x < entry->width; x++)
+	{
+	    bit = (entry->first & 7) + x;
+
+#if BITMAP_BIT_ORDER == MSBFirst
+	    *dst++ = (line[bit >> 3] & (0x80 >> (bit & 7)))? 0xff: 0x00;
+#else
+	    *dst++ = (line[bit >> 3] & (1 << (bit & 7)))? 0xff: 0x00;
+#endif
+
+	}
+    }
+}
+
+static glitz_bool_t
+_glitz_bitmap_upload (glitz_gl_proc_address_list_t *gl,
+		      glitz_bitmap_texture_t       *entry,
+		      const glitz_gl_ubyte_t       *bits)
+{
+    glitz_gl_ubyte_t stack_data[N_STACK_EXPAND], *data = stack_data;
+    int              size = entry->width * entry->height;
+
+    if (size > N_STACK_EXPAND)
+    {
+	data = malloc (size);
+	if (!data)
+	    return 0;
+    }
+
+    _glitz_bitmap_expand (data, bits, entry);
+
+    glitz_texture_bind (gl, &entry->texture);
+
+    gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH, 0);
+    gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_ROWS, 0);
+    gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_PIXELS, 0);
+    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 1);
+
+    gl->tex_sub_image_2d (entry->texture.target, 0,
+			  entry->texture.box.x1, entry->texture.box.y1,
+			  entry->width, entry->height,
+			  GLITZ_GL_ALPHA, GLITZ_GL_UNSIGNED_BYTE,
+			  data);
+
+    glitz_texture_unbind (gl, &entry->texture);
+
+    if (data != stack_data)
+	free (data);
+
+    return 1;
+}
+
+static glitz_bool_t
+_glitz_bitmap_texture_init (glitz_gl_proc_address_list_t *gl,
+			    glitz_surface_t              *dst,
+			    glitz_bitmap_texture_t       *entry)
+{
+    unsigned long              feature_mask =
+	dst->drawable->backend->feature_mask;
+    glitz_texture_parameters_t param;
+
+    glitz_texture_init (&entry->texture, entry->width, entry->height,
+			GLITZ_GL_ALPHA8, GLITZ_FOURCC_RGB, feature_mask, 0);
+
+    if (entry->repeat && !TEXTURE_REPEATABLE (&entry->texture))
+	return 0;
+
+    glitz_texture_size_check (gl, &entry->texture,
+			      dst->drawable->backend->max_texture_2d_size,
+			      dst->drawable->backend->max_texture_rect_size);
+    if (TEXTURE_INVALID_SIZE (&entry->texture))
+	return 0;
+
+    glitz_texture_allocate (gl, &entry->texture, feature_mask);
+    if (!entry->texture.name)
+	return 0;
+
+    param.filter[0] = param.filter[1] = GLITZ_GL_NEAREST;
+    param.wrap[0] = param.wrap[1] =
+	(entry->repeat)? GLITZ_GL_REPEAT: GLITZ_GL_CLAMP_TO_EDGE;
+    param.border_color = entry->texture.param.border_color;
+
+    glitz_texture_bind (gl, &entry->texture);
+    glitz_texture_ensure_parameters (gl, &entry->texture, &param);
+    glitz_texture_unbind (gl, &entry->texture);
+
+    return 1;
+}
+
+static void
+_glitz_bitmap_texture_destroy (glitz_bitmap_texture_t *entry)
+{
+    glitz_drawable_t *drawable = entry->drawable;
+
+    if (entry->texture.name)
+    {
+	drawable->backend->push_current (drawable, NULL,
+					 GLITZ_ANY_CONTEXT_CURRENT, NULL);
+	glitz_texture_fini (drawable->backend->gl, &entry->texture);
+	drawable->backend->pop_current (drawable);
+    }
+
+    glitz_drawable_destroy (drawable);
+    free (entry);
+}
+
+/* returns a texture holding the bitmap at first in the current bitmap
+   geometry. with a repeat set only the repeat sized pattern at first is
+   stored. bits is mapped on the first cache miss and must be unmapped by
+   the caller. */
+glitz_texture_t *
+glitz_bitmap_get_texture (glitz_gl_proc_address_list_t *gl,
+			  glitz_surface_t              *dst,
+			  int                          first,
+			  int                          width,
+			  int                          height,
+			  glitz_gl_ubyte_t             **bits)
+{
+    glitz_geometry_t       *geometry = &dst->geometry;
+    glitz_buffer_t         *buffer = geometry->buffer;
+    glitz_bitmap_texture_t *entry, **prev, **last = NULL;
+    int                    stride, repeat = geometry->u.b.repeat;
+    int                    n_entries = 0;
+    glitz_bool_t           cacheable;
+
+    if (repeat)
+	width = height = repeat;
+
+    stride = _glitz_bitmap_stride (geometry, first, width);
+
+    /* client memory can change behind our back */
+    cacheable = buffer->drawable || buffer->owns_data;
+
+    for (prev = &buffer->bitmaps; *prev; prev = &(*prev)->next)
+    {
+	entry = *prev;
+
+	if (entry->drawable->backend == dst->drawable->backend &&
+	    entry->first    == first                           &&
+	    entry->width    == width                           &&
+	    entry->height   == height                          &&
+	    entry->stride   == stride                          &&
+	    entry->repeat   == repeat                          &&
+	    entry->top_down == geometry->u.b.top_down)
+	    break;
+
+	if (entry->drawable->backend == dst->drawable->backend)
+	    last = prev;
+
+	n_entries++;
+    }
+
+    entry = *prev;
+    if (entry)
+    {
+	*prev = entry->next;
+
+	if (cacheable && entry->serial == buffer->serial)
+	{
+	    entry->next = buffer->bitmaps;
+	    buffer->bitmaps = entry;
+
+	    return &entry->texture;
+	}
+    }
+    else if (n_entries >= GLITZ_BITMAP_CACHE_SIZE && last)
+    {
+	/* reuse the least recently used entry of this screen */
+	entry = *last;
+	*last = entry->next;
+
+	glitz_texture_fini (gl, &entry->texture);
+	entry->texture.name = 0;
+    }
+
+    if (!entry)
+    {
+	entry = malloc (sizeof (glitz_bitmap_texture_t));
+	if (!entry)
+	    return NULL;
+
+	entry->drawable = dst->drawable;
+	glitz_drawable_reference (entry->drawable);
+	entry->texture.name = 0;
+    }
+
+    if (!entry->texture.name)
+    {
+	entry->first    = first;
+	entry->width    = width;
+	entry->height   = height;
+	entry->stride   = stride;
+	entry->repeat   = repeat;
+	entry->top_down = geometry->u.b.top_down;
+	entry->serial   = buffer->serial - 1;
+
+	if (!_glitz_bitmap_texture_init (gl, dst, entry))
+	{
+	    _glitz_bitmap_texture_destroy (entry);
+	    return NULL;
+	}
+    }
+
+    entry->next = buffer->bitmaps;
+    buffer->bitmaps = entry;
+
+    if (!*bits)
+    {
+	*bits = glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_READ_ONLY);
+	if (!*bits)
+	    return NULL;
+    }
+
+    if (!_glitz_bitmap_upload (gl, entry, *bits))
+	return NULL;
+
+    entry->serial = buffer->serial;
+
+    return &entry->texture;
+}
+
+void
+glitz_bitmap_cache_fini (glitz_buffer_t *buffer)
+{
+    glitz_bitmap_texture_t *entry;
+
+    while (buffer->bitmaps)
+    {
+	entry = buffer->bitmaps;
+	buffer->bitmaps = entry->next;
+
+	_glitz_bitmap_texture_destroy (entry);
+    }
+}
@@ -29,6 +29,14 @@
 
 #include "glitzint.h"
 
+#if defined (HAVE_MMAP) && defined (HAVE_SYS_MMAN_H)
+#  define GLITZ_BUFFER_MMAP 1
+#  include <sys/types.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#  include <fcntl.h>
+#endif
+
 static glitz_status_t
 _glitz_buffer_init (glitz_buffer_t      *buffer,
 		    glitz_drawable_t    *drawable,
@@ -40,6 +48,16 @@ _glitz_buffer_init (glitz_buffer_t      *buffer,
 
     buffer->ref_count = 1;
     buffer->name = 0;
+    buffer->serial = 0;
+    buffer->flush_explicit = 0;
+    buffer->bitmaps = NULL;
+    buffer->streamed = 0;
+    buffer->block = NULL;
+    buffer->offset = 0;
+    buffer->size = size;
+    buffer->mapping = NULL;
+    buffer->mapping_size = 0;
+    buffer->chunk_size = 0;
 
     if (drawable)
     {
@@ -82,11 +100,22 @@ _glitz_buffer_init (glitz_buffer_t      *buffer,
 	drawable->backend->push_current (drawable, NULL,
 					 GLITZ_ANY_CONTEXT_CURRENT, NULL);
 
-	gl->gen_buffers (1, &buffer->name);
-	if (buffer->name) {
-	    gl->bind_buffer (buffer->target, buffer->name);
-	    gl->buffer_data (buffer->target, size, data, usage);
-	    gl->bind_buffer (buffer->target, 0);
+	if (glitz_arena_alloc (drawable, size, usage,
+			       &buffer->block, &buffer->offset)) {
+	    buffer->name = glitz_arena_name (buffer->block);
+	    if (data) {
+		gl->bind_buffer (buffer->target, buffer->name);
+		gl->buffer_sub_data (buffer->target, buffer->offset,
+				     size, data);
+		gl->bind_buffer (buffer->target, 0);
+	    }
+	} else {
+	    gl->gen_buffers (1, &buffer->name);
+	    if (buffer->name) {
+		gl->bind_buffer (buffer->target, buffer->name);
+		gl->buffer_data (buffer->target, size, data, usage);
+		gl->bind_buffer (buffer->target, 0);
+	    }
 	}
 
 	drawable->backend->pop_current (drawable);
@@ -207,26 +236,156 @@ glitz_buffer_create_for_data (void *data)
     return buffer;
 }
 
+/* maps size bytes of fd at offset into a client buffer. the mapping is
+   shared, writable when fd is open for writing and lives as long as the
+   buffer, so fd can be closed once the buffer exists. a non-zero
+   chunk_size makes pixel uploads from the buffer go chunk_size bytes at
+   a time and drop pages once they are uploaded. */
+glitz_buffer_t *
+glitz_buffer_create_for_fd (int           fd,
+			    unsigned long offset,
+			    unsigned int  size,
+			    unsigned int  chunk_size)
+{
+
+#ifdef GLITZ_BUFFER_MMAP
+    glitz_buffer_t *buffer;
+    unsigned long  page, start, length;
+    void           *mapping;
+    int            prot = PROT_READ, flags;
+
+    if (size == 0)
+	return NULL;
+
+    flags = fcntl (fd, F_GETFL);
+    if (flags == -1)
+	return NULL;
+
+    if ((flags & O_ACCMODE) == O_RDWR)
+	prot |= PROT_WRITE;
+
+    page   = sysconf (_SC_PAGESIZE);
+    start  = offset & ~(page - 1);
+    length = size + (offset - start);
+
+    mapping = mmap (NULL, length, prot, MAP_SHARED, fd, (off_t) start);
+    if (mapping == MAP_FAILED)
+	return NULL;
+
+    buffer = glitz_buffer_create_for_data ((char *) mapping +
+					   (offset - start));
+    if (!buffer)
+    {
+	munmap (mapping, length);
+	return NULL;
+    }
+
+    buffer->mapping      = mapping;
+    buffer->mapping_size = length;
+    buffer->size         = size;
+    buffer->chunk_size   = chunk_size;
+
+    return buffer;
+#else
+    return NULL;
+#endif
+
+}
+
+/* returns a vertex buffer of size bytes carved out of the stream ring of
+   drawable. stream buffers are meant to be filled once per frame and
+   destroyed once drawn from. they are write only and only one of them
+   can be mapped at a time. */
+glitz_buffer_t *
+glitz_stream_buffer_create (glitz_drawable_t *drawable,
+			    unsigned int     size)
+{
+    glitz_buffer_t *buffer;
+    unsigned int   offset;
+    glitz_bool_t   allocated;
+
+    if (size == 0)
+	return NULL;
+
+    drawable->backend->push_current (drawable, NULL,
+				     GLITZ_ANY_CONTEXT_CURRENT, NULL);
+    allocated = glitz_stream_alloc (drawable, size, &offset);
+    drawable->backend->pop_current (drawable);
+
+    if (!allocated)
+	return glitz_vertex_buffer_create (drawable, NULL, size,
+					   GLITZ_BUFFER_HINT_STREAM_DRAW);
+
+    buffer = (glitz_buffer_t *) malloc (sizeof (glitz_buffer_t));
+    if (buffer == NULL)
+    {
+	drawable->backend->push_current (drawable, NULL,
+					 GLITZ_ANY_CONTEXT_CURRENT, NULL);
+	glitz_stream_release (drawable, offset);
+	drawable->backend->pop_current (drawable);
+	return NULL;
+    }
+
+    buffer->ref_count = 1;
+    buffer->name = glitz_stream_name (drawable);
+    buffer->target = GLITZ_GL_ARRAY_BUFFER;
+    buffer->data = NULL;
+    buffer->owns_data = 0;
+    buffer->serial = 0;
+    buffer->flush_explicit = 0;
+    buffer->bitmaps = NULL;
+    buffer->streamed = 1;
+    buffer->block = NULL;
+    buffer->offset = offset;
+    buffer->size = size;
+    buffer->mapping = NULL;
+    buffer->mapping_size = 0;
+    buffer->chunk_size = 0;
+
+    buffer->drawable = drawable;
+    glitz_drawable_reference (drawable);
+
+    return buffer;
+}
+
 void
 glitz_buffer_destroy (glitz_buffer_t *buffer)
 {
     if (!buffer)
 	return;
 
-    buffer->ref_count--;
-    if (buffer->ref_count)
+    if (buffer->drawable && DRAWABLE_QUEUED (buffer->drawable))
+    {
+	glitz_queue_buffer_destroy (buffer);
 	return;
+    }
+
+    if (GLITZ_ATOMIC_DEC (&buffer->ref_count))
+	return;
+
+    glitz_bitmap_cache_fini (buffer);
 
     if (buffer->drawable) {
 	buffer->drawable->backend->push_current (buffer->drawable, NULL,
 						 GLITZ_ANY_CONTEXT_CURRENT,
 						 NULL);
-	buffer->drawable->backend->gl->delete_buffers (1, &buffer->name);
+	if (buffer->streamed)
+	    glitz_stream_release (buffer->drawable, buffer->offset);
+	else if (buffer->block)
+	    glitz_arena_free (buffer->drawable, buffer->block,
+			      buffer->offset, buffer->size);
+	else
+	    buffer->drawable->backend->gl->delete_buffers (1, &buffer->name);
 	buffer->drawable->backend->pop_current (buffer->drawable);
 	glitz_drawable_destroy (buffer->drawable);
     } else if (buffer->owns_data)
 	free (buffer->data);
 
+#ifdef GLITZ_BUFFER_MMAP
+    if (buffer->mapping)
+	munmap (buffer->mapping, buffer->mapping_size);
+#endif
+
     free (buffer);
 }
 
@@ -236,7 +395,7 @@ glitz_buffer_reference (glitz_buffer_t *buffer)
     if (!buffer)
 	return;
 
-    buffer->ref_count++;
+    GLITZ_ATOMIC_INC (&buffer->ref_count);
 }
 
 void
@@ -245,6 +404,8 @@ glitz_buffer_set_data (glitz_buffer_t *buffer,
 		       unsigned int   size,
 		       const void     *data)
 {
+    buffer->serial++;
+
     if (buffer->drawable) {
 	GLITZ_GL_DRAWABLE (buffer->drawable);
 
@@ -252,7 +413,8 @@ glitz_buffer_set_data (glitz_buffer_t *buffer,
 						 GLITZ_ANY_CONTEXT_CURRENT,
 						 NULL);
 	gl->bind_buffer (buffer->target, buffer->name);
-	gl->buffer_sub_data (buffer->target, offset, size, data);
+	gl->buffer_sub_data (buffer->target, buffer->offset + offset,
+			     size, data);
 	gl->bind_buffer (buffer->target, 0);
 	buffer->drawable->backend->pop_current (buffer->drawable);
     } else if (buffer->data)
@@ -273,7 +435,8 @@ glitz_buffer_get_data (glitz_buffer_t *buffer,
 						 GLITZ_ANY_CONTEXT_CURRENT,
 						 NULL);
 	gl->bind_buffer (buffer->target, buffer->name);
-	gl->get_buffer_sub_data (buffer->target, offset, size, data);
+	gl->get_buffer_sub_data (buffer->target, buffer->offset + offset,
+				 size, data);
 	gl->bind_buffer (buffer->target, 0);
 
 	buffer->drawable->backend->pop_current (buffer->drawable);
@@ -288,6 +451,12 @@ glitz_buffer_map (glitz_buffer_t        *buffer,
 {
     void *pointer = NULL;
 
+    if (buffer->streamed || buffer->block)
+	return glitz_buffer_map_range (buffer, 0, buffer->size, access, 0);
+
+    if (access != GLITZ_BUFFER_ACCESS_READ_ONLY)
+	buffer->serial++;
+
     if (buffer->drawable) {
 	glitz_gl_enum_t buffer_access;
 
@@ -322,12 +491,129 @@ glitz_buffer_map (glitz_buffer_t        *buffer,
     return pointer;
 }
 
+/* maps size bytes at offset and returns a pointer to the first of them.
+   without GL_ARB_map_buffer_range the whole buffer is mapped and flags
+   are ignored. */
+void *
+glitz_buffer_map_range (glitz_buffer_t        *buffer,
+			int                   offset,
+			unsigned int          size,
+			glitz_buffer_access_t access,
+			unsigned long         flags)
+{
+    void *pointer = NULL;
+
+    if (buffer->streamed) {
+	if (access != GLITZ_BUFFER_ACCESS_READ_ONLY)
+	    buffer->serial++;
+
+	buffer->drawable->backend->push_current (buffer->drawable, NULL,
+						 GLITZ_ANY_CONTEXT_CURRENT,
+						 NULL);
+	pointer = glitz_stream_map (buffer->drawable, buffer->offset + offset,
+				    size);
+	buffer->drawable->backend->pop_current (buffer->drawable);
+
+	return pointer;
+    }
+
+    if (buffer->drawable &&
+	!(buffer->drawable->backend->feature_mask &
+	  GLITZ_FEATURE_MAP_BUFFER_RANGE_MASK)) {
+	pointer = glitz_buffer_map (buffer, access);
+	if (pointer)
+	    pointer = (char *) pointer + offset;
+
+	return pointer;
+    }
+
+    if (access != GLITZ_BUFFER_ACCESS_READ_ONLY)
+	buffer->serial++;
+
+    if (buffer->drawable) {
+	glitz_gl_bitfield_t buffer_access;
+
+	GLITZ_GL_DRAWABLE (buffer->drawable);
+
+	buffer->drawable->backend->push_current (buffer->drawable, NULL,
+						 GLITZ_ANY_CONTEXT_CURRENT,
+						 NULL);
+
+	switch (access) {
+	case GLITZ_BUFFER_ACCESS_READ_ONLY:
+	    buffer_access = GLITZ_GL_MAP_READ_BIT;
+	    break;
+	case GLITZ_BUFFER_ACCESS_WRITE_ONLY:
+	    buffer_access = GLITZ_GL_MAP_WRITE_BIT;
+	    break;
+	default:
+	    buffer_access = GLITZ_GL_MAP_READ_BIT | GLITZ_GL_MAP_WRITE_BIT;
+	    break;
+	}
+
+	/* all of these are errors on read only mappings */
+	if (access != GLITZ_BUFFER_ACCESS_READ_ONLY) {
+	    if (flags & GLITZ_BUFFER_MAP_INVALIDATE_RANGE_MASK)
+		buffer_access |= GLITZ_GL_MAP_INVALIDATE_RANGE_BIT;
+	    if (flags & GLITZ_BUFFER_MAP_UNSYNCHRONIZED_MASK)
+		buffer_access |= GLITZ_GL_MAP_UNSYNCHRONIZED_BIT;
+	    if (flags & GLITZ_BUFFER_MAP_FLUSH_EXPLICIT_MASK)
+		buffer_access |= GLITZ_GL_MAP_FLUSH_EXPLICIT_BIT;
+	}
+
+	gl->bind_buffer (buffer->target, buffer->name);
+	pointer = gl->map_buffer_range (buffer->target,
+					buffer->offset + offset, size,
+					buffer_access);
+	gl->bind_buffer (buffer->target, 0);
+
+	if (pointer)
+	    buffer->flush_explicit =
+		(buffer_access & GLITZ_GL_MAP_FLUSH_EXPLICIT_BIT)? 1: 0;
+
+	buffer->drawable->backend->pop_current (buffer->drawable);
+    }
+
+    if (pointer == NULL && buffer->data)
+	pointer = (char *) buffer->data + offset;
+
+    return pointer;
+}
+
+/* offset is relative to the start of the mapped range. only needed when
+   the range was mapped with GLITZ_BUFFER_MAP_FLUSH_EXPLICIT_MASK. */
+void
+glitz_buffer_flush_range (glitz_buffer_t *buffer,
+			  int            offset,
+			  unsigned int   size)
+{
+    if (buffer->drawable && buffer->flush_explicit) {
+	GLITZ_GL_DRAWABLE (buffer->drawable);
+
+	buffer->drawable->backend->push_current (buffer->drawable, NULL,
+						 GLITZ_ANY_CONTEXT_CURRENT,
+						 NULL);
+
+	gl->bind_buffer (buffer->target, buffer->name);
+	gl->flush_mapped_buffer_range (buffer->target, offset, size);
+	gl->bind_buffer (buffer->target, 0);
+
+	buffer->drawable->backend->pop_current (buffer->drawable);
+    }
+}
+
 glitz_status_t
 glitz_buffer_unmap (glitz_buffer_t *buffer)
 {
     glitz_status_t status = GLITZ_STATUS_SUCCESS;
 
-    if (buffer->drawable) {
+    if (buffer->streamed) {
+	buffer->drawable->backend->push_current (buffer->drawable, NULL,
+						 GLITZ_ANY_CONTEXT_CURRENT,
+						 NULL);
+	status = glitz_stream_unmap (buffer->drawable);
+	buffer->drawable->backend->pop_current (buffer->drawable);
+    } else if (buffer->drawable) {
 	GLITZ_GL_DRAWABLE (buffer->drawable);
 
 	buffer->drawable->backend->push_current (buffer->drawable, NULL,
@@ -339,6 +625,8 @@ glitz_buffer_unmap (glitz_buffer_t *buffer)
 	if (gl->unmap_buffer (buffer->target) == GLITZ_GL_FALSE)
 	    status = GLITZ_STATUS_CONTENT_DESTROYED;
 
+	buffer->flush_explicit = 0;
+
 	gl->bind_buffer (buffer->target, 0);
 
 	buffer->drawable->backend->pop_current (buffer->drawable);
@@ -355,7 +643,7 @@ glitz_buffer_bind (glitz_buffer_t *buffer,
 	buffer->drawable->backend->gl->bind_buffer (target, buffer->name);
 	buffer->target = target;
 
-	return NULL;
+	return (char *) NULL + buffer->offset;
     }
 
     return buffer->data;
@@ -367,3 +655,29 @@ glitz_buffer_unbind (glitz_buffer_t *buffer)
     if (buffer->drawable)
 	buffer->drawable->backend->gl->bind_buffer (buffer->target, 0);
 }
+
+/* lets the system reclaim the pages of a file mapping that lie entirely
+   inside size bytes at offset. they are read back in if touched again. */
+void
+glitz_buffer_discard_range (glitz_buffer_t *buffer,
+			    unsigned long  offset,
+			    unsigned long  size)
+{
+
+#if defined (GLITZ_BUFFER_MMAP) && defined (HAVE_MADVISE)
+    unsigned long page, start, end;
+
+    if (!buffer->mapping)
+	return;
+
+    page  = sysconf (_SC_PAGESIZE);
+    start = ((char *) buffer->data - (char *) buffer->mapping) + offset;
+    end   = (start + size) & ~(page - 1);
+    start = (start + page - 1) & ~(page - 1);
+
+    if (start < end)
+	madvise ((char *) buffer->mapping + start, end - start,
+		 MADV_DONTNEED);
+#endif
+
+}
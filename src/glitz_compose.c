@@ -593,6 +593,11 @@ glitz_composite_op_init (glitz_composite_op_t *op,
 	(!(feature_mask & GLITZ_FEATURE_PER_COMPONENT_RENDERING_MASK)))
 	op->combine = NULL;
 
+    /* alpha of the fragments drawn for set bits */
+    if (dst->geometry.type == GLITZ_GEOMETRY_TYPE_BITMAP)
+	dst->geometry.u.b.alpha = SHORT_MULT (op->solid->alpha,
+					      op->alpha_mask.alpha);
+
     if (op->combine == combine) {
 	op->type = combine->type;
 	if (combine->source_shader) {
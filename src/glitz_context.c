@@ -61,8 +61,7 @@ glitz_context_destroy (glitz_context_t *context)
     if (!context)
 	return;
 
-    context->ref_count--;
-    if (context->ref_count)
+    if (GLITZ_ATOMIC_DEC (&context->ref_count))
 	return;
 
     context->drawable->backend->destroy_context (context);
@@ -75,7 +74,7 @@ glitz_context_reference (glitz_context_t *context)
     if (!context)
 	return;
 
-    context->ref_count++;
+    GLITZ_ATOMIC_INC (&context->ref_count);
 }
 slim_hidden_def(glitz_context_reference);
 
@@ -162,13 +161,22 @@ glitz_context_bind_texture (glitz_context_t	   *context,
 {
     glitz_gl_proc_address_list_t *gl = context->drawable->backend->gl;
 
-    if (GLITZ_REGION_NOTEMPTY (&texture->surface->texture_damage))
+    if (texture->surface->batch)
+	glitz_surface_apply_batch_damage (texture->surface);
+
+    /* the texture of an evicted surface is gone and must be restored
+       before its name is handed out */
+    if (SURFACE_EVICTED (texture->surface) ||
+	GLITZ_REGION_NOTEMPTY (&texture->surface->texture_damage))
     {
 	glitz_lose_current_function_t lose_current;
 
 	lose_current = context->lose_current;
 	context->lose_current = 0;
 
+	if (SURFACE_EVICTED (texture->surface))
+	    glitz_texture_memory_restore (texture->surface);
+
 	glitz_surface_push_current (texture->surface, GLITZ_CONTEXT_CURRENT);
 	_glitz_surface_sync_texture (texture->surface);
 	glitz_surface_pop_current (texture->surface);
@@ -178,6 +186,17 @@ glitz_context_bind_texture (glitz_context_t	   *context,
 	glitz_context_make_current (context, context->drawable);
     }
 
+    glitz_texture_memory_touch (texture->surface);
+
+    /* the framebuffer bound in the context isn't known here */
+    if (texture->param.wrap[0] == GLITZ_GL_CLAMP_TO_BORDER ||
+	texture->param.wrap[1] == GLITZ_GL_CLAMP_TO_BORDER ||
+	texture->param.wrap[0] == GLITZ_GL_CLAMP ||
+	texture->param.wrap[1] == GLITZ_GL_CLAMP)
+	glitz_texture_clear_padding (gl, &texture->surface->texture,
+				     context->drawable->backend->feature_mask &
+				     ~GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK, 0);
+
     gl->bind_texture (texture->surface->texture.target,
 		      texture->surface->texture.name);
 
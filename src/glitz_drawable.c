@@ -55,6 +55,14 @@ _glitz_drawable_init (glitz_drawable_t	          *drawable,
     drawable->update_all = 1;
     drawable->flushed    = 0;
     drawable->finished   = 0;
+
+    drawable->stencil_clip_serial = 0;
+
+    drawable->stream = NULL;
+    drawable->arena  = NULL;
+    drawable->queue  = NULL;
+
+    drawable->uploader = NULL;
 }
 
 void
@@ -144,10 +152,18 @@ glitz_drawable_destroy (glitz_drawable_t *drawable)
     if (!drawable)
 	return;
 
-    drawable->ref_count--;
-    if (drawable->ref_count)
+    if (GLITZ_ATOMIC_DEC (&drawable->ref_count))
 	return;
 
+    if (drawable->stream || drawable->arena)
+    {
+	drawable->backend->push_current (drawable, NULL,
+					 GLITZ_ANY_CONTEXT_CURRENT, NULL);
+	glitz_stream_destroy (drawable);
+	glitz_arena_destroy (drawable);
+	drawable->backend->pop_current (drawable);
+    }
+
     drawable->backend->destroy (drawable);
 }
 
@@ -157,7 +173,7 @@ glitz_drawable_reference (glitz_drawable_t *drawable)
     if (!drawable)
 	return;
 
-    drawable->ref_count++;
+    GLITZ_ATOMIC_INC (&drawable->ref_count);
 }
 
 void
@@ -204,9 +220,19 @@ glitz_drawable_swap_buffer_region (glitz_drawable_t *drawable,
 
     GLITZ_GL_DRAWABLE (drawable);
 
+    if (DRAWABLE_QUEUED (drawable))
+    {
+	glitz_queue_swap_buffer_region (drawable, x_origin, y_origin,
+					box, n_box);
+	return;
+    }
+
     if (!drawable->format->d.doublebuffer || !n_box)
 	return;
 
+    /* stencil contents are undefined after a swap */
+    drawable->stencil_clip_serial = 0;
+
     /* try swap buffers (fastest) */
     if (n_box == 1)
     {
@@ -368,6 +394,12 @@ slim_hidden_def(glitz_drawable_swap_buffers);
 void
 glitz_drawable_flush (glitz_drawable_t *drawable)
 {
+    if (DRAWABLE_QUEUED (drawable))
+    {
+	glitz_queue_flush (drawable);
+	return;
+    }
+
     if (drawable->flushed)
 	return;
 
@@ -383,6 +415,12 @@ slim_hidden_def(glitz_drawable_flush);
 void
 glitz_drawable_finish (glitz_drawable_t *drawable)
 {
+    if (DRAWABLE_QUEUED (drawable))
+    {
+	glitz_queue_finish (drawable);
+	return;
+    }
+
     if (drawable->finished)
 	return;
 
@@ -441,3 +479,31 @@ glitz_drawable_get_gl_string (glitz_drawable_t  *drawable,
     return (const char *) string;
 }
 slim_hidden_def(glitz_drawable_get_gl_string);
+
+void
+glitz_damage_policy_init (glitz_damage_policy_t *policy,
+			  unsigned long         call_cost)
+{
+    policy->call_cost = call_cost;
+    policy->over_copy = 0;
+}
+
+/* cost of one texture copy or draw call in pixels. damage regions are
+   merged into fewer boxes as long as that copies fewer pixels than the
+   calls saved cost, 0 disables merging. */
+void
+glitz_drawable_set_damage_call_cost (glitz_drawable_t *drawable,
+				     unsigned long    cost)
+{
+    if (drawable->backend->damage_policy)
+	drawable->backend->damage_policy->call_cost = cost;
+}
+
+unsigned long
+glitz_drawable_get_damage_over_copy (glitz_drawable_t *drawable)
+{
+    if (!drawable->backend->damage_policy)
+	return 0;
+
+    return drawable->backend->damage_policy->over_copy;
+}
@@ -330,6 +330,12 @@ glitz_filter_set_params (glitz_surface_t *surface,
 		vecs[i].v[3] = 2147483647.0f;
 	}
 	break;
+    case GLITZ_FILTER_EDGE_COVERAGE:
+	if (_glitz_filter_params_ensure (surface, 0))
+	    return GLITZ_STATUS_NO_MEMORY;
+
+	surface->filter_params->id = 1;
+	break;
     case GLITZ_FILTER_BILINEAR:
     case GLITZ_FILTER_NEAREST:
 	switch (surface->format->color.fourcc) {
@@ -432,6 +438,10 @@ glitz_filter_set_type (glitz_surface_t *surface,
 	    } else
 		surface->filter_params->fp_type =
 		    GLITZ_FP_RADIAL_GRADIENT_TRANSPARENT;
+	    break;
+	case GLITZ_FILTER_EDGE_COVERAGE:
+	    surface->filter_params->fp_type = GLITZ_FP_EDGE_COVERAGE;
+	    break;
 	default:
 	    break;
 	}
@@ -516,5 +526,7 @@ glitz_filter_enable (glitz_surface_t *surface,
 	} break;
 	}
 	break;
+    case GLITZ_FILTER_EDGE_COVERAGE:
+	break;
     }
 }
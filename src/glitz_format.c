@@ -197,6 +197,34 @@ _glitz_add_drawable_formats (glitz_gl_proc_address_list_t *gl,
 
 	    _glitz_add_drawable_format (&format, formats, n_formats);
 	}
+
+	/* single buffered as resolving replaces swapping */
+	if (feature_mask & GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK)
+	{
+	    glitz_gl_int_t samples = 0;
+
+	    gl->get_integer_v (GLITZ_GL_MAX_SAMPLES, &samples);
+	    if (samples > 4)
+		samples = 4;
+
+	    for (i = 0; samples > 1 && i < sizeof (d) / sizeof (d[0]); i++)
+	    {
+		if (d[i].doublebuffer)
+		    continue;
+
+		format.d         = d[i];
+		format.d.id      = *n_formats;
+		format.d.samples = samples;
+
+		_glitz_add_drawable_format (&format, formats, n_formats);
+
+		format.d.id           = *n_formats;
+		format.d.depth_size   = 24;
+		format.d.stencil_size = 8;
+
+		_glitz_add_drawable_format (&format, formats, n_formats);
+	    }
+	}
     }
 }
 
@@ -42,8 +42,30 @@ typedef struct _glitz_fbo_drawable {
     glitz_gl_uint_t  front_texture;
     glitz_gl_uint_t  back_texture;
     glitz_gl_enum_t  internal_format;
+    int              samples;
+    glitz_gl_enum_t  front_format;
+    glitz_gl_uint_t  resolve_fb;
 } glitz_fbo_drawable_t;
 
+static void
+_glitz_fbo_renderbuffer_storage (glitz_fbo_drawable_t *drawable,
+				 glitz_gl_enum_t      format)
+{
+    GLITZ_GL_DRAWABLE (drawable->other);
+
+    if (drawable->samples)
+	gl->renderbuffer_storage_multisample (GLITZ_GL_RENDERBUFFER,
+					      drawable->samples,
+					      format,
+					      drawable->base.width,
+					      drawable->base.height);
+    else
+	gl->renderbuffer_storage (GLITZ_GL_RENDERBUFFER,
+				  format,
+				  drawable->base.width,
+				  drawable->base.height);
+}
+
 static glitz_bool_t
 _glitz_fbo_bind (glitz_fbo_drawable_t *drawable)
 {
@@ -70,8 +92,25 @@ _glitz_fbo_bind (glitz_fbo_drawable_t *drawable)
 
     gl->bind_framebuffer (GLITZ_GL_FRAMEBUFFER, drawable->fb);
 
-    if (drawable->base.front &&
-	drawable->front_texture != drawable->base.front->texture.name)
+    /* multisampled drawables render into a renderbuffer of the front
+       surface's format and are resolved into its texture */
+    if (drawable->samples)
+    {
+	glitz_gl_enum_t format = drawable->internal_format;
+
+	if (drawable->base.front)
+	    format = drawable->base.front->texture.format;
+
+	if (drawable->front && (update || format != drawable->front_format))
+	{
+	    gl->delete_renderbuffers (1, &drawable->front);
+	    drawable->front = 0;
+	}
+
+	drawable->front_format = format;
+    }
+    else if (drawable->base.front &&
+	     drawable->front_texture != drawable->base.front->texture.name)
     {
 	gl->framebuffer_texture_2d (GLITZ_GL_FRAMEBUFFER,
 				    GLITZ_GL_COLOR_ATTACHMENT0,
@@ -92,10 +131,10 @@ _glitz_fbo_bind (glitz_fbo_drawable_t *drawable)
     {
 	gl->gen_renderbuffers (1, &drawable->front);
 	gl->bind_renderbuffer (GLITZ_GL_RENDERBUFFER, drawable->front);
-	gl->renderbuffer_storage (GLITZ_GL_RENDERBUFFER,
-				  drawable->internal_format,
-				  drawable->base.width,
-				  drawable->base.height);
+	_glitz_fbo_renderbuffer_storage (drawable,
+					 (drawable->samples)?
+					 drawable->front_format:
+					 drawable->internal_format);
 	gl->bind_renderbuffer (GLITZ_GL_RENDERBUFFER, 0);
 	gl->framebuffer_renderbuffer (GLITZ_GL_FRAMEBUFFER,
 				      GLITZ_GL_COLOR_ATTACHMENT0,
@@ -128,10 +167,8 @@ _glitz_fbo_bind (glitz_fbo_drawable_t *drawable)
 	    gl->gen_renderbuffers (1, &drawable->back);
 	    gl->bind_renderbuffer (GLITZ_GL_RENDERBUFFER,
 				   drawable->back);
-	    gl->renderbuffer_storage (GLITZ_GL_RENDERBUFFER,
-				      drawable->internal_format,
-				      drawable->base.width,
-				      drawable->base.height);
+	    _glitz_fbo_renderbuffer_storage (drawable,
+					     drawable->internal_format);
 	    gl->bind_renderbuffer (GLITZ_GL_RENDERBUFFER, 0);
 	    gl->framebuffer_renderbuffer (GLITZ_GL_FRAMEBUFFER,
 					  GLITZ_GL_COLOR_ATTACHMENT1,
@@ -148,10 +185,8 @@ _glitz_fbo_bind (glitz_fbo_drawable_t *drawable)
 		gl->gen_renderbuffers (1, &drawable->depth);
 
 	    gl->bind_renderbuffer (GLITZ_GL_RENDERBUFFER, drawable->depth);
-	    gl->renderbuffer_storage (GLITZ_GL_RENDERBUFFER,
-				      GLITZ_GL_DEPTH_COMPONENT,
-				      drawable->base.width,
-				      drawable->base.height);
+	    _glitz_fbo_renderbuffer_storage (drawable,
+					     GLITZ_GL_DEPTH_COMPONENT);
 	    gl->bind_renderbuffer (GLITZ_GL_RENDERBUFFER, 0);
 
 	    gl->framebuffer_renderbuffer (GLITZ_GL_FRAMEBUFFER,
@@ -167,10 +202,8 @@ _glitz_fbo_bind (glitz_fbo_drawable_t *drawable)
 
 	    gl->bind_renderbuffer (GLITZ_GL_RENDERBUFFER,
 				   drawable->stencil);
-	    gl->renderbuffer_storage (GLITZ_GL_RENDERBUFFER,
-				      GLITZ_GL_STENCIL_INDEX,
-				      drawable->base.width,
-				      drawable->base.height);
+	    _glitz_fbo_renderbuffer_storage (drawable,
+					     GLITZ_GL_STENCIL_INDEX);
 	    gl->bind_renderbuffer (GLITZ_GL_RENDERBUFFER, 0);
 
 	    gl->framebuffer_renderbuffer (GLITZ_GL_FRAMEBUFFER,
@@ -195,15 +228,13 @@ _glitz_fbo_attach_notify (void            *abstract_drawable,
 	abstract_drawable;
     glitz_texture_t      *texture;
 
-    GLITZ_GL_DRAWABLE (drawable->other);
-
     texture = &surface->texture;
     if (!TEXTURE_ALLOCATED (texture))
     {
 	drawable->other->backend->push_current (drawable->other, NULL,
 						GLITZ_ANY_CONTEXT_CURRENT,
 						NULL);
-	glitz_texture_allocate (gl, texture);
+	glitz_texture_memory_allocate (surface);
 	drawable->other->backend->pop_current (drawable->other);
 
 	if (!TEXTURE_ALLOCATED (texture))
@@ -295,6 +326,15 @@ _glitz_fbo_pop_current (void *abstract_drawable)
     return drawable->other->backend->pop_current (drawable->other);
 }
 
+static void
+_glitz_fbo_release_current (void *abstract_drawable)
+{
+    glitz_fbo_drawable_t *drawable = (glitz_fbo_drawable_t *)
+	abstract_drawable;
+
+    drawable->other->backend->release_current (drawable->other);
+}
+
 static void
 _glitz_fbo_make_current (void *abstract_drawable,
 			 void *abstract_context)
@@ -370,6 +410,9 @@ _glitz_fbo_destroy (void *abstract_drawable)
 	if (drawable->stencil)
 	    gl->delete_renderbuffers (1, &drawable->stencil);
 
+	if (drawable->resolve_fb)
+	    gl->delete_framebuffers (1, &drawable->resolve_fb);
+
 	drawable->other->backend->pop_current (drawable->other);
     }
 
@@ -422,6 +465,96 @@ _glitz_fbo_read_buffer (void                  *abstract_drawable,
     }
 }
 
+/* blits a region of a multisampled drawable into texture. the drawable
+   must be current and its read buffer selected. */
+void
+glitz_framebuffer_resolve (glitz_drawable_t *abstract_drawable,
+			   glitz_texture_t  *texture,
+			   int              x_drawable,
+			   int              y_drawable,
+			   int              width,
+			   int              height,
+			   int              x_texture,
+			   int              y_texture)
+{
+    glitz_fbo_drawable_t *drawable = (glitz_fbo_drawable_t *)
+	abstract_drawable;
+    glitz_gl_int_t       x, y, tx, ty;
+
+    GLITZ_GL_DRAWABLE (drawable->other);
+
+    if (!drawable->resolve_fb)
+	gl->gen_framebuffers (1, &drawable->resolve_fb);
+
+    gl->bind_framebuffer (GLITZ_GL_DRAW_FRAMEBUFFER, drawable->resolve_fb);
+    gl->framebuffer_texture_2d (GLITZ_GL_DRAW_FRAMEBUFFER,
+				GLITZ_GL_COLOR_ATTACHMENT0,
+				texture->target, texture->name, 0);
+
+    x  = x_drawable;
+    y  = drawable->base.height - y_drawable - height;
+    tx = texture->box.x1 + x_texture;
+    ty = texture->box.y2 - y_texture - height;
+
+    gl->blit_framebuffer (x, y, x + width, y + height,
+			  tx, ty, tx + width, ty + height,
+			  GLITZ_GL_COLOR_BUFFER_BIT, GLITZ_GL_NEAREST);
+
+    /* don't keep a reference to a texture that might go away */
+    gl->framebuffer_texture_2d (GLITZ_GL_DRAW_FRAMEBUFFER,
+				GLITZ_GL_COLOR_ATTACHMENT0,
+				texture->target, 0, 0);
+    gl->bind_framebuffer (GLITZ_GL_DRAW_FRAMEBUFFER, drawable->fb);
+}
+
+/* copies a region of src into the bound dst texture by reading src
+   through the resolve framebuffer. the drawable must be current. returns
+   0 if src can't be read that way. */
+glitz_bool_t
+glitz_framebuffer_copy_texture (glitz_drawable_t *abstract_drawable,
+				glitz_texture_t  *src,
+				glitz_texture_t  *dst,
+				int              x_src,
+				int              y_src,
+				int              width,
+				int              height,
+				int              x_dst,
+				int              y_dst)
+{
+    glitz_fbo_drawable_t *drawable = (glitz_fbo_drawable_t *)
+	abstract_drawable;
+    glitz_bool_t         complete;
+
+    GLITZ_GL_DRAWABLE (drawable->other);
+
+    if (!drawable->resolve_fb)
+	gl->gen_framebuffers (1, &drawable->resolve_fb);
+
+    gl->bind_framebuffer (GLITZ_GL_READ_FRAMEBUFFER, drawable->resolve_fb);
+    gl->framebuffer_texture_2d (GLITZ_GL_READ_FRAMEBUFFER,
+				GLITZ_GL_COLOR_ATTACHMENT0,
+				src->target, src->name, 0);
+
+    complete = (gl->check_framebuffer_status (GLITZ_GL_READ_FRAMEBUFFER) ==
+		GLITZ_GL_FRAMEBUFFER_COMPLETE);
+    if (complete)
+    {
+	gl->copy_tex_sub_image_2d (dst->target, 0,
+				   dst->box.x1 + x_dst,
+				   dst->box.y2 - y_dst - height,
+				   src->box.x1 + x_src,
+				   src->box.y2 - y_src - height,
+				   width, height);
+    }
+
+    gl->framebuffer_texture_2d (GLITZ_GL_READ_FRAMEBUFFER,
+				GLITZ_GL_COLOR_ATTACHMENT0,
+				src->target, 0, 0);
+    gl->bind_framebuffer (GLITZ_GL_READ_FRAMEBUFFER, drawable->fb);
+
+    return complete;
+}
+
 glitz_drawable_t *
 _glitz_fbo_drawable_create (glitz_drawable_t	        *other,
 			    glitz_int_drawable_format_t *format,
@@ -444,6 +577,8 @@ _glitz_fbo_drawable_create (glitz_drawable_t	        *other,
     backend->destroy         = _glitz_fbo_destroy;
     backend->push_current    = _glitz_fbo_push_current;
     backend->pop_current     = _glitz_fbo_pop_current;
+    if (other->backend->release_current)
+	backend->release_current = _glitz_fbo_release_current;
     backend->attach_notify   = _glitz_fbo_attach_notify;
     backend->detach_notify   = _glitz_fbo_detach_notify;
     backend->swap_buffers    = _glitz_fbo_swap_buffers;
@@ -465,6 +600,10 @@ _glitz_fbo_drawable_create (glitz_drawable_t	        *other,
     drawable->front_texture = 0;
     drawable->back_texture  = 0;
 
+    drawable->samples      = (format->d.samples > 1)? format->d.samples: 0;
+    drawable->front_format = 0;
+    drawable->resolve_fb   = 0;
+
     /* XXX: temporary solution until we have proper format validation */
     if (format->d.color.alpha_size)
 	drawable->internal_format = GLITZ_GL_RGBA;
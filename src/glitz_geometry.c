@@ -51,6 +51,8 @@ glitz_set_geometry (glitz_surface_t         *dst,
 		    glitz_geometry_format_t *format,
 		    glitz_buffer_t          *buffer)
 {
+    glitz_set_index_buffer (dst, NULL, NULL);
+
     switch (type) {
     case GLITZ_GEOMETRY_TYPE_VERTEX:
     {
@@ -104,7 +106,9 @@ glitz_set_geometry (glitz_surface_t         *dst,
 		_glitz_data_type (format->vertex.src.type);
 	    dst->geometry.u.v.src.offset = format->vertex.src.offset;
 
-	    if (format->vertex.src.size == GLITZ_COORDINATE_SIZE_XY)
+	    if (format->vertex.src.size == GLITZ_COORDINATE_SIZE_XYZW)
+		dst->geometry.u.v.src.size = 4;
+	    else if (format->vertex.src.size == GLITZ_COORDINATE_SIZE_XY)
 		dst->geometry.u.v.src.size = 2;
 	    else
 		dst->geometry.u.v.src.size = 1;
@@ -116,7 +120,9 @@ glitz_set_geometry (glitz_surface_t         *dst,
 		_glitz_data_type (format->vertex.mask.type);
 	    dst->geometry.u.v.mask.offset = format->vertex.mask.offset;
 
-	    if (format->vertex.mask.size == GLITZ_COORDINATE_SIZE_XY)
+	    if (format->vertex.mask.size == GLITZ_COORDINATE_SIZE_XYZW)
+		dst->geometry.u.v.mask.size = 4;
+	    else if (format->vertex.mask.size == GLITZ_COORDINATE_SIZE_XY)
 		dst->geometry.u.v.mask.size = 2;
 	    else
 		dst->geometry.u.v.mask.size = 1;
@@ -151,6 +157,8 @@ glitz_set_geometry (glitz_surface_t         *dst,
 	    break;
 	}
 
+	dst->geometry.u.b.repeat = 0;
+
 	dst->geometry.stride = format->bitmap.bytes_per_line;
 	dst->geometry.attributes = 0;
 	break;
@@ -166,6 +174,75 @@ glitz_set_geometry (glitz_surface_t         *dst,
 }
 slim_hidden_def(glitz_set_geometry);
 
+/* with an index buffer the first and count of each array select indices
+   instead of vertices. it is released by glitz_set_geometry. */
+void
+glitz_set_index_buffer (glitz_surface_t      *dst,
+			glitz_index_format_t *format,
+			glitz_buffer_t       *buffer)
+{
+    if (SURFACE_QUEUED (dst))
+	glitz_queue_sync (dst->drawable);
+
+    glitz_buffer_reference (buffer);
+    if (dst->geometry.index.buffer)
+	glitz_buffer_destroy (dst->geometry.index.buffer);
+    dst->geometry.index.buffer = buffer;
+
+    if (dst->geometry.index.restarts)
+	free (dst->geometry.index.restarts);
+
+    dst->geometry.index.restarts       = NULL;
+    dst->geometry.index.n_restarts     = 0;
+    dst->geometry.index.restarts_valid = 0;
+
+    if (!buffer)
+	return;
+
+    if (format->type == GLITZ_INDEX_TYPE_UNSIGNED_INT)
+    {
+	dst->geometry.index.type = GLITZ_GL_UNSIGNED_INT;
+	dst->geometry.index.size = 4;
+    }
+    else
+    {
+	dst->geometry.index.type = GLITZ_GL_UNSIGNED_SHORT;
+	dst->geometry.index.size = 2;
+    }
+
+    dst->geometry.index.restart       = format->primitive_restart;
+    dst->geometry.index.restart_index = format->restart_index;
+}
+slim_hidden_def(glitz_set_index_buffer);
+
+/* tiles the bitmap pattern of repeat by repeat bits at the first bit over
+   the geometry area. repeat must be 2, 4, 8, 16 or 32, anything else
+   turns tiling off. it is reset by glitz_set_geometry and ignored
+   unless bitmap geometry is set. */
+void
+glitz_set_bitmap_repeat (glitz_surface_t *dst,
+			 int             repeat)
+{
+    if (SURFACE_QUEUED (dst))
+	glitz_queue_sync (dst->drawable);
+
+    if (dst->geometry.type != GLITZ_GEOMETRY_TYPE_BITMAP)
+	return;
+
+    switch (repeat) {
+    case 2:
+    case 4:
+    case 8:
+    case 16:
+    case 32:
+	dst->geometry.u.b.repeat = repeat;
+	break;
+    default:
+	dst->geometry.u.b.repeat = 0;
+	break;
+    }
+}
+
 void
 glitz_set_array (glitz_surface_t    *dst,
 		 int                first,
@@ -174,6 +251,9 @@ glitz_set_array (glitz_surface_t    *dst,
 		 glitz_fixed16_16_t x_off,
 		 glitz_fixed16_16_t y_off)
 {
+    if (SURFACE_QUEUED (dst))
+	glitz_queue_sync (dst->drawable);
+
     if (dst->geometry.array)
     {
 	glitz_multi_array_destroy (dst->geometry.array);
@@ -227,8 +307,7 @@ glitz_multi_array_destroy (glitz_multi_array_t *array)
     if (!array)
 	return;
 
-    array->ref_count--;
-    if (array->ref_count)
+    if (GLITZ_ATOMIC_DEC (&array->ref_count))
 	return;
 
     free (array);
@@ -240,7 +319,7 @@ glitz_multi_array_reference (glitz_multi_array_t *array)
     if (array == NULL)
 	return;
 
-    array->ref_count++;
+    GLITZ_ATOMIC_INC (&array->ref_count);
 }
 
 void
@@ -287,6 +366,9 @@ glitz_set_multi_array (glitz_surface_t     *dst,
 		       glitz_fixed16_16_t  x_off,
 		       glitz_fixed16_16_t  y_off)
 {
+    if (SURFACE_QUEUED (dst))
+	glitz_queue_sync (dst->drawable);
+
     glitz_multi_array_reference (array);
 
     if (dst->geometry.array)
@@ -299,6 +381,44 @@ glitz_set_multi_array (glitz_surface_t     *dst,
 }
 slim_hidden_def(glitz_set_multi_array);
 
+#define PRIMITIVE_RESTART(surface)                      \
+    ((surface)->drawable->backend->feature_mask &       \
+     GLITZ_FEATURE_PRIMITIVE_RESTART_MASK)
+
+#define PRIMITIVE_RESTART_CAP(surface)                  \
+    (((surface)->drawable->backend->gl_version >= 3.1f)? \
+     GLITZ_GL_PRIMITIVE_RESTART: GLITZ_GL_PRIMITIVE_RESTART_NV)
+
+/* the index buffer is bound without glitz_buffer_bind so that a buffer
+   holding both vertices and indices keeps its vertex target */
+static void
+_glitz_geometry_bind_indices (glitz_gl_proc_address_list_t *gl,
+			      glitz_surface_t              *dst)
+{
+    glitz_buffer_t *buffer = dst->geometry.index.buffer;
+
+    if (buffer->drawable)
+    {
+	gl->bind_buffer (GLITZ_GL_ELEMENT_ARRAY_BUFFER, buffer->name);
+	dst->geometry.index.base = (glitz_gl_ubyte_t *) NULL + buffer->offset;
+    }
+    else
+	dst->geometry.index.base = buffer->data;
+}
+
+static void
+_glitz_geometry_enable_indices (glitz_gl_proc_address_list_t *gl,
+				glitz_surface_t              *dst)
+{
+    _glitz_geometry_bind_indices (gl, dst);
+
+    if (PRIMITIVE_RESTART (dst) && dst->geometry.index.restart)
+    {
+	gl->enable (PRIMITIVE_RESTART_CAP (dst));
+	gl->primitive_restart_index (dst->geometry.index.restart_index);
+    }
+}
+
 void
 glitz_geometry_enable_none (glitz_gl_proc_address_list_t *gl,
 			    glitz_surface_t              *dst,
@@ -321,11 +441,20 @@ glitz_geometry_enable (glitz_gl_proc_address_list_t *gl,
 		       glitz_surface_t              *dst,
 		       glitz_box_t                  *box)
 {
+    if (dst->geometry.path)
+    {
+	glitz_path_enable (gl, dst, box);
+	glitz_geometry_enable_none (gl, dst, box);
+	return;
+    }
+
     switch (dst->geometry.type) {
     case GLITZ_GEOMETRY_TYPE_VERTEX:
 	gl->vertex_pointer (2, dst->geometry.u.v.type, dst->geometry.stride,
 			    glitz_buffer_bind (dst->geometry.buffer,
 					       GLITZ_GL_ARRAY_BUFFER));
+	if (dst->geometry.index.buffer)
+	    _glitz_geometry_enable_indices (gl, dst);
 	break;
     case GLITZ_GEOMETRY_TYPE_BITMAP:
 	dst->geometry.u.b.base =
@@ -350,55 +479,437 @@ glitz_geometry_enable (glitz_gl_proc_address_list_t *gl,
 void
 glitz_geometry_disable (glitz_surface_t *dst)
 {
+    if (dst->geometry.type == GLITZ_GEOMETRY_TYPE_VERTEX &&
+	dst->geometry.index.buffer)
+    {
+	GLITZ_GL_SURFACE (dst);
+
+	if (dst->geometry.index.buffer->drawable)
+	    gl->bind_buffer (GLITZ_GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	if (PRIMITIVE_RESTART (dst) && dst->geometry.index.restart)
+	    gl->disable (PRIMITIVE_RESTART_CAP (dst));
+    }
+
     if (dst->geometry.buffer)
 	glitz_buffer_unbind (dst->geometry.buffer);
 }
 
+/* with more than one clip box the clip region is rasterized into the
+   stencil buffer once per clip change, using scissored clears so that no
+   other GL state is touched. geometry is then drawn once, scissored to
+   the clip extents, which are returned in clip coordinates. */
+static glitz_bool_t
+_glitz_geometry_stencil_clip (glitz_gl_proc_address_list_t *gl,
+			      glitz_surface_t              *dst,
+			      glitz_box_t                  *extents)
+{
+    glitz_drawable_t *drawable = dst->attached;
+    glitz_box_t      *clip = dst->clip;
+    int              n_clip = dst->n_clip;
+
+    if (n_clip < 2 || !drawable->format->d.stencil_size)
+	return 0;
+
+    if (drawable->stencil_clip_serial != dst->clip_serial ||
+	drawable->stencil_clip_x      != dst->x           ||
+	drawable->stencil_clip_y      != dst->y           ||
+	drawable->stencil_clip_height != drawable->height)
+    {
+	glitz_box_t box;
+
+	gl->scissor (dst->x, drawable->height - dst->y - dst->box.y2,
+		     dst->box.x2, dst->box.y2);
+	gl->clear_stencil (0);
+	gl->clear (GLITZ_GL_STENCIL_BUFFER_BIT);
+
+	gl->clear_stencil (1);
+
+	while (n_clip--)
+	{
+	    box.x1 = MAX (clip->x1 + dst->x_clip, 0);
+	    box.y1 = MAX (clip->y1 + dst->y_clip, 0);
+	    box.x2 = MIN (clip->x2 + dst->x_clip, dst->box.x2);
+	    box.y2 = MIN (clip->y2 + dst->y_clip, dst->box.y2);
+
+	    if (box.x1 < box.x2 && box.y1 < box.y2)
+	    {
+		gl->scissor (box.x1 + dst->x,
+			     drawable->height - dst->y - box.y2,
+			     box.x2 - box.x1, box.y2 - box.y1);
+		gl->clear (GLITZ_GL_STENCIL_BUFFER_BIT);
+	    }
+
+	    clip++;
+	}
+
+	drawable->stencil_clip_serial = dst->clip_serial;
+	drawable->stencil_clip_x      = dst->x;
+	drawable->stencil_clip_y      = dst->y;
+	drawable->stencil_clip_height = drawable->height;
+
+	clip   = dst->clip;
+	n_clip = dst->n_clip;
+    }
+
+    *extents = *clip;
+    while (--n_clip)
+    {
+	clip++;
+	extents->x1 = MIN (extents->x1, clip->x1);
+	extents->y1 = MIN (extents->y1, clip->y1);
+	extents->x2 = MAX (extents->x2, clip->x2);
+	extents->y2 = MAX (extents->y2, clip->y2);
+    }
+
+    gl->enable (GLITZ_GL_STENCIL_TEST);
+    gl->stencil_func (GLITZ_GL_EQUAL, 1, 1);
+    gl->stencil_op (GLITZ_GL_KEEP, GLITZ_GL_KEEP, GLITZ_GL_KEEP);
+
+    return 1;
+}
+
 static void
-_glitz_draw_rectangle (glitz_gl_proc_address_list_t *gl,
-		       glitz_surface_t              *dst,
-		       glitz_box_t                  *bounds,
-		       int                          damage)
+_glitz_geometry_stencil_clip_done (glitz_gl_proc_address_list_t *gl,
+				   glitz_surface_t              *dst,
+				   glitz_box_t                  *bounds,
+				   int                          damage)
 {
     glitz_box_t *clip = dst->clip;
     int         n_clip = dst->n_clip;
     glitz_box_t box;
 
+    gl->disable (GLITZ_GL_STENCIL_TEST);
+
+    if (!damage)
+	return;
+
     while (n_clip--)
     {
-	box.x1 = clip->x1 + dst->x_clip;
-	box.y1 = clip->y1 + dst->y_clip;
-	box.x2 = clip->x2 + dst->x_clip;
-	box.y2 = clip->y2 + dst->y_clip;
-	if (bounds->x1 > box.x1)
-	    box.x1 = bounds->x1;
-	if (bounds->y1 > box.y1)
-	    box.y1 = bounds->y1;
-	if (bounds->x2 < box.x2)
-	    box.x2 = bounds->x2;
-	if (bounds->y2 < box.y2)
-	    box.y2 = bounds->y2;
+	box.x1 = MAX (clip->x1 + dst->x_clip, bounds->x1);
+	box.y1 = MAX (clip->y1 + dst->y_clip, bounds->y1);
+	box.x2 = MIN (clip->x2 + dst->x_clip, bounds->x2);
+	box.y2 = MIN (clip->y2 + dst->y_clip, bounds->y2);
 
 	if (box.x1 < box.x2 && box.y1 < box.y2)
+	    glitz_surface_damage (dst, &box, damage);
+
+	clip++;
+    }
+}
+
+#define N_STACK_BOXES 16
+
+/* clips boxes against the clip region on the CPU and draws all
+   resulting rectangles as quads with a single draw call. texture
+   coordinates are generated from vertex positions so they need no
+   adjustment. */
+glitz_bool_t
+glitz_geometry_draw_boxes (glitz_gl_proc_address_list_t *gl,
+			   glitz_surface_t              *dst,
+			   glitz_box_t                  *boxes,
+			   int                          n_boxes,
+			   int                          damage)
+{
+    glitz_float_t stack_data[N_STACK_BOXES * 8], *data, *ptr = stack_data;
+    glitz_box_t   box, *clip, extents;
+    int           i, n_clip, vertices = 0;
+    unsigned int  size, offset;
+    glitz_bool_t  streamed = 0;
+
+    if (n_boxes * dst->n_clip > N_STACK_BOXES)
+    {
+	size = n_boxes * dst->n_clip * 8 * sizeof (glitz_float_t);
+
+	ptr = glitz_stream_map_vertices (dst->drawable, size, &offset);
+	if (ptr)
+	    streamed = 1;
+	else
 	{
-	    gl->scissor (box.x1 + dst->x,
-			 dst->attached->height - dst->y - box.y2,
-			 box.x2 - box.x1, box.y2 - box.y1);
+	    ptr = malloc (size);
+	    if (!ptr)
+		return 0;
+	}
+    }
 
-	    gl->draw_arrays (GLITZ_GL_QUADS, 0, 4);
+    data = ptr;
 
-	    if (damage)
-		glitz_surface_damage (dst, &box, damage);
+    extents.x1 = extents.y1 = SHRT_MAX;
+    extents.x2 = extents.y2 = SHRT_MIN;
+
+    for (i = 0; i < n_boxes; i++)
+    {
+	clip   = dst->clip;
+	n_clip = dst->n_clip;
+
+	while (n_clip--)
+	{
+	    box.x1 = MAX (clip->x1 + dst->x_clip, boxes[i].x1);
+	    box.y1 = MAX (clip->y1 + dst->y_clip, boxes[i].y1);
+	    box.x2 = MIN (clip->x2 + dst->x_clip, boxes[i].x2);
+	    box.y2 = MIN (clip->y2 + dst->y_clip, boxes[i].y2);
+
+	    if (box.x1 < box.x2 && box.y1 < box.y2)
+	    {
+		*data++ = (glitz_float_t) box.x1;
+		*data++ = (glitz_float_t) box.y1;
+		*data++ = (glitz_float_t) box.x2;
+		*data++ = (glitz_float_t) box.y1;
+		*data++ = (glitz_float_t) box.x2;
+		*data++ = (glitz_float_t) box.y2;
+		*data++ = (glitz_float_t) box.x1;
+		*data++ = (glitz_float_t) box.y2;
+
+		vertices += 4;
+
+		extents.x1 = MIN (extents.x1, box.x1);
+		extents.y1 = MIN (extents.y1, box.y1);
+		extents.x2 = MAX (extents.x2, box.x2);
+		extents.y2 = MAX (extents.y2, box.y2);
+
+		if (damage)
+		    glitz_surface_damage (dst, &box, damage);
+	    }
+
+	    clip++;
 	}
+    }
 
-	clip++;
+    if (streamed)
+	ptr = glitz_stream_bind_vertices (dst->drawable, offset);
+
+    if (vertices)
+    {
+	gl->scissor (extents.x1 + dst->x,
+		     dst->attached->height - dst->y - extents.y2,
+		     extents.x2 - extents.x1,
+		     extents.y2 - extents.y1);
+
+	gl->vertex_pointer (2, GLITZ_GL_FLOAT, 0, ptr);
+	gl->draw_arrays (GLITZ_GL_QUADS, 0, vertices);
     }
+
+    if (streamed)
+	glitz_stream_unbind_vertices (dst->drawable, offset);
+    else if (ptr != stack_data)
+	free (ptr);
+
+    if (vertices)
+	gl->vertex_pointer (2, GLITZ_GL_FLOAT, 0, dst->geometry.data);
+
+    return 1;
+}
+
+static void
+_glitz_draw_rectangle (glitz_gl_proc_address_list_t *gl,
+		       glitz_surface_t              *dst,
+		       glitz_box_t                  *bounds,
+		       int                          damage)
+{
+    if (!glitz_geometry_draw_boxes (gl, dst, bounds, 1, damage))
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
 }
 
 #define MULTI_DRAW_ARRAYS(surface)                      \
     ((surface)->drawable->backend->feature_mask &       \
      GLITZ_FEATURE_MULTI_DRAW_ARRAYS_MASK)
 
+/* positions of the restart index in a GL index buffer. they are read
+   back once for each serial of the buffer instead of on every draw.
+   the buffer is already bound to the element array target and the
+   drawable is current, so it's mapped directly. */
+static glitz_bool_t
+_glitz_geometry_find_restarts (glitz_gl_proc_address_list_t *gl,
+			       glitz_surface_t              *dst)
+{
+    glitz_index_info_t *index = &dst->geometry.index;
+    glitz_buffer_t     *buffer = index->buffer;
+    glitz_gl_uint_t    value;
+    unsigned int       i, n;
+    int                *restarts = NULL, n_restarts = 0, size = 0;
+    void               *indices;
+
+    if (index->restarts_valid && index->restarts_serial == buffer->serial)
+	return 1;
+
+    if (index->restarts)
+	free (index->restarts);
+
+    index->restarts       = NULL;
+    index->n_restarts     = 0;
+    index->restarts_valid = 0;
+
+    indices = gl->map_buffer (GLITZ_GL_ELEMENT_ARRAY_BUFFER,
+			      GLITZ_GL_READ_ONLY);
+    if (!indices)
+	return 0;
+
+    indices = (char *) indices + buffer->offset;
+
+    n = buffer->size / index->size;
+    for (i = 0; i < n; i++)
+    {
+	if (index->size == 4)
+	    value = ((glitz_gl_uint_t *) indices)[i];
+	else
+	    value = ((glitz_gl_ushort_t *) indices)[i];
+
+	if (value != index->restart_index)
+	    continue;
+
+	if (n_restarts == size)
+	{
+	    int *new_restarts;
+
+	    size = (size)? size << 1: 64;
+	    new_restarts = realloc (restarts, size * sizeof (int));
+	    if (!new_restarts)
+	    {
+		gl->unmap_buffer (GLITZ_GL_ELEMENT_ARRAY_BUFFER);
+		free (restarts);
+		return 0;
+	    }
+
+	    restarts = new_restarts;
+	}
+
+	restarts[n_restarts++] = i;
+    }
+
+    gl->unmap_buffer (GLITZ_GL_ELEMENT_ARRAY_BUFFER);
+
+    index->restarts        = restarts;
+    index->n_restarts      = n_restarts;
+    index->restarts_serial = buffer->serial;
+    index->restarts_valid  = 1;
+
+    return 1;
+}
+
+/* without hardware primitive restart the index range is split into runs
+   on the CPU. stream buffers are write-only and can't be split. */
+static void
+_glitz_draw_restart_elements (glitz_gl_proc_address_list_t *gl,
+			      glitz_surface_t              *dst,
+			      int                          first,
+			      int                          count)
+{
+    glitz_index_info_t *index = &dst->geometry.index;
+    glitz_buffer_t     *buffer = index->buffer;
+    glitz_gl_uint_t    value;
+    int                i, lo, hi, start = first, end = first + count;
+
+#define DRAW_RUN(_start, _count)					\
+    gl->draw_elements (dst->geometry.u.v.prim, (_count), index->type,	\
+		       index->base + (_start) * index->size)
+
+    if (buffer->streamed)
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	return;
+    }
+
+    if (buffer->drawable)
+    {
+	if (!_glitz_geometry_find_restarts (gl, dst))
+	{
+	    glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	    return;
+	}
+
+	lo = 0;
+	hi = index->n_restarts;
+	while (lo < hi)
+	{
+	    i = (lo + hi) >> 1;
+	    if (index->restarts[i] < first)
+		lo = i + 1;
+	    else
+		hi = i;
+	}
+
+	for (i = lo; i < index->n_restarts && index->restarts[i] < end; i++)
+	{
+	    if (index->restarts[i] > start)
+		DRAW_RUN (start, index->restarts[i] - start);
+
+	    start = index->restarts[i] + 1;
+	}
+    }
+    else
+    {
+	for (i = first; i < end; i++)
+	{
+	    if (index->size == 4)
+		value = ((glitz_gl_uint_t *) buffer->data)[i];
+	    else
+		value = ((glitz_gl_ushort_t *) buffer->data)[i];
+
+	    if (value != index->restart_index)
+		continue;
+
+	    if (i > start)
+		DRAW_RUN (start, i - start);
+
+	    start = i + 1;
+	}
+    }
+
+    if (end > start)
+	DRAW_RUN (start, end - start);
+
+#undef DRAW_RUN
+}
+
+#define N_STACK_OFFSETS 16
+
+static void
+_glitz_draw_elements (glitz_gl_proc_address_list_t *gl,
+		      glitz_surface_t              *dst,
+		      int                          *first,
+		      int                          *count,
+		      int                          n)
+{
+    glitz_index_info_t    *index = &dst->geometry.index;
+    const glitz_gl_void_t *stack_offsets[N_STACK_OFFSETS], **offsets;
+    int                   i;
+
+    if (index->restart && !PRIMITIVE_RESTART (dst))
+    {
+	for (i = 0; i < n; i++)
+	    if (count[i])
+		_glitz_draw_restart_elements (gl, dst, first[i], count[i]);
+
+	return;
+    }
+
+    if (n > 1 && MULTI_DRAW_ARRAYS (dst))
+    {
+	offsets = stack_offsets;
+	if (n > N_STACK_OFFSETS)
+	    offsets = malloc (n * sizeof (glitz_gl_void_t *));
+
+	if (offsets)
+	{
+	    for (i = 0; i < n; i++)
+		offsets[i] = index->base + first[i] * index->size;
+
+	    gl->multi_draw_elements (dst->geometry.u.v.prim, count,
+				     index->type, offsets, n);
+
+	    if (offsets != stack_offsets)
+		free (offsets);
+
+	    return;
+	}
+    }
+
+    for (i = 0; i < n; i++)
+	if (count[i])
+	    gl->draw_elements (dst->geometry.u.v.prim, count[i], index->type,
+			       index->base + first[i] * index->size);
+}
+
 static void
 _glitz_draw_vertex_arrays (glitz_gl_proc_address_list_t *gl,
 			   glitz_surface_t              *dst,
@@ -408,7 +919,15 @@ _glitz_draw_vertex_arrays (glitz_gl_proc_address_list_t *gl,
     glitz_multi_array_t *array = dst->geometry.array;
     glitz_box_t         *clip = dst->clip;
     int                 i, n_clip = dst->n_clip;
-    glitz_box_t         box;
+    glitz_box_t         box, extents;
+    glitz_bool_t        stencil;
+
+    stencil = _glitz_geometry_stencil_clip (gl, dst, &extents);
+    if (stencil)
+    {
+	clip = &extents;
+	n_clip = 1;
+    }
 
     while (n_clip--)
     {
@@ -444,7 +963,15 @@ _glitz_draw_vertex_arrays (glitz_gl_proc_address_list_t *gl,
 		    gl->translate_f (array->off[i].v[0],
 				     array->off[i].v[1], 0.0f);
 
-		    if (MULTI_DRAW_ARRAYS (dst))
+		    if (dst->geometry.index.buffer)
+		    {
+			_glitz_draw_elements (gl, dst,
+					      &array->first[i],
+					      &array->count[i],
+					      array->span[i]);
+			i += array->span[i];
+		    }
+		    else if (MULTI_DRAW_ARRAYS (dst))
 		    {
 			gl->multi_draw_arrays (dst->geometry.u.v.prim,
 					       &array->first[i],
@@ -463,19 +990,27 @@ _glitz_draw_vertex_arrays (glitz_gl_proc_address_list_t *gl,
 			} while (array->span[++i] == 0);
 		    }
 		}
-	    } else
+	    }
+	    else if (dst->geometry.index.buffer)
+		_glitz_draw_elements (gl, dst,
+				      &dst->geometry.first,
+				      &dst->geometry.count, 1);
+	    else
 		gl->draw_arrays (dst->geometry.u.v.prim,
 				 dst->geometry.first,
 				 dst->geometry.count);
 
 	    gl->pop_matrix ();
 
-	    if (damage)
+	    if (damage && !stencil)
 		glitz_surface_damage (dst, &box, damage);
 	}
 
 	clip++;
     }
+
+    if (stencil)
+	_glitz_geometry_stencil_clip_done (gl, dst, bounds, damage);
 }
 
 #define N_STACK_BITMAP 128
@@ -511,11 +1046,186 @@ _glitz_draw_vertex_arrays (glitz_gl_proc_address_list_t *gl,
 	(_b_off) = 0;                                                   \
     }
 
-/* TODO: clipping could be done without glScissor, that might be
-   faster. Other then solid colors can be used if bitmap fits into a
-   stipple pattern. Maybe we should add a repeat parameter to
-   glitz_bitmap_format_t as 2, 4, 8, 16 and 32 sized bitmaps can be tiled.
-*/
+#define N_STACK_QUADS 16
+
+/* bitmaps are drawn as quads textured with a cached alpha copy of the
+   bits and alpha tested, so only set bits reach the blender. this can't
+   be used when the fragment alpha is zero. */
+static glitz_bool_t
+_glitz_draw_bitmap_textures (glitz_gl_proc_address_list_t *gl,
+			     glitz_surface_t              *dst,
+			     glitz_box_t                  *bounds,
+			     int                          damage)
+{
+    glitz_multi_array_t *array = dst->geometry.array;
+    glitz_box_t         *clip = dst->clip;
+    int                 n_clip = dst->n_clip;
+    glitz_texture_t     *stack_textures[N_STACK_QUADS], **textures;
+    glitz_float_t       stack_data[N_STACK_QUADS * 16], *data, *v;
+    glitz_gl_ubyte_t    *bits = NULL;
+    glitz_texture_t     *texture, *bound;
+    glitz_float_t       x, y, s, t_top, t_bottom, tile_h;
+    glitz_box_t         box, extents;
+    glitz_bool_t        stencil;
+    int                 i, j, n, w, h, first;
+
+    if (dst->geometry.u.b.alpha < 0x100)
+	return 0;
+
+    n = (array)? array->n_arrays: 1;
+
+    textures = stack_textures;
+    data = stack_data;
+    if (n > N_STACK_QUADS)
+    {
+	textures = malloc (n * (sizeof (glitz_texture_t *) +
+				sizeof (glitz_float_t) * 16));
+	if (!textures)
+	    return 0;
+
+	data = (glitz_float_t *) (textures + n);
+    }
+
+    x = dst->geometry.off.v[0];
+    y = dst->geometry.off.v[1];
+
+    for (i = 0, v = data; i < n; i++, v += 16)
+    {
+	if (array)
+	{
+	    x += array->off[i].v[0];
+	    y += array->off[i].v[1];
+	    first = array->first[i];
+	    w = array->sizes[i];
+	    h = array->count[i];
+	}
+	else
+	{
+	    first = dst->geometry.first;
+	    w = dst->geometry.size;
+	    h = dst->geometry.count;
+	}
+
+	textures[i] = NULL;
+	if (w < 1 || h < 1)
+	    continue;
+
+	texture = glitz_bitmap_get_texture (gl, dst, first, w, h, &bits);
+	if (!texture)
+	    break;
+
+	textures[i] = texture;
+
+	/* texture rows are stored bottom up. repeated patterns are anchored
+	   at the first row in memory, just like a bitmap holding the tiled
+	   pattern would be. */
+	tile_h = (dst->geometry.u.b.repeat)? dst->geometry.u.b.repeat: h;
+
+	s = w * texture->texcoord_width_unit;
+	if (dst->geometry.u.b.top_down)
+	{
+	    t_top    = tile_h;
+	    t_bottom = tile_h - h;
+	}
+	else
+	{
+	    t_top    = h;
+	    t_bottom = 0.0f;
+	}
+
+	t_top    *= texture->texcoord_height_unit;
+	t_bottom *= texture->texcoord_height_unit;
+
+	v[0]  = x;     v[1]  = y;     v[2]  = 0.0f; v[3]  = t_top;
+	v[4]  = x + w; v[5]  = y;     v[6]  = s;    v[7]  = t_top;
+	v[8]  = x + w; v[9]  = y + h; v[10] = s;    v[11] = t_bottom;
+	v[12] = x;     v[13] = y + h; v[14] = 0.0f; v[15] = t_bottom;
+    }
+
+    if (bits)
+	glitz_buffer_unmap (dst->geometry.buffer);
+
+    if (i < n)
+    {
+	if (textures != stack_textures)
+	    free (textures);
+
+	return 0;
+    }
+
+    gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
+		   GLITZ_GL_MODULATE);
+
+    gl->enable (GLITZ_GL_ALPHA_TEST);
+    gl->alpha_func (GLITZ_GL_GREATER, 0.0f);
+
+    gl->vertex_pointer (2, GLITZ_GL_FLOAT, 4 * sizeof (glitz_float_t), data);
+    gl->tex_coord_pointer (2, GLITZ_GL_FLOAT, 4 * sizeof (glitz_float_t),
+			   data + 2);
+    gl->enable_client_state (GLITZ_GL_TEXTURE_COORD_ARRAY);
+
+    stencil = _glitz_geometry_stencil_clip (gl, dst, &extents);
+    if (stencil)
+    {
+	clip = &extents;
+	n_clip = 1;
+    }
+
+    bound = NULL;
+    while (n_clip--)
+    {
+	box.x1 = MAX (clip->x1 + dst->x_clip, bounds->x1);
+	box.y1 = MAX (clip->y1 + dst->y_clip, bounds->y1);
+	box.x2 = MIN (clip->x2 + dst->x_clip, bounds->x2);
+	box.y2 = MIN (clip->y2 + dst->y_clip, bounds->y2);
+
+	if (box.x1 < box.x2 && box.y1 < box.y2)
+	{
+	    gl->scissor (box.x1 + dst->x,
+			 dst->attached->height - dst->y - box.y2,
+			 box.x2 - box.x1, box.y2 - box.y1);
+
+	    /* runs of the same bitmap are drawn with one call */
+	    for (i = 0; i < n; i = j)
+	    {
+		for (j = i + 1; j < n && textures[j] == textures[i]; j++);
+
+		if (!textures[i])
+		    continue;
+
+		if (textures[i] != bound)
+		{
+		    bound = textures[i];
+		    glitz_texture_bind (gl, bound);
+		}
+
+		gl->draw_arrays (GLITZ_GL_QUADS, i * 4, (j - i) * 4);
+	    }
+
+	    if (damage && !stencil)
+		glitz_surface_damage (dst, &box, damage);
+	}
+
+	clip++;
+    }
+
+    if (stencil)
+	_glitz_geometry_stencil_clip_done (gl, dst, bounds, damage);
+
+    if (bound)
+	glitz_texture_unbind (gl, bound);
+
+    gl->disable_client_state (GLITZ_GL_TEXTURE_COORD_ARRAY);
+    gl->disable (GLITZ_GL_ALPHA_TEST);
+
+    gl->vertex_pointer (2, GLITZ_GL_FLOAT, 0, dst->geometry.data);
+
+    if (textures != stack_textures)
+	free (textures);
+
+    return 1;
+}
+
 static void
 _glitz_draw_bitmap_arrays (glitz_gl_proc_address_list_t *gl,
 			   glitz_surface_t              *dst,
@@ -528,10 +1238,25 @@ _glitz_draw_bitmap_arrays (glitz_gl_proc_address_list_t *gl,
     int                 x, y, w, h, min_stride, dst_stride, src_stride;
     glitz_gl_ubyte_t    *heap_bitmap = NULL;
     glitz_gl_ubyte_t    stack_bitmap[N_STACK_BITMAP];
-    glitz_gl_ubyte_t    *base, *bitmap = dst->geometry.u.b.base;
+    glitz_gl_ubyte_t    *base, *bitmap;
     int                 byte_offset, pixel_offset = 0;
     glitz_float_t       x_off, y_off;
-    glitz_box_t         box;
+    glitz_box_t         box, extents;
+    glitz_bool_t        stencil = 0;
+
+    if (_glitz_draw_bitmap_textures (gl, dst, bounds, damage))
+	return;
+
+    if (dst->geometry.u.b.repeat)
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	return;
+    }
+
+    /* the texture path may have unbound the buffer */
+    dst->geometry.u.b.base = bitmap =
+	glitz_buffer_bind (dst->geometry.buffer,
+			   GLITZ_GL_PIXEL_UNPACK_BUFFER);
 
     if (dst->geometry.u.b.top_down)
     {
@@ -579,6 +1304,13 @@ _glitz_draw_bitmap_arrays (glitz_gl_proc_address_list_t *gl,
 			   dst->geometry.stride * 8);
     }
 
+    stencil = _glitz_geometry_stencil_clip (gl, dst, &extents);
+    if (stencil)
+    {
+	clip = &extents;
+	n_clip = 1;
+    }
+
     while (n_clip--)
     {
 	box.x1 = clip->x1 + dst->x_clip;
@@ -648,13 +1380,16 @@ _glitz_draw_bitmap_arrays (glitz_gl_proc_address_list_t *gl,
 			    bitmap + byte_offset);
 	    }
 
-	    if (damage)
+	    if (damage && !stencil)
 		glitz_surface_damage (dst, &box, damage);
 	}
 
 	clip++;
     }
 
+    if (stencil)
+	_glitz_geometry_stencil_clip_done (gl, dst, bounds, damage);
+
     if (heap_bitmap)
 	free (heap_bitmap);
 }
@@ -666,6 +1401,12 @@ glitz_geometry_draw_arrays (glitz_gl_proc_address_list_t *gl,
 			    glitz_box_t                  *bounds,
 			    int                          damage)
 {
+    if (dst->geometry.path)
+    {
+	glitz_path_draw (gl, dst, bounds, damage);
+	return;
+    }
+
     switch (type) {
     case GLITZ_GEOMETRY_TYPE_VERTEX:
 	_glitz_draw_vertex_arrays (gl, dst, bounds, damage);
@@ -52,6 +52,13 @@ typedef float glitz_gl_clampf_t;
 typedef unsigned char glitz_gl_ubyte_t;
 typedef ptrdiff_t glitz_gl_intptr_t;
 typedef ptrdiff_t glitz_gl_sizeiptr_t;
+typedef struct _glitz_gl_sync *glitz_gl_sync_t;
+
+#ifdef _MSC_VER
+typedef unsigned __int64 glitz_gl_uint64_t;
+#else
+typedef unsigned long long glitz_gl_uint64_t;
+#endif
 
 
 #define GLITZ_GL_FALSE 0x0
@@ -81,9 +88,11 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_MODELVIEW  0x1700
 #define GLITZ_GL_PROJECTION 0x1701
 
-#define GLITZ_GL_SHORT  0x1402
-#define GLITZ_GL_INT    0x1404
-#define GLITZ_GL_FLOAT  0x1406
+#define GLITZ_GL_SHORT          0x1402
+#define GLITZ_GL_UNSIGNED_SHORT 0x1403
+#define GLITZ_GL_INT            0x1404
+#define GLITZ_GL_UNSIGNED_INT   0x1405
+#define GLITZ_GL_FLOAT          0x1406
 #define GLITZ_GL_DOUBLE 0x140A
 
 #define GLITZ_GL_POINTS         0x0000
@@ -184,14 +193,18 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_DOT3_RGBA      0x86AF
 
 #define GLITZ_GL_STENCIL_TEST 0x0B90
+#define GLITZ_GL_ALPHA_TEST   0x0BC0
 #define GLITZ_GL_KEEP         0x1E00
 #define GLITZ_GL_REPLACE      0x1E01
 #define GLITZ_GL_INCR         0x1E02
 #define GLITZ_GL_DECR         0x1E03
+#define GLITZ_GL_INVERT       0x150A
 
 #define GLITZ_GL_LESS       0x0201
 #define GLITZ_GL_EQUAL      0x0202
 #define GLITZ_GL_LEQUAL     0x0203
+#define GLITZ_GL_GREATER    0x0204
+#define GLITZ_GL_NOTEQUAL   0x0205
 #define GLITZ_GL_ALWAYS     0x0207
 #define GLITZ_GL_DEPTH_TEST 0x0B71
 
@@ -199,6 +212,7 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_VIEWPORT_BIT       0x00000800
 #define GLITZ_GL_TRANSFORM_BIT      0x00001000
 #define GLITZ_GL_COLOR_BUFFER_BIT   0x00004000
+#define GLITZ_GL_SCISSOR_BIT        0x00080000
 
 #define GLITZ_GL_STENCIL_INDEX   0x1901
 #define GLITZ_GL_DEPTH_COMPONENT 0x1902
@@ -308,9 +322,13 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_MAX_PROGRAM_NATIVE_TEX_INDIRECTIONS 0x8810
 
 #define GLITZ_GL_ARRAY_BUFFER         0x8892
+#define GLITZ_GL_ELEMENT_ARRAY_BUFFER 0x8893
 #define GLITZ_GL_PIXEL_PACK_BUFFER    0x88EB
 #define GLITZ_GL_PIXEL_UNPACK_BUFFER  0x88EC
 
+#define GLITZ_GL_PRIMITIVE_RESTART_NV 0x8558
+#define GLITZ_GL_PRIMITIVE_RESTART    0x8F9D
+
 #define GLITZ_GL_STREAM_DRAW  0x88E0
 #define GLITZ_GL_STREAM_READ  0x88E1
 #define GLITZ_GL_STREAM_COPY  0x88E2
@@ -325,6 +343,23 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_WRITE_ONLY 0x88B9
 #define GLITZ_GL_READ_WRITE 0x88BA
 
+#define GLITZ_GL_MAP_READ_BIT              0x0001
+#define GLITZ_GL_MAP_WRITE_BIT             0x0002
+#define GLITZ_GL_MAP_INVALIDATE_RANGE_BIT  0x0004
+#define GLITZ_GL_MAP_FLUSH_EXPLICIT_BIT    0x0010
+#define GLITZ_GL_MAP_UNSYNCHRONIZED_BIT    0x0020
+#define GLITZ_GL_MAP_PERSISTENT_BIT        0x0040
+#define GLITZ_GL_MAP_COHERENT_BIT          0x0080
+#define GLITZ_GL_DYNAMIC_STORAGE_BIT       0x0100
+
+#define GLITZ_GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GLITZ_GL_SYNC_FLUSH_COMMANDS_BIT    0x0001
+#define GLITZ_GL_ALREADY_SIGNALED           0x911A
+#define GLITZ_GL_TIMEOUT_EXPIRED            0x911B
+#define GLITZ_GL_CONDITION_SATISFIED        0x911C
+#define GLITZ_GL_WAIT_FAILED                0x911D
+#define GLITZ_GL_TIMEOUT_IGNORED            (~(glitz_gl_uint64_t) 0)
+
 #define GLITZ_GL_FRAMEBUFFER  0x8D40
 #define GLITZ_GL_RENDERBUFFER 0x8D41
 
@@ -351,6 +386,12 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_RENDERBUFFER_DEPTH_SIZE   0x8D54
 #define GLITZ_GL_RENDERBUFFER_STENCIL_SIZE 0x8D55
 
+#define GLITZ_GL_FRAMEBUFFER_BINDING 0x8CA6
+
+#define GLITZ_GL_READ_FRAMEBUFFER 0x8CA8
+#define GLITZ_GL_DRAW_FRAMEBUFFER 0x8CA9
+#define GLITZ_GL_MAX_SAMPLES      0x8D57
+
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_enable_t)
      (glitz_gl_enum_t cap);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_disable_t)
@@ -374,6 +415,13 @@ typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_draw_arrays_t)
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_multi_draw_arrays_t)
      (glitz_gl_enum_t mode, glitz_gl_int_t *first, glitz_gl_sizei_t *count,
       glitz_gl_sizei_t primcount);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_draw_elements_t)
+     (glitz_gl_enum_t mode, glitz_gl_sizei_t count, glitz_gl_enum_t type,
+      const glitz_gl_void_t *indices);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_multi_draw_elements_t)
+     (glitz_gl_enum_t mode, const glitz_gl_sizei_t *count,
+      glitz_gl_enum_t type, const glitz_gl_void_t **indices,
+      glitz_gl_sizei_t primcount);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_tex_env_f_t)
      (glitz_gl_enum_t target, glitz_gl_enum_t pname, glitz_gl_float_t param);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_tex_env_fv_t)
@@ -409,6 +457,10 @@ typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_stencil_func_t)
      (glitz_gl_enum_t func, glitz_gl_int_t ref, glitz_gl_uint_t mask);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_stencil_op_t)
      (glitz_gl_enum_t fail, glitz_gl_enum_t zfail, glitz_gl_enum_t zpass);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_cull_face_t)
+     (glitz_gl_enum_t mode);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_alpha_func_t)
+     (glitz_gl_enum_t func, glitz_gl_clampf_t ref);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_push_attrib_t)
      (glitz_gl_bitfield_t mask);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_pop_attrib_t)
@@ -550,6 +602,22 @@ typedef glitz_gl_void_t *(GLITZ_GL_API_ATTRIBUTE * glitz_gl_map_buffer_t)
      (glitz_gl_enum_t, glitz_gl_enum_t);
 typedef glitz_gl_boolean_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_unmap_buffer_t)
      (glitz_gl_enum_t);
+typedef glitz_gl_void_t *(GLITZ_GL_API_ATTRIBUTE * glitz_gl_map_buffer_range_t)
+     (glitz_gl_enum_t, glitz_gl_intptr_t, glitz_gl_sizeiptr_t,
+      glitz_gl_bitfield_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_flush_mapped_buffer_range_t)
+     (glitz_gl_enum_t, glitz_gl_intptr_t, glitz_gl_sizeiptr_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_buffer_storage_t)
+     (glitz_gl_enum_t, glitz_gl_sizeiptr_t, const glitz_gl_void_t *,
+      glitz_gl_bitfield_t);
+typedef glitz_gl_sync_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_fence_sync_t)
+     (glitz_gl_enum_t, glitz_gl_bitfield_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_delete_sync_t)
+     (glitz_gl_sync_t);
+typedef glitz_gl_enum_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_client_wait_sync_t)
+     (glitz_gl_sync_t, glitz_gl_bitfield_t, glitz_gl_uint64_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_wait_sync_t)
+     (glitz_gl_sync_t, glitz_gl_bitfield_t, glitz_gl_uint64_t);
 typedef void (GLITZ_GL_API_ATTRIBUTE * glitz_gl_gen_framebuffers_t)
      (glitz_gl_sizei_t, glitz_gl_uint_t *);
 typedef void (GLITZ_GL_API_ATTRIBUTE * glitz_gl_delete_framebuffers_t)
@@ -574,5 +642,22 @@ typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_renderbuffer_storage_
      (glitz_gl_enum_t, glitz_gl_enum_t, glitz_gl_sizei_t, glitz_gl_sizei_t);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_get_renderbuffer_parameter_iv_t)
      (glitz_gl_enum_t, glitz_gl_enum_t, glitz_gl_int_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_tex_storage_2d_t)
+     (glitz_gl_enum_t, glitz_gl_sizei_t, glitz_gl_enum_t,
+      glitz_gl_sizei_t, glitz_gl_sizei_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_clear_tex_sub_image_t)
+     (glitz_gl_uint_t, glitz_gl_int_t,
+      glitz_gl_int_t, glitz_gl_int_t, glitz_gl_int_t,
+      glitz_gl_sizei_t, glitz_gl_sizei_t, glitz_gl_sizei_t,
+      glitz_gl_enum_t, glitz_gl_enum_t, const glitz_gl_void_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_renderbuffer_storage_multisample_t)
+     (glitz_gl_enum_t, glitz_gl_sizei_t, glitz_gl_enum_t,
+      glitz_gl_sizei_t, glitz_gl_sizei_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_blit_framebuffer_t)
+     (glitz_gl_int_t, glitz_gl_int_t, glitz_gl_int_t, glitz_gl_int_t,
+      glitz_gl_int_t, glitz_gl_int_t, glitz_gl_int_t, glitz_gl_int_t,
+      glitz_gl_bitfield_t, glitz_gl_enum_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_primitive_restart_index_t)
+     (glitz_gl_uint_t);
 
 #endif /* GLITZ_GL_H_INCLUDED */
@@ -0,0 +1,395 @@
+/*
+ * Copyright © 2006 David Reveman
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * David Reveman not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * David Reveman makes no representations about the suitability of this
+ * software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * DAVID REVEMAN DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL DAVID REVEMAN BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Author: David Reveman <davidr@novell.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#include <stdlib.h>
+
+static glitz_pixel_format_t _glitz_backing_store_formats[] = {
+    {
+	GLITZ_FOURCC_RGB,
+	{
+	    32,
+	    0xff000000,
+	    0x00ff0000,
+	    0x0000ff00,
+	    0x000000ff
+	},
+	0, 0, 0,
+	GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP
+    }, {
+	GLITZ_FOURCC_RGB,
+	{
+	    8,
+	    0x000000ff,
+	    0x00000000,
+	    0x00000000,
+	    0x00000000
+	},
+	0, 0, 0,
+	GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP
+    }
+};
+
+void
+glitz_texture_memory_init (glitz_texture_memory_t *memory)
+{
+    memory->budget = 0;
+    memory->size   = 0;
+    memory->head   = NULL;
+    memory->tail   = NULL;
+    memory->atlas  = NULL;
+    memory->serial   = 1;
+    memory->transfer = 0;
+}
+
+static unsigned long
+_glitz_texture_memory_size (glitz_surface_t *surface)
+{
+    glitz_color_format_t *color = &surface->format->color;
+    unsigned long        bytes;
+
+    if (color->fourcc != GLITZ_FOURCC_RGB)
+	bytes = 1;
+    else
+    {
+	bytes = (color->red_size + color->green_size + color->blue_size +
+		 color->alpha_size + 7) / 8;
+	if (bytes == 3)
+	    bytes = 4;
+    }
+
+    return surface->texture.width * surface->texture.height * bytes;
+}
+
+/* lossless system memory format for surface or NULL if contents can't
+   be saved without loss of precision */
+glitz_pixel_format_t *
+glitz_backing_store_format (glitz_surface_t *surface)
+{
+    glitz_color_format_t *color = &surface->format->color;
+
+    if (color->fourcc != GLITZ_FOURCC_RGB)
+	return NULL;
+
+    if (color->red_size > 8 || color->green_size > 8 ||
+	color->blue_size > 8 || color->alpha_size > 8)
+	return NULL;
+
+    if (!color->red_size && !color->green_size && !color->blue_size)
+	return &_glitz_backing_store_formats[1];
+
+    return &_glitz_backing_store_formats[0];
+}
+
+static void
+_glitz_texture_memory_unlink (glitz_texture_memory_t *memory,
+			      glitz_surface_t        *surface)
+{
+    if (surface->lru_prev)
+	surface->lru_prev->lru_next = surface->lru_next;
+    else
+	memory->head = surface->lru_next;
+
+    if (surface->lru_next)
+	surface->lru_next->lru_prev = surface->lru_prev;
+    else
+	memory->tail = surface->lru_prev;
+
+    surface->lru_prev = surface->lru_next = NULL;
+}
+
+static void
+_glitz_texture_memory_link (glitz_texture_memory_t *memory,
+			    glitz_surface_t        *surface)
+{
+    surface->lru_prev = NULL;
+    surface->lru_next = memory->head;
+
+    if (memory->head)
+	memory->head->lru_prev = surface;
+    else
+	memory->tail = surface;
+
+    memory->head = surface;
+}
+
+void
+glitz_surface_transfer (glitz_surface_t      *surface,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer,
+			glitz_bool_t         store)
+{
+    glitz_texture_memory_t *memory = surface->drawable->backend->texture_memory;
+    glitz_box_t            *clip = surface->clip;
+    int                    n_clip = surface->n_clip;
+    short                  x_clip = surface->x_clip, y_clip = surface->y_clip;
+
+    /* the pixel transfer is part of the operation that evicts or
+       restores the surface */
+    if (memory)
+	memory->transfer++;
+
+    /* backing store always covers the whole surface. the clip serial
+       changes with the clip so that no stencil clip is reused for it. */
+    surface->clip   = &surface->box;
+    surface->n_clip = 1;
+    surface->x_clip = surface->y_clip = 0;
+    glitz_surface_clip_changed (surface);
+
+    if (store)
+	glitz_get_pixels (surface, 0, 0,
+			  surface->box.x2, surface->box.y2,
+			  format, buffer);
+    else
+	glitz_set_pixels (surface, 0, 0,
+			  surface->box.x2, surface->box.y2,
+			  format, buffer);
+
+    surface->clip   = clip;
+    surface->n_clip = n_clip;
+    surface->x_clip = x_clip;
+    surface->y_clip = y_clip;
+    glitz_surface_clip_changed (surface);
+
+    if (memory)
+	memory->transfer--;
+}
+
+static glitz_bool_t
+_glitz_surface_evict (glitz_surface_t *surface)
+{
+    glitz_pixel_format_t format, *backing_format;
+    glitz_buffer_t       *buffer;
+    unsigned long        status_mask = surface->status_mask;
+
+    backing_format = glitz_backing_store_format (surface);
+    if (!backing_format)
+	return 0;
+
+    format = *backing_format;
+    format.bytes_per_line =
+	(((surface->box.x2 * format.masks.bpp) / 8) + 3) & -4;
+
+    surface->backing_store = malloc (format.bytes_per_line * surface->box.y2);
+    if (!surface->backing_store)
+	return 0;
+
+    buffer = glitz_buffer_create_for_data (surface->backing_store);
+    if (!buffer)
+    {
+	free (surface->backing_store);
+	surface->backing_store = NULL;
+	return 0;
+    }
+
+    glitz_surface_transfer (surface, &format, buffer, 1);
+
+    glitz_buffer_destroy (buffer);
+
+    if (surface->status_mask != status_mask)
+    {
+	surface->status_mask = status_mask;
+	free (surface->backing_store);
+	surface->backing_store = NULL;
+	return 0;
+    }
+
+    glitz_surface_push_current (surface, GLITZ_ANY_CONTEXT_CURRENT);
+    glitz_texture_fini (surface->drawable->backend->gl, &surface->texture);
+    glitz_surface_pop_current (surface);
+
+    surface->texture.name   = 0;
+    surface->texture.flags &= ~GLITZ_TEXTURE_FLAG_ALLOCATED_MASK;
+
+    glitz_texture_memory_release (surface);
+
+    surface->flags |= GLITZ_SURFACE_FLAG_EVICTED_MASK;
+
+    return 1;
+}
+
+/* evict least recently used surfaces until size bytes fit in the budget.
+   surfaces used by the current operation are never evicted so that the
+   textures it has already fetched stay valid. */
+static void
+_glitz_texture_memory_evict (glitz_texture_memory_t *memory,
+			     unsigned long          size)
+{
+    glitz_surface_t *surface, *prev;
+
+    surface = memory->tail;
+    while (surface && memory->size + size > memory->budget)
+    {
+	prev = surface->lru_prev;
+
+	if (surface->memory_serial != memory->serial &&
+	    !surface->attached			     &&
+	    !SURFACE_SOLID (surface))
+	    _glitz_surface_evict (surface);
+
+	surface = prev;
+    }
+}
+
+void
+glitz_texture_memory_allocate (glitz_surface_t *surface)
+{
+    glitz_texture_memory_t *memory = surface->drawable->backend->texture_memory;
+
+    GLITZ_GL_SURFACE (surface);
+
+    if (SURFACE_ATLAS (surface) && glitz_atlas_allocate (surface))
+	return;
+
+    if (!memory)
+    {
+	glitz_texture_allocate (gl, &surface->texture,
+				surface->drawable->backend->feature_mask);
+	return;
+    }
+
+    surface->texture_size = _glitz_texture_memory_size (surface);
+
+    if (memory->budget)
+	_glitz_texture_memory_evict (memory, surface->texture_size);
+
+    glitz_texture_allocate (gl, &surface->texture,
+			    surface->drawable->backend->feature_mask);
+
+    memory->size += surface->texture_size;
+    _glitz_texture_memory_link (memory, surface);
+    surface->memory_serial = memory->serial;
+}
+
+void
+glitz_texture_memory_release (glitz_surface_t *surface)
+{
+    glitz_texture_memory_t *memory = surface->drawable->backend->texture_memory;
+
+    if (!memory || !surface->texture_size)
+	return;
+
+    _glitz_texture_memory_unlink (memory, surface);
+
+    memory->size -= surface->texture_size;
+    surface->texture_size = 0;
+}
+
+void
+glitz_texture_memory_touch (glitz_surface_t *surface)
+{
+    glitz_texture_memory_t *memory = surface->drawable->backend->texture_memory;
+
+    if (!memory || !surface->texture_size)
+	return;
+
+    surface->memory_serial = memory->serial;
+
+    if (memory->head == surface)
+	return;
+
+    _glitz_texture_memory_unlink (memory, surface);
+    _glitz_texture_memory_link (memory, surface);
+}
+
+/* starts a new operation, surfaces touched from now on are in use until
+   the next one starts */
+void
+glitz_texture_memory_begin (glitz_surface_t *surface)
+{
+    glitz_texture_memory_t *memory = surface->drawable->backend->texture_memory;
+
+    if (!memory || memory->transfer)
+	return;
+
+    if (!++memory->serial)
+	memory->serial = 1;
+}
+
+void
+glitz_texture_memory_restore (glitz_surface_t *surface)
+{
+    glitz_pixel_format_t format;
+    glitz_buffer_t       *buffer;
+
+    surface->flags &= ~GLITZ_SURFACE_FLAG_EVICTED_MASK;
+
+    if (!surface->backing_store)
+	return;
+
+    buffer = glitz_buffer_create_for_data (surface->backing_store);
+    if (!buffer)
+    {
+	glitz_surface_status_add (surface, GLITZ_STATUS_NO_MEMORY_MASK);
+	surface->flags |= GLITZ_SURFACE_FLAG_EVICTED_MASK;
+	return;
+    }
+
+    format = *glitz_backing_store_format (surface);
+    format.bytes_per_line =
+	(((surface->box.x2 * format.masks.bpp) / 8) + 3) & -4;
+
+    glitz_surface_transfer (surface, &format, buffer, 0);
+
+    glitz_buffer_destroy (buffer);
+
+    free (surface->backing_store);
+    surface->backing_store = NULL;
+}
+
+void
+glitz_drawable_set_texture_memory_budget (glitz_drawable_t *drawable,
+					  unsigned long    size)
+{
+    glitz_texture_memory_t *memory = drawable->backend->texture_memory;
+
+    if (!memory)
+	return;
+
+    memory->budget = size;
+    if (memory->budget)
+    {
+	if (!++memory->serial)
+	    memory->serial = 1;
+
+	_glitz_texture_memory_evict (memory, 0);
+    }
+}
+
+unsigned long
+glitz_drawable_get_texture_memory_usage (glitz_drawable_t *drawable)
+{
+    glitz_texture_memory_t *memory = drawable->backend->texture_memory;
+
+    if (!memory)
+	return 0;
+
+    return memory->size;
+}
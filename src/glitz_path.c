@@ -0,0 +1,268 @@
+/*
+ * Copyright © 2006 David Reveman
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * David Reveman not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * David Reveman makes no representations about the suitability of this
+ * software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * DAVID REVEMAN DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL DAVID REVEMAN BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Author: David Reveman <davidr@novell.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+
+#include <stdlib.h>
+
+#define N_STACK_POINTS 64
+
+static void
+_glitz_path_draw_fans (glitz_gl_proc_address_list_t *gl,
+		       glitz_path_info_t            *path)
+{
+    int i, first = 0;
+
+    for (i = 0; i < path->n_polygons; i++)
+    {
+	if (path->polygons[i].n_points < 3)
+	    continue;
+
+	gl->draw_arrays (GLITZ_GL_TRIANGLE_FAN, first,
+			 path->polygons[i].n_points);
+	first += path->polygons[i].n_points;
+    }
+}
+
+/* rasterizes the path into the stencil buffer inside bounds. a triangle
+   fan covers every pixel inside a polygon an odd number of times, or,
+   counting front and back facing triangles separately, a number of
+   times equal to the winding number. */
+void
+glitz_path_enable (glitz_gl_proc_address_list_t *gl,
+		   glitz_surface_t              *dst,
+		   glitz_box_t                  *bounds)
+{
+    glitz_path_info_t   *path = dst->geometry.path;
+    glitz_drawable_t    *drawable = dst->attached;
+    glitz_float_t       stack_data[N_STACK_POINTS * 2], *data, *v;
+    glitz_point_fixed_t *p;
+    int                 i, j, n_points = 0;
+    int                 bits = drawable->format->d.stencil_size;
+
+    if (bits > 8)
+	bits = 8;
+
+    /* winding numbers are counted up and down from the middle of the
+       stencil range and need at least two bits */
+    if (!bits || (path->fill_rule == GLITZ_FILL_RULE_WINDING && bits < 2))
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	path->n_polygons = 0;
+	return;
+    }
+
+    for (i = 0; i < path->n_polygons; i++)
+	if (path->polygons[i].n_points >= 3)
+	    n_points += path->polygons[i].n_points;
+
+    data = stack_data;
+    if (n_points > N_STACK_POINTS)
+    {
+	data = malloc (n_points * 2 * sizeof (glitz_float_t));
+	if (!data)
+	{
+	    glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	    path->n_polygons = 0;
+	    return;
+	}
+    }
+
+    v = data;
+    for (i = 0; i < path->n_polygons; i++)
+    {
+	if (path->polygons[i].n_points < 3)
+	    continue;
+
+	p = path->polygons[i].points;
+	for (j = 0; j < path->polygons[i].n_points; j++, p++)
+	{
+	    *v++ = FIXED_TO_FLOAT (p->x);
+	    *v++ = FIXED_TO_FLOAT (p->y);
+	}
+    }
+
+    if (path->fill_rule == GLITZ_FILL_RULE_WINDING)
+    {
+	path->ref  = 1 << (bits - 1);
+	path->mask = (1 << bits) - 1;
+    }
+    else
+    {
+	path->ref  = 0;
+	path->mask = 1;
+    }
+
+    gl->scissor (bounds->x1 + dst->x,
+		 drawable->height - dst->y - bounds->y2,
+		 bounds->x2 - bounds->x1, bounds->y2 - bounds->y1);
+
+    gl->color_mask (0, 0, 0, 0);
+
+    gl->clear_stencil (path->ref);
+    gl->clear (GLITZ_GL_STENCIL_BUFFER_BIT);
+
+    gl->enable (GLITZ_GL_STENCIL_TEST);
+    gl->stencil_func (GLITZ_GL_ALWAYS, 0, 0);
+
+    gl->vertex_pointer (2, GLITZ_GL_FLOAT, 0, data);
+
+    if (path->fill_rule == GLITZ_FILL_RULE_WINDING)
+    {
+	gl->enable (GLITZ_GL_CULL_FACE);
+
+	gl->cull_face (GLITZ_GL_BACK);
+	gl->stencil_op (GLITZ_GL_KEEP, GLITZ_GL_KEEP, GLITZ_GL_INCR);
+	_glitz_path_draw_fans (gl, path);
+
+	gl->cull_face (GLITZ_GL_FRONT);
+	gl->stencil_op (GLITZ_GL_KEEP, GLITZ_GL_KEEP, GLITZ_GL_DECR);
+	_glitz_path_draw_fans (gl, path);
+
+	gl->cull_face (GLITZ_GL_BACK);
+	gl->disable (GLITZ_GL_CULL_FACE);
+    }
+    else
+    {
+	gl->stencil_op (GLITZ_GL_KEEP, GLITZ_GL_KEEP, GLITZ_GL_INVERT);
+	_glitz_path_draw_fans (gl, path);
+    }
+
+    gl->stencil_op (GLITZ_GL_KEEP, GLITZ_GL_KEEP, GLITZ_GL_KEEP);
+    gl->disable (GLITZ_GL_STENCIL_TEST);
+
+    gl->color_mask (1, 1, 1, 1);
+
+    /* the clip region has to be rasterized again */
+    drawable->stencil_clip_serial = 0;
+
+    if (data != stack_data)
+	free (data);
+}
+
+/* covers the clipped bounds with a quad that only touches pixels the
+   path left a non-zero count in */
+void
+glitz_path_draw (glitz_gl_proc_address_list_t *gl,
+		 glitz_surface_t              *dst,
+		 glitz_box_t                  *bounds,
+		 int                          damage)
+{
+    glitz_path_info_t *path = dst->geometry.path;
+
+    if (!path->n_polygons)
+	return;
+
+    gl->enable (GLITZ_GL_STENCIL_TEST);
+    gl->stencil_func (GLITZ_GL_NOTEQUAL, path->ref, path->mask);
+
+    if (!glitz_geometry_draw_boxes (gl, dst, bounds, 1, damage))
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+
+    gl->disable (GLITZ_GL_STENCIL_TEST);
+}
+
+/* fills polygons given in destination coordinates. x_src, y_src and
+   x_mask, y_mask are the source and mask positions that line up with
+   the destination origin. the destination needs a stencil buffer; on
+   multisampled drawables edges are anti-aliased by the hardware. */
+void
+glitz_fill_path (glitz_operator_t  op,
+		 glitz_surface_t   *src,
+		 glitz_surface_t   *mask,
+		 glitz_surface_t   *dst,
+		 int               x_src,
+		 int               y_src,
+		 int               x_mask,
+		 int               y_mask,
+		 glitz_fill_rule_t fill_rule,
+		 glitz_polygon_t   *polygons,
+		 int               n_polygons)
+{
+    glitz_path_info_t   path;
+    glitz_geometry_t    geometry;
+    glitz_point_fixed_t *p;
+    glitz_fixed16_16_t  x1, y1, x2, y2;
+    int                 i, j, x, y;
+
+    /* a recorded composite would read the path after it is gone */
+    if (SURFACE_TILED (dst) || SURFACE_QUEUED (dst))
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	return;
+    }
+
+    x1 = y1 = INT_MAX;
+    x2 = y2 = INT_MIN;
+
+    for (i = 0; i < n_polygons; i++)
+    {
+	if (polygons[i].n_points < 3)
+	    continue;
+
+	p = polygons[i].points;
+	for (j = 0; j < polygons[i].n_points; j++, p++)
+	{
+	    x1 = MIN (x1, p->x);
+	    y1 = MIN (y1, p->y);
+	    x2 = MAX (x2, p->x);
+	    y2 = MAX (y2, p->y);
+	}
+    }
+
+    if (x1 >= x2 || y1 >= y2)
+	return;
+
+    path.fill_rule  = fill_rule;
+    path.polygons   = polygons;
+    path.n_polygons = n_polygons;
+
+    /* the path replaces any geometry set on the destination for the
+       duration of the call */
+    geometry = dst->geometry;
+
+    dst->geometry.type       = GLITZ_GEOMETRY_TYPE_NONE;
+    dst->geometry.buffer     = NULL;
+    dst->geometry.array      = NULL;
+    dst->geometry.attributes = 0;
+    dst->geometry.path       = &path;
+
+    x = FIXED_TO_INT (x1);
+    y = FIXED_TO_INT (y1);
+
+    glitz_composite (op, src, mask, dst,
+		     x_src + x, y_src + y,
+		     x_mask + x, y_mask + y,
+		     x, y,
+		     FIXED_TO_INT (FIXED_CEIL (x2)) - x,
+		     FIXED_TO_INT (FIXED_CEIL (y2)) - y);
+
+    dst->geometry = geometry;
+}
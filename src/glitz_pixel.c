@@ -879,6 +879,41 @@ _glitz_find_best_gl_pixel_format (glitz_pixel_format_t *format,
     return best;
 }
 
+/* uploads rows of a file mapped buffer a chunk at a time and lets go of
+   each chunk once it is uploaded, so that large images never have to be
+   resident all at once */
+static void
+_glitz_set_pixels_chunked (glitz_gl_proc_address_list_t *gl,
+			   glitz_texture_t              *texture,
+			   glitz_gl_pixel_format_t      *gl_format,
+			   glitz_buffer_t               *buffer,
+			   glitz_box_t                  *box,
+			   char                         *base,
+			   char                         *pixels,
+			   int                          bytes_per_line)
+{
+    int rows, y, n;
+
+    rows = MAX (1, (int) (buffer->chunk_size / bytes_per_line));
+
+    for (y = box->y2; y > box->y1; y -= n)
+    {
+	n = MIN (rows, y - box->y1);
+
+	gl->tex_sub_image_2d (texture->target, 0,
+			      texture->box.x1 + box->x1,
+			      texture->box.y2 - y,
+			      box->x2 - box->x1, n,
+			      gl_format->format, gl_format->type,
+			      pixels);
+
+	glitz_buffer_discard_range (buffer, pixels - base,
+				    n * bytes_per_line);
+
+	pixels += n * bytes_per_line;
+    }
+}
+
 void
 glitz_set_pixels (glitz_surface_t      *dst,
 		  int                  x_dst,
@@ -909,6 +944,13 @@ glitz_set_pixels (glitz_surface_t      *dst,
 
     GLITZ_GL_SURFACE (dst);
 
+    if (SURFACE_QUEUED (dst))
+    {
+	glitz_queue_set_pixels (dst, x_dst, y_dst, width, height,
+				format, buffer);
+	return;
+    }
+
     if (x_dst < 0 || x_dst > (dst->box.x2 - width) ||
 	y_dst < 0 || y_dst > (dst->box.y2 - height))
     {
@@ -916,6 +958,15 @@ glitz_set_pixels (glitz_surface_t      *dst,
 	return;
     }
 
+    if (SURFACE_TILED (dst))
+    {
+	glitz_tiled_set_pixels (dst, x_dst, y_dst, width, height,
+				format, buffer);
+	return;
+    }
+
+    glitz_texture_memory_begin (dst);
+
     if (SURFACE_SOLID (dst))
     {
 	glitz_color_t old = dst->solid;
@@ -1046,8 +1097,17 @@ glitz_set_pixels (glitz_surface_t      *dst,
 					      feature_mask);
     }
 
-    /* avoid context switch in this case */
-    if (!dst->attached &&
+    if (dst->drawable->uploader && !transform &&
+	gl_format->pixel.fourcc == GLITZ_FOURCC_RGB &&
+	(height < 2 ||
+	 format->scanline_order == gl_format->pixel.scanline_order) &&
+	glitz_upload_set_pixels (dst, x_dst, y_dst, width, height, format,
+				 gl_format->format, gl_format->type, buffer))
+	return;
+
+    /* avoid context switch in this case. a pending upload is waited
+       for by glitz_surface_get_texture on the other path. */
+    if (!dst->attached && !dst->upload &&
 	TEXTURE_ALLOCATED (&dst->texture) &&
 	!GLITZ_REGION_NOTEMPTY (&dst->texture_damage))
     {
@@ -1265,12 +1325,17 @@ glitz_set_pixels (glitz_surface_t      *dst,
 				      pixels);
 		break;
 	    default:
-		gl->tex_sub_image_2d (texture->target, 0,
-				      texture->box.x1 + box.x1,
-				      texture->box.y2 - box.y2,
-				      box.x2 - box.x1, box.y2 - box.y1,
-				      gl_format->format, gl_format->type,
-				      pixels);
+		if (!transform && buffer->chunk_size)
+		    _glitz_set_pixels_chunked (gl, texture, gl_format,
+					       buffer, &box, ptr, pixels,
+					       bytes_per_line);
+		else
+		    gl->tex_sub_image_2d (texture->target, 0,
+					  texture->box.x1 + box.x1,
+					  texture->box.y2 - box.y2,
+					  box.x2 - box.x1, box.y2 - box.y1,
+					  gl_format->format, gl_format->type,
+					  pixels);
 	    }
 
 	    glitz_surface_damage (dst, &box,
@@ -1349,6 +1414,13 @@ glitz_get_pixels (glitz_surface_t      *src,
 
     GLITZ_GL_SURFACE (src);
 
+    if (SURFACE_QUEUED (src))
+    {
+	glitz_queue_get_pixels (src, x_src, y_src, width, height,
+				format, buffer);
+	return;
+    }
+
     if (x_src < 0 || x_src > (src->box.x2 - width) ||
 	y_src < 0 || y_src > (src->box.y2 - height))
     {
@@ -1356,6 +1428,15 @@ glitz_get_pixels (glitz_surface_t      *src,
 	return;
     }
 
+    if (SURFACE_TILED (src))
+    {
+	glitz_tiled_get_pixels (src, x_src, y_src, width, height,
+				format, buffer);
+	return;
+    }
+
+    glitz_texture_memory_begin (src);
+
     if (SURFACE_SOLID (src))
     {
 	glitz_image_t src_image, dst_image;
@@ -1468,6 +1549,11 @@ glitz_get_pixels (glitz_surface_t      *src,
 
     color = &src->format->color;
     from_drawable = glitz_surface_push_current (src, GLITZ_DRAWABLE_CURRENT);
+
+    /* multisampled buffers are read through the resolved texture */
+    if (from_drawable && DRAWABLE_IS_MULTISAMPLE_FBO (src->attached))
+	from_drawable = 0;
+
     if (from_drawable)
     {
 	if (src->attached)
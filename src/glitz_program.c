@@ -299,6 +299,33 @@ static const char *_colorspace_yv12[] = {
     "MAD color.xyz, { 0, -.391, 2.018 }, tmp.yyyw, color;", NULL
 };
 
+/*
+ * edge coverage filter.
+ *
+ * position.x = distance to left edge
+ * position.y = distance to right edge
+ * position.z = distance to top edge
+ * position.w = distance to bottom edge
+ */
+static const char *_edge_coverage_header[] = {
+    "ATTRIB pos = fragment.texcoord[%s];",
+    "TEMP color, span, position;",
+
+    /* extra declarations */
+    "%s", NULL
+};
+
+static const char *_edge_coverage[] = {
+    "ADD_SAT color, position, 0.5;",
+    "ADD span.x, position.x, position.y;",
+    "ADD span.y, position.z, position.w;",
+
+    /* horizontal and vertical overlap of pixel and span */
+    "MIN color.xz, color.xxzz, color.yyww;",
+    "MIN_SAT color.xz, color.xxzz, span.xxyy;",
+    "MUL color, color.x, color.z;", NULL
+};
+
 static struct _glitz_program_query {
     glitz_gl_enum_t query;
     glitz_gl_enum_t max_query;
@@ -429,6 +456,8 @@ _string_array_to_char_array (char	*dst,
 
 #define COLORSPACE_BASE_SIZE   2048
 
+#define EDGE_COVERAGE_BASE_SIZE 1024
+
 static glitz_gl_uint_t
 _glitz_create_fragment_program (glitz_composite_op_t         *op,
 				int                          fp_type,
@@ -595,6 +624,24 @@ _glitz_create_fragment_program (glitz_composite_op_t         *op,
 	p += sprintf (p, buffer, tex, texture_type, tex, texture_type,
 		      tex, texture_type);
 	break;
+    case GLITZ_FP_EDGE_COVERAGE:
+	program = malloc (EDGE_COVERAGE_BASE_SIZE);
+	if (program == NULL)
+	    return 0;
+
+	p = program;
+
+	p += sprintf (p, "!!ARBfp1.0");
+
+	_string_array_to_char_array (buffer, _edge_coverage_header);
+	p += sprintf (p, buffer, tex, extra_declarations);
+
+	_string_array_to_char_array (buffer, pos_to_position);
+	p += sprintf (p, buffer);
+
+	_string_array_to_char_array (buffer, _edge_coverage);
+	p += sprintf (p, buffer);
+	break;
     default:
 	return 0;
     }
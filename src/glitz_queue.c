@@ -0,0 +1,739 @@
+/*
+ * Copyright © 2006 David Reveman
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * David Reveman not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * David Reveman makes no representations about the suitability of this
+ * software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * DAVID REVEMAN DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL DAVID REVEMAN BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Author: David Reveman <davidr@novell.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_PTHREAD) && defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#  define GLITZ_QUEUE_THREADED
+#  include <pthread.h>
+#  define GLITZ_QUEUE_BARRIER() __sync_synchronize ()
+#endif
+
+/* must be a power of two */
+#define GLITZ_QUEUE_SIZE 256
+
+typedef enum {
+    GLITZ_COMMAND_COMPOSITE,
+    GLITZ_COMMAND_COPY_AREA,
+    GLITZ_COMMAND_SET_RECTANGLES,
+    GLITZ_COMMAND_SET_PIXELS,
+    GLITZ_COMMAND_GET_PIXELS,
+    GLITZ_COMMAND_SURFACE_CREATE,
+    GLITZ_COMMAND_SURFACE_FLUSH,
+    GLITZ_COMMAND_RELEASE,
+    GLITZ_COMMAND_SWAP_BUFFER_REGION,
+    GLITZ_COMMAND_FLUSH,
+    GLITZ_COMMAND_FINISH,
+    GLITZ_COMMAND_QUIT
+} glitz_command_type_t;
+
+/* src, mask, dst and buffer hold references that are released once the
+   command has run and rects or boxes are freed, unless the command is
+   borrowed, which is the case when the caller waits for it. */
+typedef struct _glitz_command {
+    glitz_command_type_t       type;
+    glitz_bool_t               borrowed;
+    glitz_drawable_t           *drawable;
+    glitz_surface_t            *src, *mask, *dst;
+    glitz_buffer_t             *buffer;
+    glitz_operator_t           op;
+    int                        x_src, y_src;
+    int                        x_mask, y_mask;
+    int                        x_dst, y_dst;
+    int                        width, height;
+    glitz_color_t              color;
+    glitz_rectangle_t          rect, *rects;
+    glitz_box_t                box, *boxes;
+    int                        n;
+    glitz_pixel_format_t       format;
+    glitz_format_t             *surface_format;
+    unsigned long              mask_bits;
+    glitz_surface_attributes_t *attributes;
+    glitz_surface_t            **result;
+} glitz_command_t;
+
+#ifdef GLITZ_QUEUE_THREADED
+typedef struct _glitz_queue_slot {
+    volatile unsigned long sequence;
+    glitz_command_t        command;
+} glitz_queue_slot_t;
+
+/* bounded multi-producer, single-consumer ring. producers reserve a
+   position with compare-and-swap on head and publish the slot through
+   its sequence number. the mutex and conditions are only used to put
+   the submission thread or a waiting caller to sleep. */
+struct _glitz_queue {
+    glitz_drawable_t       *drawable;
+    pthread_t              thread;
+    pthread_mutex_t        mutex;
+    pthread_cond_t         work_cond;
+    pthread_cond_t         done_cond;
+    volatile unsigned long head;
+    volatile unsigned long done;
+    volatile int           sleeping;
+    volatile int           waiting;
+    glitz_queue_slot_t     slots[GLITZ_QUEUE_SIZE];
+};
+#endif
+
+static glitz_bool_t
+_glitz_queue_execute (glitz_command_t *c)
+{
+    switch (c->type) {
+    case GLITZ_COMMAND_COMPOSITE:
+	glitz_composite (c->op, c->src, c->mask, c->dst,
+			 c->x_src, c->y_src, c->x_mask, c->y_mask,
+			 c->x_dst, c->y_dst, c->width, c->height);
+	break;
+    case GLITZ_COMMAND_COPY_AREA:
+	glitz_copy_area (c->src, c->dst, c->x_src, c->y_src,
+			 c->width, c->height, c->x_dst, c->y_dst);
+	break;
+    case GLITZ_COMMAND_SET_RECTANGLES:
+	glitz_set_rectangles (c->dst, &c->color,
+			      (c->rects)? c->rects: &c->rect, c->n);
+	break;
+    case GLITZ_COMMAND_SET_PIXELS:
+	glitz_set_pixels (c->dst, c->x_dst, c->y_dst, c->width, c->height,
+			  &c->format, c->buffer);
+	break;
+    case GLITZ_COMMAND_GET_PIXELS:
+	glitz_get_pixels (c->src, c->x_src, c->y_src, c->width, c->height,
+			  &c->format, c->buffer);
+	break;
+    case GLITZ_COMMAND_SURFACE_CREATE:
+	*c->result = glitz_surface_create (c->drawable, c->surface_format,
+					   c->width, c->height, c->mask_bits,
+					   c->attributes);
+	break;
+    case GLITZ_COMMAND_SURFACE_FLUSH:
+	glitz_surface_flush (c->dst);
+	break;
+    case GLITZ_COMMAND_RELEASE:
+	break;
+    case GLITZ_COMMAND_SWAP_BUFFER_REGION:
+	glitz_drawable_swap_buffer_region (c->drawable, c->x_dst, c->y_dst,
+					   (c->boxes)? c->boxes: &c->box,
+					   c->n);
+	break;
+    case GLITZ_COMMAND_FLUSH:
+	glitz_drawable_flush (c->drawable);
+	break;
+    case GLITZ_COMMAND_FINISH:
+	glitz_drawable_finish (c->drawable);
+	break;
+    case GLITZ_COMMAND_QUIT:
+	return 1;
+    }
+
+    if (!c->borrowed)
+    {
+	glitz_surface_destroy (c->src);
+	glitz_surface_destroy (c->mask);
+	glitz_surface_destroy (c->dst);
+	glitz_buffer_destroy (c->buffer);
+
+	if (c->rects)
+	    free (c->rects);
+
+	if (c->boxes)
+	    free (c->boxes);
+    }
+
+    return 0;
+}
+
+#ifdef GLITZ_QUEUE_THREADED
+static void
+_glitz_queue_wait (glitz_queue_t *queue,
+		   unsigned long ticket)
+{
+    if ((long) (queue->done - ticket) >= 0)
+	return;
+
+    pthread_mutex_lock (&queue->mutex);
+    __sync_add_and_fetch (&queue->waiting, 1);
+
+    while ((long) (queue->done - ticket) < 0)
+	pthread_cond_wait (&queue->done_cond, &queue->mutex);
+
+    __sync_sub_and_fetch (&queue->waiting, 1);
+    pthread_mutex_unlock (&queue->mutex);
+}
+
+/* returns the ticket that the command is done at */
+static unsigned long
+_glitz_queue_push (glitz_queue_t   *queue,
+		   glitz_command_t *command)
+{
+    glitz_queue_slot_t *slot;
+    unsigned long      pos = queue->head;
+    long               diff;
+
+    for (;;)
+    {
+	slot = &queue->slots[pos & (GLITZ_QUEUE_SIZE - 1)];
+	diff = (long) (slot->sequence - pos);
+
+	if (diff == 0)
+	{
+	    if (__sync_bool_compare_and_swap (&queue->head, pos, pos + 1))
+		break;
+	}
+	else if (diff < 0)
+	{
+	    /* full, wait for the command that holds the slot to retire */
+	    _glitz_queue_wait (queue, pos - GLITZ_QUEUE_SIZE + 1);
+	}
+
+	pos = queue->head;
+    }
+
+    slot->command = *command;
+
+    GLITZ_QUEUE_BARRIER ();
+    slot->sequence = pos + 1;
+    GLITZ_QUEUE_BARRIER ();
+
+    if (queue->sleeping)
+    {
+	pthread_mutex_lock (&queue->mutex);
+	pthread_cond_signal (&queue->work_cond);
+	pthread_mutex_unlock (&queue->mutex);
+    }
+
+    return pos + 1;
+}
+
+static void *
+_glitz_queue_main (void *data)
+{
+    glitz_queue_t      *queue = data;
+    glitz_queue_slot_t *slot;
+    unsigned long      tail = 0;
+    glitz_bool_t       quit = 0;
+
+    while (!quit)
+    {
+	slot = &queue->slots[tail & (GLITZ_QUEUE_SIZE - 1)];
+
+	if (slot->sequence != tail + 1)
+	{
+	    pthread_mutex_lock (&queue->mutex);
+	    queue->sleeping = 1;
+	    GLITZ_QUEUE_BARRIER ();
+
+	    while (slot->sequence != tail + 1)
+		pthread_cond_wait (&queue->work_cond, &queue->mutex);
+
+	    queue->sleeping = 0;
+	    pthread_mutex_unlock (&queue->mutex);
+	}
+
+	GLITZ_QUEUE_BARRIER ();
+
+	quit = _glitz_queue_execute (&slot->command);
+
+	GLITZ_QUEUE_BARRIER ();
+	slot->sequence = tail + GLITZ_QUEUE_SIZE;
+	queue->done = ++tail;
+	GLITZ_QUEUE_BARRIER ();
+
+	if (queue->waiting)
+	{
+	    pthread_mutex_lock (&queue->mutex);
+	    pthread_cond_broadcast (&queue->done_cond);
+	    pthread_mutex_unlock (&queue->mutex);
+	}
+    }
+
+    queue->drawable->backend->release_current (queue->drawable);
+
+    return NULL;
+}
+#endif
+
+static void
+_glitz_queue_submit (glitz_drawable_t *drawable,
+		     glitz_command_t  *command,
+		     glitz_bool_t     wait)
+{
+
+#ifdef GLITZ_QUEUE_THREADED
+    unsigned long ticket;
+#endif
+
+    command->borrowed = wait;
+
+#ifdef GLITZ_QUEUE_THREADED
+    ticket = _glitz_queue_push (drawable->queue, command);
+    if (wait)
+	_glitz_queue_wait (drawable->queue, ticket);
+#else
+    _glitz_queue_execute (command);
+#endif
+
+}
+
+static void
+_glitz_command_init (glitz_command_t      *command,
+		     glitz_command_type_t type)
+{
+    memset (command, 0, sizeof (glitz_command_t));
+
+    command->type = type;
+}
+
+/* starts a thread that owns the context of drawable. from then on
+   glitz_composite, glitz_copy_area, glitz_set_rectangles, glitz_set_pixels,
+   glitz_surface_flush, glitz_surface_destroy, glitz_buffer_destroy and
+   the drawable swap and flush calls for the drawable and its surfaces
+   return once the call is recorded. glitz_get_pixels,
+   glitz_surface_create and glitz_drawable_finish run on the thread and
+   wait for the result. setting surface or geometry state and
+   glitz_surface_get_status wait for recorded calls to finish. surfaces
+   created while the thread runs don't use atlas textures and
+   glitz_fill_path is not supported on its surfaces. the context
+   must not be current in any other thread. */
+glitz_status_t
+glitz_drawable_start_submission (glitz_drawable_t *drawable)
+{
+
+#ifdef GLITZ_QUEUE_THREADED
+    glitz_queue_t *queue;
+    int           i;
+
+    if (drawable->queue)
+	return GLITZ_STATUS_SUCCESS;
+
+    if (!drawable->backend->release_current)
+	return GLITZ_STATUS_NOT_SUPPORTED;
+
+    queue = malloc (sizeof (glitz_queue_t));
+    if (!queue)
+	return GLITZ_STATUS_NO_MEMORY;
+
+    for (i = 0; i < GLITZ_QUEUE_SIZE; i++)
+	queue->slots[i].sequence = i;
+
+    queue->drawable = drawable;
+    queue->head     = 0;
+    queue->done     = 0;
+    queue->sleeping = 0;
+    queue->waiting  = 0;
+
+    pthread_mutex_init (&queue->mutex, NULL);
+    pthread_cond_init (&queue->work_cond, NULL);
+    pthread_cond_init (&queue->done_cond, NULL);
+
+    /* the context can only be current in one thread */
+    drawable->backend->release_current (drawable);
+
+    if (pthread_create (&queue->thread, NULL, _glitz_queue_main, queue))
+    {
+	pthread_cond_destroy (&queue->done_cond);
+	pthread_cond_destroy (&queue->work_cond);
+	pthread_mutex_destroy (&queue->mutex);
+	free (queue);
+
+	return GLITZ_STATUS_NO_MEMORY;
+    }
+
+    glitz_drawable_reference (drawable);
+    drawable->queue = queue;
+
+    return GLITZ_STATUS_SUCCESS;
+#else
+    return GLITZ_STATUS_NOT_SUPPORTED;
+#endif
+
+}
+
+/* runs all recorded calls and joins the submission thread. the thread
+   holds a reference to drawable until then. */
+void
+glitz_drawable_stop_submission (glitz_drawable_t *drawable)
+{
+
+#ifdef GLITZ_QUEUE_THREADED
+    glitz_queue_t   *queue = drawable->queue;
+    glitz_command_t command;
+
+    if (!queue || glitz_queue_is_current (queue))
+	return;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_QUIT);
+    _glitz_queue_push (queue, &command);
+
+    pthread_join (queue->thread, NULL);
+
+    pthread_cond_destroy (&queue->done_cond);
+    pthread_cond_destroy (&queue->work_cond);
+    pthread_mutex_destroy (&queue->mutex);
+
+    drawable->queue = NULL;
+    free (queue);
+
+    glitz_drawable_destroy (drawable);
+#endif
+
+}
+
+glitz_bool_t
+glitz_queue_is_current (glitz_queue_t *queue)
+{
+
+#ifdef GLITZ_QUEUE_THREADED
+    return pthread_equal (pthread_self (), queue->thread);
+#else
+    return 1;
+#endif
+
+}
+
+/* waits for everything recorded for drawable so far */
+void
+glitz_queue_sync (glitz_drawable_t *drawable)
+{
+
+#ifdef GLITZ_QUEUE_THREADED
+    _glitz_queue_wait (drawable->queue, drawable->queue->head);
+#endif
+
+}
+
+void
+glitz_queue_composite (glitz_operator_t op,
+		       glitz_surface_t  *src,
+		       glitz_surface_t  *mask,
+		       glitz_surface_t  *dst,
+		       int              x_src,
+		       int              y_src,
+		       int              x_mask,
+		       int              y_mask,
+		       int              x_dst,
+		       int              y_dst,
+		       int              width,
+		       int              height)
+{
+    glitz_command_t command;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_COMPOSITE);
+
+    glitz_surface_reference (src);
+    glitz_surface_reference (mask);
+    glitz_surface_reference (dst);
+
+    command.op     = op;
+    command.src    = src;
+    command.mask   = mask;
+    command.dst    = dst;
+    command.x_src  = x_src;
+    command.y_src  = y_src;
+    command.x_mask = x_mask;
+    command.y_mask = y_mask;
+    command.x_dst  = x_dst;
+    command.y_dst  = y_dst;
+    command.width  = width;
+    command.height = height;
+
+    _glitz_queue_submit (dst->drawable, &command, 0);
+}
+
+void
+glitz_queue_copy_area (glitz_surface_t *src,
+		       glitz_surface_t *dst,
+		       int             x_src,
+		       int             y_src,
+		       int             width,
+		       int             height,
+		       int             x_dst,
+		       int             y_dst)
+{
+    glitz_command_t command;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_COPY_AREA);
+
+    glitz_surface_reference (src);
+    glitz_surface_reference (dst);
+
+    command.src    = src;
+    command.dst    = dst;
+    command.x_src  = x_src;
+    command.y_src  = y_src;
+    command.width  = width;
+    command.height = height;
+    command.x_dst  = x_dst;
+    command.y_dst  = y_dst;
+
+    _glitz_queue_submit (dst->drawable, &command, 0);
+}
+
+void
+glitz_queue_set_rectangles (glitz_surface_t         *dst,
+			    const glitz_color_t     *color,
+			    const glitz_rectangle_t *rects,
+			    int                     n_rects)
+{
+    glitz_command_t command;
+
+    if (n_rects < 1)
+	return;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_SET_RECTANGLES);
+
+    if (n_rects == 1)
+	command.rect = *rects;
+    else
+    {
+	command.rects = malloc (n_rects * sizeof (glitz_rectangle_t));
+	if (!command.rects)
+	{
+	    glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	    return;
+	}
+
+	memcpy (command.rects, rects, n_rects * sizeof (glitz_rectangle_t));
+    }
+
+    glitz_surface_reference (dst);
+
+    command.dst   = dst;
+    command.color = *color;
+    command.n     = n_rects;
+
+    _glitz_queue_submit (dst->drawable, &command, 0);
+}
+
+/* pixels in client memory are copied so that the call can return right
+   away, anything else is uploaded before the call returns */
+void
+glitz_queue_set_pixels (glitz_surface_t      *dst,
+			int                  x_dst,
+			int                  y_dst,
+			int                  width,
+			int                  height,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer)
+{
+    glitz_command_t command;
+    glitz_bool_t    wait = 1;
+    unsigned int    size;
+    char            *data, *copy;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_SET_PIXELS);
+
+    command.dst    = dst;
+    command.x_dst  = x_dst;
+    command.y_dst  = y_dst;
+    command.width  = width;
+    command.height = height;
+    command.format = *format;
+    command.buffer = buffer;
+
+    if (!buffer->drawable && format->fourcc == GLITZ_FOURCC_RGB &&
+	format->bytes_per_line > 0 && format->skip_lines >= 0 && height > 0)
+    {
+	size = format->bytes_per_line * (format->skip_lines + height);
+
+	copy = malloc (size);
+	if (copy)
+	{
+	    command.buffer = glitz_buffer_create_for_data (copy);
+	    if (command.buffer)
+	    {
+		data = glitz_buffer_map (buffer,
+					 GLITZ_BUFFER_ACCESS_READ_ONLY);
+		memcpy (copy, data, size);
+		glitz_buffer_unmap (buffer);
+
+		command.buffer->owns_data = 1;
+		glitz_surface_reference (dst);
+		wait = 0;
+	    }
+	    else
+	    {
+		command.buffer = buffer;
+		free (copy);
+	    }
+	}
+    }
+
+    _glitz_queue_submit (dst->drawable, &command, wait);
+}
+
+void
+glitz_queue_get_pixels (glitz_surface_t      *src,
+			int                  x_src,
+			int                  y_src,
+			int                  width,
+			int                  height,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer)
+{
+    glitz_command_t command;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_GET_PIXELS);
+
+    command.src    = src;
+    command.x_src  = x_src;
+    command.y_src  = y_src;
+    command.width  = width;
+    command.height = height;
+    command.format = *format;
+    command.buffer = buffer;
+
+    _glitz_queue_submit (src->drawable, &command, 1);
+}
+
+glitz_surface_t *
+glitz_queue_surface_create (glitz_drawable_t           *drawable,
+			    glitz_format_t             *format,
+			    unsigned int               width,
+			    unsigned int               height,
+			    unsigned long              mask,
+			    glitz_surface_attributes_t *attributes)
+{
+    glitz_command_t command;
+    glitz_surface_t *surface = NULL;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_SURFACE_CREATE);
+
+    command.drawable       = drawable;
+    command.surface_format = format;
+    command.width          = width;
+    command.height         = height;
+    command.mask_bits      = mask;
+    command.attributes     = attributes;
+    command.result         = &surface;
+
+    _glitz_queue_submit (drawable, &command, 1);
+
+    return surface;
+}
+
+void
+glitz_queue_surface_flush (glitz_surface_t *surface)
+{
+    glitz_command_t command;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_SURFACE_FLUSH);
+
+    glitz_surface_reference (surface);
+    command.dst = surface;
+
+    _glitz_queue_submit (surface->drawable, &command, 0);
+}
+
+/* the reference is dropped on the submission thread, which is where
+   the surface is freed if it was the last one */
+void
+glitz_queue_surface_destroy (glitz_surface_t *surface)
+{
+    glitz_command_t command;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_RELEASE);
+
+    command.dst = surface;
+
+    _glitz_queue_submit (surface->drawable, &command, 0);
+}
+
+void
+glitz_queue_buffer_destroy (glitz_buffer_t *buffer)
+{
+    glitz_command_t command;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_RELEASE);
+
+    command.buffer = buffer;
+
+    _glitz_queue_submit (buffer->drawable, &command, 0);
+}
+
+void
+glitz_queue_swap_buffer_region (glitz_drawable_t *drawable,
+				int              x_origin,
+				int              y_origin,
+				glitz_box_t      *box,
+				int              n_box)
+{
+    glitz_command_t command;
+
+    if (n_box < 1)
+	return;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_SWAP_BUFFER_REGION);
+
+    if (n_box == 1)
+	command.box = *box;
+    else
+    {
+	command.boxes = malloc (n_box * sizeof (glitz_box_t));
+	if (!command.boxes)
+	    return;
+
+	memcpy (command.boxes, box, n_box * sizeof (glitz_box_t));
+    }
+
+    command.drawable = drawable;
+    command.x_dst    = x_origin;
+    command.y_dst    = y_origin;
+    command.n        = n_box;
+
+    _glitz_queue_submit (drawable, &command, 0);
+}
+
+void
+glitz_queue_flush (glitz_drawable_t *drawable)
+{
+    glitz_command_t command;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_FLUSH);
+
+    command.drawable = drawable;
+
+    _glitz_queue_submit (drawable, &command, 0);
+}
+
+void
+glitz_queue_finish (glitz_drawable_t *drawable)
+{
+    glitz_command_t command;
+
+    _glitz_command_init (&command, GLITZ_COMMAND_FINISH);
+
+    command.drawable = drawable;
+
+    _glitz_queue_submit (drawable, &command, 1);
+}
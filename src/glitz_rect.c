@@ -29,48 +29,188 @@
 
 #include "glitzint.h"
 
+#define N_STACK_RECTS 16
+
 #define STORE_16(dst, size, src)                                        \
     dst = ((size) ?                                                     \
 	   ((((((1L << (size)) - 1L) * (src)) / 0xffff) * 0xffff) /     \
 	    ((1L << (size)) - 1L)) :                                    \
 	   dst)
 
-static glitz_buffer_t *
-_glitz_minimum_buffer (glitz_surface_t         *surface,
-		       const glitz_rectangle_t *rects,
-		       int                     n_rects,
-		       unsigned int            *pixel)
+/* the fill buffer covers at most GLITZ_FILL_BUFFER_PIXELS, taller
+   rectangles are uploaded from it one strip at a time */
+#define GLITZ_FILL_BUFFER_PIXELS 16384
+
+/* fills rectangles with the destination current. one rectangle against
+   one clip box is a scissored clear, anything else is drawn as flat
+   colored quads in a single call. */
+static void
+_glitz_draw_rectangles (glitz_surface_t         *dst,
+			const glitz_color_t     *color,
+			const glitz_rectangle_t *rects,
+			int                     n_rects)
 {
-    glitz_buffer_t *buffer;
-    int            i, size = 0;
-    unsigned int   *data;
+    glitz_box_t stack_boxes[N_STACK_RECTS], *boxes = stack_boxes;
+    glitz_box_t box;
+    int         n_boxes = 0;
+
+    GLITZ_GL_SURFACE (dst);
+
+    if (n_rects > N_STACK_RECTS)
+    {
+	boxes = malloc (n_rects * sizeof (glitz_box_t));
+	if (!boxes)
+	{
+	    glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	    return;
+	}
+    }
+
+    for (; n_rects--; rects++)
+    {
+	box.x1 = MAX (rects->x, dst->box.x1);
+	box.y1 = MAX (rects->y, dst->box.y1);
+	box.x2 = MIN (rects->x + (int) rects->width, dst->box.x2);
+	box.y2 = MIN (rects->y + (int) rects->height, dst->box.y2);
+
+	if (box.x1 < box.x2 && box.y1 < box.y2)
+	    boxes[n_boxes++] = box;
+    }
+
+    if (n_boxes == 1 && dst->n_clip == 1)
+    {
+	box.x1 = MAX (boxes->x1, dst->clip->x1 + dst->x_clip);
+	box.y1 = MAX (boxes->y1, dst->clip->y1 + dst->y_clip);
+	box.x2 = MIN (boxes->x2, dst->clip->x2 + dst->x_clip);
+	box.y2 = MIN (boxes->y2, dst->clip->y2 + dst->y_clip);
+
+	if (box.x1 < box.x2 && box.y1 < box.y2)
+	{
+	    gl->clear_color (color->red   / (glitz_gl_clampf_t) 0xffff,
+			     color->green / (glitz_gl_clampf_t) 0xffff,
+			     color->blue  / (glitz_gl_clampf_t) 0xffff,
+			     color->alpha / (glitz_gl_clampf_t) 0xffff);
+
+	    gl->scissor (box.x1 + dst->x,
+			 dst->attached->height - dst->y - box.y2,
+			 box.x2 - box.x1,
+			 box.y2 - box.y1);
+
+	    gl->clear (GLITZ_GL_COLOR_BUFFER_BIT);
 
-    while (n_rects--)
+	    glitz_surface_damage (dst, &box,
+				  GLITZ_DAMAGE_TEXTURE_MASK |
+				  GLITZ_DAMAGE_SOLID_MASK);
+	}
+    }
+    else if (n_boxes)
     {
-	i = rects->width * rects->height;
-	if (i > size)
-	    size = i;
+	gl->color_4us (color->red, color->green, color->blue, color->alpha);
 
-	rects++;
+	glitz_set_operator (gl, GLITZ_OPERATOR_SRC);
+
+	if (!glitz_geometry_draw_boxes (gl, dst, boxes, n_boxes,
+					GLITZ_DAMAGE_TEXTURE_MASK |
+					GLITZ_DAMAGE_SOLID_MASK))
+	    glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
     }
 
-    if (size <= 1)
-	return glitz_buffer_create_for_data (pixel);
+    if (boxes != stack_boxes)
+	free (boxes);
+}
 
-    buffer = glitz_pixel_buffer_create (surface->drawable, NULL,
-					size * sizeof (unsigned int),
-					GLITZ_BUFFER_HINT_STATIC_DRAW);
+/* fills rectangles by uploading pixels when no drawable can be made
+   current. the pixels come from client memory so that no pixel buffer
+   object is created for a fill. */
+static void
+_glitz_upload_rectangles (glitz_surface_t         *dst,
+			  const glitz_color_t     *color,
+			  const glitz_rectangle_t *rects,
+			  int                     n_rects)
+{
+    static glitz_pixel_format_t pf = {
+	GLITZ_FOURCC_RGB,
+	{
+	    32,
+	    0xff000000,
+	    0x00ff0000,
+	    0x0000ff00,
+	    0x000000ff
+	},
+	0, 0, 0,
+	GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP
+    };
+    const glitz_rectangle_t *rect;
+    glitz_buffer_t          *buffer;
+    unsigned int            pixel, *data = &pixel;
+    int                     i, size, width = 0, height = 0, strip_height;
+    int                     x1, y1, x2, y2, y;
+
+    pixel = ((((unsigned int) color->alpha * 0xff) / 0xffff) << 24) |
+	((((unsigned int) color->red   * 0xff) / 0xffff) << 16) |
+	((((unsigned int) color->green * 0xff) / 0xffff) << 8) |
+	((((unsigned int) color->blue  * 0xff) / 0xffff));
+
+    for (rect = rects, i = n_rects; i--; rect++)
+    {
+	if (rect->width > width)
+	    width = rect->width;
+	if (rect->height > height)
+	    height = rect->height;
+    }
+
+    if (width < 1)
+	width = 1;
+
+    strip_height = MAX (1, GLITZ_FILL_BUFFER_PIXELS / width);
+    if (strip_height > height)
+	strip_height = MAX (1, height);
+
+    size = width * strip_height;
+    if (size > 1)
+    {
+	data = malloc (size * sizeof (unsigned int));
+	if (!data)
+	{
+	    glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	    return;
+	}
+
+	for (i = 0; i < size; i++)
+	    data[i] = pixel;
+    }
+
+    buffer = glitz_buffer_create_for_data (data);
     if (!buffer)
-	return NULL;
+    {
+	if (data != &pixel)
+	    free (data);
+
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	return;
+    }
 
-    data = glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_WRITE_ONLY);
+    for (; n_rects--; rects++)
+    {
+	x1 = MAX (rects->x, 0);
+	y1 = MAX (rects->y, 0);
+	x2 = MIN (rects->x + (int) rects->width, dst->box.x2);
+	y2 = MIN (rects->y + (int) rects->height, dst->box.y2);
 
-    while (size--)
-	*data++ = *pixel;
+	if (x1 < x2)
+	{
+	    for (y = y1; y < y2; y += strip_height)
+		glitz_set_pixels (dst,
+				  x1, y,
+				  x2 - x1, MIN (strip_height, y2 - y),
+				  &pf, buffer);
+	}
+    }
 
-    glitz_buffer_unmap (buffer);
+    glitz_buffer_destroy (buffer);
 
-    return buffer;
+    if (data != &pixel)
+	free (data);
 }
 
 void
@@ -79,11 +219,15 @@ glitz_set_rectangles (glitz_surface_t         *dst,
 		      const glitz_rectangle_t *rects,
 		      int                     n_rects)
 {
-    GLITZ_GL_SURFACE (dst);
-
     if (n_rects < 1)
 	return;
 
+    if (SURFACE_QUEUED (dst))
+    {
+	glitz_queue_set_rectangles (dst, color, rects, n_rects);
+	return;
+    }
+
     if (SURFACE_SOLID (dst))
     {
 	glitz_color_t old = dst->solid;
@@ -143,21 +287,7 @@ glitz_set_rectangles (glitz_surface_t         *dst,
     }
     else
     {
-	static glitz_pixel_format_t pf = {
-	    GLITZ_FOURCC_RGB,
-	    {
-		32,
-		0xff000000,
-		0x00ff0000,
-		0x0000ff00,
-		0x000000ff
-	    },
-	    0, 0, 0,
-	    GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP
-	};
-	glitz_buffer_t *buffer = NULL;
-	glitz_box_t    box;
-	glitz_bool_t   drawable = 0;
+	glitz_bool_t drawable = 0;
 
 	if (n_rects == 1 && rects->width <= 1 && rects->height <= 1)
 	{
@@ -170,107 +300,10 @@ glitz_set_rectangles (glitz_surface_t         *dst,
 	}
 
 	if (drawable)
-	{
-	    glitz_box_t *clip;
-	    int         n_clip;
-
-	    gl->clear_color (color->red   / (glitz_gl_clampf_t) 0xffff,
-			     color->green / (glitz_gl_clampf_t) 0xffff,
-			     color->blue  / (glitz_gl_clampf_t) 0xffff,
-			     color->alpha / (glitz_gl_clampf_t) 0xffff);
-
-	    while (n_rects--)
-	    {
-		clip = dst->clip;
-		n_clip = dst->n_clip;
-		while (n_clip--)
-		{
-		    box.x1 = clip->x1 + dst->x_clip;
-		    box.y1 = clip->y1 + dst->y_clip;
-		    box.x2 = clip->x2 + dst->x_clip;
-		    box.y2 = clip->y2 + dst->y_clip;
-
-		    if (dst->box.x1 > box.x1)
-			box.x1 = dst->box.x1;
-		    if (dst->box.y1 > box.y1)
-			box.y1 = dst->box.y1;
-		    if (dst->box.x2 < box.x2)
-			box.x2 = dst->box.x2;
-		    if (dst->box.y2 < box.y2)
-			box.y2 = dst->box.y2;
-
-		    if (rects->x > box.x1)
-			box.x1 = rects->x;
-		    if (rects->y > box.y1)
-			box.y1 = rects->y;
-		    if (rects->x + rects->width < box.x2)
-			box.x2 = rects->x + rects->width;
-		    if (rects->y + rects->height < box.y2)
-			box.y2 = rects->y + rects->height;
-
-		    if (box.x1 < box.x2 && box.y1 < box.y2)
-		    {
-			gl->scissor (box.x1,
-				     dst->attached->height - dst->y - box.y2,
-				     box.x2 - box.x1,
-				     box.y2 - box.y1);
-
-			gl->clear (GLITZ_GL_COLOR_BUFFER_BIT);
-
-			glitz_surface_damage (dst, &box,
-					      GLITZ_DAMAGE_TEXTURE_MASK |
-					      GLITZ_DAMAGE_SOLID_MASK);
-		    }
-
-		    clip++;
-		}
-		rects++;
-	    }
-	}
+	    _glitz_draw_rectangles (dst, color, rects, n_rects);
 	else
-	{
-	    unsigned int pixel =
-		((((unsigned int) color->alpha * 0xff) / 0xffff) << 24) |
-		((((unsigned int) color->red   * 0xff) / 0xffff) << 16) |
-		((((unsigned int) color->green * 0xff) / 0xffff) << 8) |
-		((((unsigned int) color->blue  * 0xff) / 0xffff));
-	    int x1, y1, x2, y2;
-
-	    buffer = _glitz_minimum_buffer (dst, rects, n_rects, &pixel);
-	    if (!buffer)
-	    {
-		glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
-		return;
-	    }
+	    _glitz_upload_rectangles (dst, color, rects, n_rects);
 
-	    while (n_rects--)
-	    {
-		x1 = rects->x;
-		y1 = rects->y;
-		x2 = x1 + rects->width;
-		y2 = y1 + rects->height;
-
-		if (x1 < 0)
-		    x1 = 0;
-		if (y1 < 0)
-		    y1 = 0;
-		if (x2 > dst->box.x2)
-		    x2 = dst->box.x2;
-		if (y2 > dst->box.y2)
-		    y2 = dst->box.y2;
-
-		if (x1 < x2 && y1 < y2)
-		    glitz_set_pixels (dst,
-				      x1, y1,
-				      x2 - x1, y2 - y1,
-				      &pf, buffer);
-
-		rects++;
-	    }
-
-	    if (buffer)
-		glitz_buffer_destroy (buffer);
-	}
 	glitz_surface_pop_current (dst);
     }
 }
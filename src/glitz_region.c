@@ -30,6 +30,7 @@
 #include "glitzint.h"
 
 #define GLITZ_REGION_ALLOC_CHUNK 16
+#define GLITZ_REGION_STACK_SIZE  64
 
 #define BOX_SUBSUMS_BOX(b1, b2)                 \
     ((b2)->x1 >= (b1)->x1 &&                    \
@@ -43,125 +44,743 @@
      (b1)->y1 < (b2)->y2 &&                     \
      (b1)->y2 > (b2)->y1)
 
-#define BOX_CLOSE_TO_BOX(b1, b2)                \
-    ((b1)->x1 < ((b2)->x2 + 1) &&               \
-     (b1)->x2 > ((b2)->x1 - 1) &&               \
-     (b1)->y1 < ((b2)->y2 + 1) &&               \
-     (b1)->y2 > ((b2)->y1 - 1))
-
-#define BOX_NEXT_TO_BOX(b1, b2)                 \
-    ((((b1)->x1 == (b2)->x2 ||                  \
-       (b1)->x2 == (b2)->x1) &&                 \
-      (b1)->y1 == (b2)->y1 &&                   \
-      (b1)->y2 == (b2)->y2) ||                  \
-     (((b1)->y1 == (b2)->y2 ||                  \
-       (b1)->y2 == (b2)->y1) &&                 \
-      (b1)->x1 == (b2)->x1 &&                   \
-      (b1)->x2 == (b2)->x2))
-
-#define MERGE_BOXES(d, b1, b2)                  \
-    {                                           \
-	(d)->x1 = MIN ((b1)->x1, (b2)->x1);     \
-	(d)->y1 = MIN ((b1)->y1, (b2)->y1);     \
-	(d)->x2 = MAX ((b1)->x2, (b2)->x2);     \
-	(d)->y2 = MAX ((b1)->y2, (b2)->y2);     \
-    }
+#define BOX_EMPTY(b)                            \
+    ((b)->x1 >= (b)->x2 || (b)->y1 >= (b)->y2)
+
+typedef enum {
+    GLITZ_REGION_OP_UNION,
+    GLITZ_REGION_OP_INTERSECT,
+    GLITZ_REGION_OP_SUBTRACT
+} glitz_region_op_t;
 
 /*
- * No real union, boxes that intersect are just joined into bigger boxes.
- * This is OK for our needs and it keeps the number of boxes down to a
- * minimum and makes it faster.
+ * Regions are stored y-x banded: boxes are sorted by y1 and then x1,
+ * all boxes in a band share the same y1 and y2, bands never overlap and
+ * boxes within a band never overlap or touch. Vertically adjacent bands
+ * with identical x spans are coalesced.
  */
-glitz_status_t
-glitz_region_union (glitz_region_t *region,
-		    glitz_box_t    *ubox)
+
+typedef struct _glitz_box_list_t {
+    glitz_box_t *box;
+    int         n_box;
+    int         size;
+    glitz_box_t stack[GLITZ_REGION_STACK_SIZE];
+} glitz_box_list_t;
+
+static glitz_bool_t
+_glitz_box_list_add (glitz_box_list_t *list,
+		     int              x1,
+		     int              y1,
+		     int              x2,
+		     int              y2)
 {
-    if (region->n_box == 0) {
-	region->extents = *ubox;
-	region->box = &region->extents;
-	region->n_box = 1;
+    glitz_box_t *box;
 
-	return GLITZ_STATUS_SUCCESS;
+    if (list->n_box == list->size)
+    {
+	if (list->box == list->stack)
+	{
+	    box = malloc (sizeof (glitz_box_t) * list->size * 2);
+	    if (!box)
+		return 0;
+
+	    memcpy (box, list->stack, sizeof (glitz_box_t) * list->n_box);
+	}
+	else
+	{
+	    box = realloc (list->box, sizeof (glitz_box_t) * list->size * 2);
+	    if (!box)
+		return 0;
+	}
+
+	list->box = box;
+	list->size *= 2;
     }
 
-    if (BOX_CLOSE_TO_BOX (ubox, &region->extents)) {
-	glitz_box_t *box, *new_box, *dst_box;
-	int         n_box;
+    box = &list->box[list->n_box++];
+    box->x1 = x1;
+    box->y1 = y1;
+    box->x2 = x2;
+    box->y2 = y2;
 
-	box = region->box;
-	n_box = region->n_box;
+    return 1;
+}
+
+static int
+_glitz_region_band_end (glitz_box_t *box,
+			int         i,
+			int         n_box)
+{
+    short y1 = box[i].y1;
+
+    while (i < n_box && box[i].y1 == y1)
+	i++;
+
+    return i;
+}
+
+/* combine the x spans of two bands into the y range [y1, y2) */
+static glitz_bool_t
+_glitz_region_op_band (glitz_box_list_t  *list,
+		       glitz_region_op_t op,
+		       glitz_box_t       *a,
+		       int               n_a,
+		       glitz_box_t       *b,
+		       int               n_b,
+		       int               y1,
+		       int               y2)
+{
+    int i = 0, j = 0, x1, x2;
+
+    switch (op) {
+    case GLITZ_REGION_OP_UNION:
+	while (i < n_a || j < n_b)
+	{
+	    glitz_box_t *box;
+
+	    if (j == n_b || (i < n_a && a[i].x1 <= b[j].x1))
+		box = &a[i++];
+	    else
+		box = &b[j++];
+
+	    x1 = box->x1;
+	    x2 = box->x2;
+
+	    for (;;)
+	    {
+		if (i < n_a && a[i].x1 <= x2)
+		{
+		    x2 = MAX (x2, a[i].x2);
+		    i++;
+		}
+		else if (j < n_b && b[j].x1 <= x2)
+		{
+		    x2 = MAX (x2, b[j].x2);
+		    j++;
+		}
+		else
+		    break;
+	    }
+
+	    if (!_glitz_box_list_add (list, x1, y1, x2, y2))
+		return 0;
+	}
+	break;
+    case GLITZ_REGION_OP_INTERSECT:
+	while (i < n_a && j < n_b)
+	{
+	    x1 = MAX (a[i].x1, b[j].x1);
+	    x2 = MIN (a[i].x2, b[j].x2);
 
-	while (n_box--) {
-	    if (BOX_SUBSUMS_BOX (box, ubox))
-		return GLITZ_STATUS_SUCCESS;
+	    if (x1 < x2 && !_glitz_box_list_add (list, x1, y1, x2, y2))
+		return 0;
 
-	    box++;
+	    if (a[i].x2 < b[j].x2)
+		i++;
+	    else
+		j++;
 	}
+	break;
+    case GLITZ_REGION_OP_SUBTRACT:
+	for (; i < n_a; i++)
+	{
+	    int k;
 
-	box = region->box;
-	n_box = region->n_box;
-
-	new_box = ubox;
-	dst_box = NULL;
-	while (n_box--) {
-
-	    if (BOX_INTERSECTS_BOX (box, new_box) ||
-		BOX_NEXT_TO_BOX (box, new_box)) {
-
-		if (dst_box) {
-		    /*
-		     * Remove box from region
-		     */
-		    region->n_box--;
-		    if (region->n_box == 1) {
-			MERGE_BOXES (&region->extents, box, new_box);
-			region->box = &region->extents;
-
-			return GLITZ_STATUS_SUCCESS;
-		    } else {
-			MERGE_BOXES (dst_box, box, new_box);
-			if (n_box)
-			    memmove (box, box + 1,
-				     n_box * sizeof (glitz_box_t));
-		    }
-		    continue;
-		} else {
-		    dst_box = box;
-		    MERGE_BOXES (dst_box, box, new_box);
-		    new_box = dst_box;
+	    x1 = a[i].x1;
+
+	    while (j < n_b && b[j].x2 <= x1)
+		j++;
+
+	    for (k = j; k < n_b && b[k].x1 < a[i].x2; k++)
+	    {
+		if (b[k].x1 > x1 &&
+		    !_glitz_box_list_add (list, x1, y1, b[k].x1, y2))
+		    return 0;
+
+		x1 = MAX (x1, b[k].x2);
+		if (x1 >= a[i].x2)
+		    break;
+	    }
+
+	    if (x1 < a[i].x2 &&
+		!_glitz_box_list_add (list, x1, y1, a[i].x2, y2))
+		return 0;
+	}
+	break;
+    }
+
+    return 1;
+}
+
+static glitz_bool_t
+_glitz_region_op (glitz_box_list_t  *list,
+		  glitz_region_op_t op,
+		  glitz_box_t       *a,
+		  int               n_a,
+		  glitz_box_t       *b,
+		  int               n_b)
+{
+    int ia = 0, ib = 0, ea = 0, eb = 0;
+    int prev = -1, n_prev = 0;
+    int y, y1, y2, band, n_band, i;
+
+    if (n_a)
+	ea = _glitz_region_band_end (a, 0, n_a);
+    if (n_b)
+	eb = _glitz_region_band_end (b, 0, n_b);
+
+    if (n_a && n_b)
+	y = MIN (a[0].y1, b[0].y1);
+    else if (n_a)
+	y = a[0].y1;
+    else if (n_b)
+	y = b[0].y1;
+    else
+	return 1;
+
+    while (ia < n_a || ib < n_b)
+    {
+	glitz_box_t *band_a = NULL, *band_b = NULL;
+	int         top_a = 0, top_b = 0;
+
+	if (ia < n_a)
+	    top_a = MAX (y, a[ia].y1);
+	if (ib < n_b)
+	    top_b = MAX (y, b[ib].y1);
+
+	if (ia < n_a && (ib == n_b || top_a < top_b))
+	{
+	    y1 = top_a;
+	    y2 = (ib < n_b)? MIN (a[ia].y2, top_b): a[ia].y2;
+	    band_a = &a[ia];
+	}
+	else if (ib < n_b && (ia == n_a || top_b < top_a))
+	{
+	    y1 = top_b;
+	    y2 = (ia < n_a)? MIN (b[ib].y2, top_a): b[ib].y2;
+	    band_b = &b[ib];
+	}
+	else
+	{
+	    y1 = top_a;
+	    y2 = MIN (a[ia].y2, b[ib].y2);
+	    band_a = &a[ia];
+	    band_b = &b[ib];
+	}
+
+	band = list->n_box;
+
+	if (!_glitz_region_op_band (list, op,
+				    band_a, band_a? ea - ia: 0,
+				    band_b, band_b? eb - ib: 0,
+				    y1, y2))
+	    return 0;
+
+	n_band = list->n_box - band;
+	if (n_band)
+	{
+	    if (prev >= 0 && n_prev == n_band &&
+		list->box[prev].y2 == y1)
+	    {
+		for (i = 0; i < n_band; i++)
+		{
+		    if (list->box[prev + i].x1 != list->box[band + i].x1 ||
+			list->box[prev + i].x2 != list->box[band + i].x2)
+			break;
+		}
+
+		if (i == n_band)
+		{
+		    for (i = 0; i < n_band; i++)
+			list->box[prev + i].y2 = y2;
+
+		    list->n_box = band;
+		    band = prev;
 		}
 	    }
-	    box++;
+
+	    prev = band;
+	    n_prev = n_band;
+	}
+
+	y = y2;
+
+	if (ia < n_a && a[ia].y2 <= y)
+	{
+	    ia = ea;
+	    if (ia < n_a)
+		ea = _glitz_region_band_end (a, ia, n_a);
+	}
+
+	if (ib < n_b && b[ib].y2 <= y)
+	{
+	    ib = eb;
+	    if (ib < n_b)
+		eb = _glitz_region_band_end (b, ib, n_b);
 	}
+    }
 
-	if (dst_box) {
-	    if (region->n_box > 1)
-		MERGE_BOXES (&region->extents, &region->extents, ubox);
+    return 1;
+}
 
-	    return GLITZ_STATUS_SUCCESS;
+static glitz_status_t
+_glitz_region_reserve (glitz_region_t *region,
+		       int            n_box)
+{
+    if (n_box <= GLITZ_REGION_INLINE_SIZE)
+    {
+	if (region->box != region->inline_box)
+	{
+	    if (region->n_box)
+		memcpy (region->inline_box, region->box,
+			sizeof (glitz_box_t) * region->n_box);
+	    region->box = region->inline_box;
 	}
+
+	return GLITZ_STATUS_SUCCESS;
     }
 
-    /*
-     * Add box to region
-     */
-    if (region->size < (region->n_box + 1)) {
-	region->size += GLITZ_REGION_ALLOC_CHUNK;
-	region->data = (void *) realloc (region->data,
-					 sizeof (glitz_box_t) * region->size);
-	if (!region->data)
+    if (region->size < n_box)
+    {
+	void *data;
+	int  size;
+
+	size = region->size + GLITZ_REGION_ALLOC_CHUNK;
+	if (size < n_box)
+	    size = n_box + GLITZ_REGION_ALLOC_CHUNK;
+
+	if (region->box == region->data)
+	    data = realloc (region->data, sizeof (glitz_box_t) * size);
+	else
+	{
+	    data = malloc (sizeof (glitz_box_t) * size);
+	    if (data && region->data)
+		free (region->data);
+	}
+
+	if (!data)
 	    return GLITZ_STATUS_NO_MEMORY;
+
+	if (region->box != region->data && region->n_box)
+	    memcpy (data, region->box, sizeof (glitz_box_t) * region->n_box);
+
+	region->data = data;
+	region->size = size;
     }
+    else if (region->box != region->data && region->n_box)
+	memcpy (region->data, region->box,
+		sizeof (glitz_box_t) * region->n_box);
 
     region->box = (glitz_box_t *) region->data;
 
-    region->box[region->n_box] = *ubox;
-    if (region->n_box == 1)
-	region->box[0] = region->extents;
+    return GLITZ_STATUS_SUCCESS;
+}
+
+static void
+_glitz_region_set_extents (glitz_region_t *region)
+{
+    glitz_box_t *box = region->box;
+    int         n_box = region->n_box;
+
+    region->extents.x1 = box[0].x1;
+    region->extents.y1 = box[0].y1;
+    region->extents.x2 = box[0].x2;
+    region->extents.y2 = box[n_box - 1].y2;
+
+    while (n_box--)
+    {
+	if (box->x1 < region->extents.x1)
+	    region->extents.x1 = box->x1;
+	if (box->x2 > region->extents.x2)
+	    region->extents.x2 = box->x2;
+	box++;
+    }
+}
+
+static glitz_status_t
+_glitz_region_set (glitz_region_t   *region,
+		   glitz_box_list_t *list)
+{
+    glitz_status_t status = GLITZ_STATUS_SUCCESS;
+
+    if (list->n_box == 0)
+    {
+	GLITZ_REGION_EMPTY (region);
+    }
+    else if (list->n_box == 1)
+    {
+	GLITZ_REGION_INIT (region, list->box);
+    }
+    else if (list->box != list->stack &&
+	     list->n_box > GLITZ_REGION_INLINE_SIZE)
+    {
+	/* take over the heap allocated result */
+	if (region->data)
+	    free (region->data);
+
+	region->data  = list->box;
+	region->size  = list->size;
+	region->box   = list->box;
+	region->n_box = list->n_box;
+
+	_glitz_region_set_extents (region);
+
+	return GLITZ_STATUS_SUCCESS;
+    }
+    else
+    {
+	region->n_box = 0;
+	status = _glitz_region_reserve (region, list->n_box);
+	if (!status)
+	{
+	    memcpy (region->box, list->box,
+		    sizeof (glitz_box_t) * list->n_box);
+	    region->n_box = list->n_box;
+
+	    _glitz_region_set_extents (region);
+	}
+    }
+
+    if (list->box != list->stack)
+	free (list->box);
+
+    return status;
+}
+
+static glitz_status_t
+_glitz_region_op_box (glitz_region_t    *region,
+		      glitz_region_op_t op,
+		      glitz_box_t       *box)
+{
+    glitz_box_list_t list;
+
+    list.box   = list.stack;
+    list.n_box = 0;
+    list.size  = GLITZ_REGION_STACK_SIZE;
+
+    if (!_glitz_region_op (&list, op, region->box, region->n_box, box, 1))
+    {
+	if (list.box != list.stack)
+	    free (list.box);
+
+	return GLITZ_STATUS_NO_MEMORY;
+    }
+
+    return _glitz_region_set (region, &list);
+}
+
+/* index of the first box with y2 above y, y2 is non-decreasing in a
+   banded region */
+static int
+_glitz_region_find_band (glitz_region_t *region,
+			 int            y)
+{
+    int lo = 0, hi = region->n_box;
+
+    while (lo < hi)
+    {
+	int mid = (lo + hi) >> 1;
+
+	if (region->box[mid].y2 <= y)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    return lo;
+}
+
+static glitz_bool_t
+_glitz_region_contains_box (glitz_region_t *region,
+			    glitz_box_t    *box)
+{
+    int i;
+
+    if (!BOX_SUBSUMS_BOX (&region->extents, box))
+	return 0;
+
+    i = _glitz_region_find_band (region, box->y1);
+    if (i == region->n_box || region->box[i].y1 > box->y1)
+	return 0;
+
+    for (; i < region->n_box && region->box[i].x1 <= box->x1; i++)
+    {
+	if (BOX_SUBSUMS_BOX (&region->box[i], box))
+	    return 1;
+    }
+
+    return 0;
+}
+
+/* add a box below all existing bands */
+static glitz_status_t
+_glitz_region_append (glitz_region_t *region,
+		      glitz_box_t    *box)
+{
+    glitz_box_t    *last = &region->box[region->n_box - 1];
+    glitz_status_t status;
+
+    /* extend the last band if it is a single box with the same x span */
+    if (last->y2 == box->y1 && last->x1 == box->x1 && last->x2 == box->x2 &&
+	(region->n_box == 1 || region->box[region->n_box - 2].y1 != last->y1))
+    {
+	last->y2 = box->y2;
+	region->extents.y2 = box->y2;
+
+	return GLITZ_STATUS_SUCCESS;
+    }
+
+    status = _glitz_region_reserve (region, region->n_box + 1);
+    if (status)
+	return status;
+
+    region->box[region->n_box++] = *box;
+
+    region->extents.x1 = MIN (region->extents.x1, box->x1);
+    region->extents.x2 = MAX (region->extents.x2, box->x2);
+    region->extents.y2 = box->y2;
+
+    return GLITZ_STATUS_SUCCESS;
+}
+
+/* union with a box that only touches some of the bands. those bands,
+   plus one neighbour on each side so that adjacent bands still coalesce,
+   are recombined and spliced back in place of the originals. the bands
+   around them are located by binary search and only moved. */
+static glitz_status_t
+_glitz_region_union_bands (glitz_region_t *region,
+			   glitz_box_t    *ubox)
+{
+    glitz_box_list_t list;
+    glitz_box_t      *box = region->box;
+    glitz_status_t   status;
+    int              n_box = region->n_box, start, end, hi, n;
+
+    start = _glitz_region_find_band (region, ubox->y1);
+    if (start > 0)
+    {
+	start--;
+	while (start > 0 && box[start - 1].y1 == box[start].y1)
+	    start--;
+    }
+
+    /* first band below the box */
+    end = start;
+    hi  = n_box;
+    while (end < hi)
+    {
+	int mid = (end + hi) >> 1;
 
-    region->n_box++;
+	if (box[mid].y1 < ubox->y2)
+	    end = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    if (end < n_box)
+	end = _glitz_region_band_end (box, end, n_box);
+
+    if (start == 0 && end == n_box)
+	return _glitz_region_op_box (region, GLITZ_REGION_OP_UNION, ubox);
+
+    list.box   = list.stack;
+    list.n_box = 0;
+    list.size  = GLITZ_REGION_STACK_SIZE;
+
+    if (!_glitz_region_op (&list, GLITZ_REGION_OP_UNION,
+			   box + start, end - start, ubox, 1))
+    {
+	if (list.box != list.stack)
+	    free (list.box);
+
+	return GLITZ_STATUS_NO_MEMORY;
+    }
+
+    n = start + list.n_box + n_box - end;
+    if (n > n_box)
+    {
+	status = _glitz_region_reserve (region, n);
+	if (status)
+	{
+	    if (list.box != list.stack)
+		free (list.box);
+
+	    return status;
+	}
+
+	box = region->box;
+    }
+
+    memmove (box + start + list.n_box, box + end,
+	     sizeof (glitz_box_t) * (n_box - end));
+    memcpy (box + start, list.box, sizeof (glitz_box_t) * list.n_box);
+    region->n_box = n;
 
-    MERGE_BOXES (&region->extents, &region->extents, ubox);
+    if (list.box != list.stack)
+	free (list.box);
+
+    region->extents.x1 = MIN (region->extents.x1, ubox->x1);
+    region->extents.y1 = MIN (region->extents.y1, ubox->y1);
+    region->extents.x2 = MAX (region->extents.x2, ubox->x2);
+    region->extents.y2 = MAX (region->extents.y2, ubox->y2);
 
     return GLITZ_STATUS_SUCCESS;
 }
+
+glitz_status_t
+glitz_region_union (glitz_region_t *region,
+		    glitz_box_t    *ubox)
+{
+    if (BOX_EMPTY (ubox))
+	return GLITZ_STATUS_SUCCESS;
+
+    if (region->n_box == 0 || BOX_SUBSUMS_BOX (ubox, &region->extents))
+    {
+	GLITZ_REGION_INIT (region, ubox);
+	return GLITZ_STATUS_SUCCESS;
+    }
+
+    if (_glitz_region_contains_box (region, ubox))
+	return GLITZ_STATUS_SUCCESS;
+
+    if (ubox->y1 >= region->extents.y2)
+	return _glitz_region_append (region, ubox);
+
+    return _glitz_region_union_bands (region, ubox);
+}
+
+glitz_status_t
+glitz_region_intersect (glitz_region_t *region,
+			glitz_box_t    *ibox)
+{
+    if (region->n_box == 0)
+	return GLITZ_STATUS_SUCCESS;
+
+    if (BOX_EMPTY (ibox) || !BOX_INTERSECTS_BOX (ibox, &region->extents))
+    {
+	GLITZ_REGION_EMPTY (region);
+	return GLITZ_STATUS_SUCCESS;
+    }
+
+    if (BOX_SUBSUMS_BOX (ibox, &region->extents))
+	return GLITZ_STATUS_SUCCESS;
+
+    if (region->n_box == 1)
+    {
+	region->extents.x1 = MAX (region->extents.x1, ibox->x1);
+	region->extents.y1 = MAX (region->extents.y1, ibox->y1);
+	region->extents.x2 = MIN (region->extents.x2, ibox->x2);
+	region->extents.y2 = MIN (region->extents.y2, ibox->y2);
+	region->box = &region->extents;
+
+	return GLITZ_STATUS_SUCCESS;
+    }
+
+    return _glitz_region_op_box (region, GLITZ_REGION_OP_INTERSECT, ibox);
+}
+
+glitz_status_t
+glitz_region_subtract (glitz_region_t *region,
+		       glitz_box_t    *sbox)
+{
+    if (region->n_box == 0 || BOX_EMPTY (sbox) ||
+	!BOX_INTERSECTS_BOX (sbox, &region->extents))
+	return GLITZ_STATUS_SUCCESS;
+
+    if (BOX_SUBSUMS_BOX (sbox, &region->extents))
+    {
+	GLITZ_REGION_EMPTY (region);
+	return GLITZ_STATUS_SUCCESS;
+    }
+
+    return _glitz_region_op_box (region, GLITZ_REGION_OP_SUBTRACT, sbox);
+}
+
+#define BOX_AREA(b) \
+    ((unsigned long) ((b)->x2 - (b)->x1) * ((b)->y2 - (b)->y1))
+
+/*
+ * Reduces the number of boxes in region when the fixed cost of issuing
+ * one more copy or draw call, expressed in pixels, outweighs copying
+ * pixels that are not damaged. The region is either kept as is, reduced
+ * to one box per band or replaced by its extents. Returns the number of
+ * pixels added to the region.
+ */
+unsigned long
+glitz_region_coalesce (glitz_region_t *region,
+		       unsigned long  call_cost)
+{
+    glitz_box_t   *box = region->box, hull;
+    int           n_box = region->n_box, n_band, i, j, end;
+    unsigned long area, band_area, extents_area;
+    unsigned long separate_cost, band_cost, extents_cost;
+
+    if (n_box < 2 || !call_cost)
+	return 0;
+
+    area = band_area = 0;
+    n_band = 0;
+    hull.x1 = hull.y1 = hull.x2 = hull.y2 = 0;
+
+    for (i = 0; i < n_box; i = end)
+    {
+	end = _glitz_region_band_end (box, i, n_box);
+
+	for (j = i; j < end; j++)
+	    area += BOX_AREA (&box[j]);
+
+	band_area += (unsigned long) (box[end - 1].x2 - box[i].x1) *
+	    (box[i].y2 - box[i].y1);
+
+	/* vertically adjacent bands with the same hull share a box */
+	if (!n_band		      ||
+	    box[i].y1	    != hull.y2 ||
+	    box[i].x1	    != hull.x1 ||
+	    box[end - 1].x2 != hull.x2)
+	    n_band++;
+
+	hull.x1 = box[i].x1;
+	hull.x2 = box[end - 1].x2;
+	hull.y2 = box[i].y2;
+    }
+
+    extents_area = BOX_AREA (&region->extents);
+
+    separate_cost = n_box * call_cost + area;
+    band_cost     = n_band * call_cost + band_area;
+    extents_cost  = call_cost + extents_area;
+
+    if (extents_cost <= band_cost && extents_cost <= separate_cost)
+    {
+	GLITZ_REGION_INIT (region, &region->extents);
+
+	return extents_area - area;
+    }
+
+    if (band_cost < separate_cost)
+    {
+	int n = 0;
+
+	for (i = 0; i < n_box; i = end)
+	{
+	    end = _glitz_region_band_end (box, i, n_box);
+
+	    hull.x1 = box[i].x1;
+	    hull.y1 = box[i].y1;
+	    hull.x2 = box[end - 1].x2;
+	    hull.y2 = box[i].y2;
+
+	    if (n && box[n - 1].y2 == hull.y1 &&
+		box[n - 1].x1 == hull.x1 && box[n - 1].x2 == hull.x2)
+		box[n - 1].y2 = hull.y2;
+	    else
+		box[n++] = hull;
+	}
+
+	region->n_box = n;
+
+	return band_area - area;
+    }
+
+    return 0;
+}
@@ -0,0 +1,385 @@
+/*
+ * Copyright © 2006 David Reveman
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * David Reveman not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * David Reveman makes no representations about the suitability of this
+ * software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * DAVID REVEMAN DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL DAVID REVEMAN BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Author: David Reveman <davidr@novell.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#include <stdlib.h>
+
+#define GLITZ_STREAM_SIZE         (1 << 22)
+#define GLITZ_STREAM_SEGMENTS     4
+#define GLITZ_STREAM_SEGMENT_SIZE (GLITZ_STREAM_SIZE / GLITZ_STREAM_SEGMENTS)
+#define GLITZ_STREAM_ALIGN        16
+
+#define GLITZ_STREAM_TIMEOUT      1000000000
+
+#define PERSISTENT_MAPPING(drawable)				 \
+    ((drawable)->backend->feature_mask &			 \
+     GLITZ_FEATURE_BUFFER_STORAGE_MASK)
+
+/* a ring of vertex memory split into segments. ranges are handed out
+   from the head and never span a segment. with persistent mappings a
+   fence is inserted once the head has left a segment and all ranges in
+   it are released, and the head waits for that fence before it reuses
+   the segment. without them the buffer is orphaned each time the head
+   wraps and ranges are mapped unsynchronized. */
+struct _glitz_stream {
+    glitz_gl_uint_t name;
+    char            *pointer;
+    unsigned int    head;
+    int             segment;
+    int             n_ranges[GLITZ_STREAM_SEGMENTS];
+    glitz_gl_sync_t fence[GLITZ_STREAM_SEGMENTS];
+};
+
+static glitz_stream_t *
+_glitz_stream_create (glitz_drawable_t *drawable)
+{
+    glitz_stream_t *stream;
+    int            i;
+
+    GLITZ_GL_DRAWABLE (drawable);
+
+    if (!(drawable->backend->feature_mask &
+	  GLITZ_FEATURE_VERTEX_BUFFER_OBJECT_MASK))
+	return NULL;
+
+    stream = malloc (sizeof (glitz_stream_t));
+    if (!stream)
+	return NULL;
+
+    stream->name    = 0;
+    stream->pointer = NULL;
+    stream->head    = 0;
+    stream->segment = 0;
+
+    for (i = 0; i < GLITZ_STREAM_SEGMENTS; i++)
+    {
+	stream->n_ranges[i] = 0;
+	stream->fence[i]    = NULL;
+    }
+
+    gl->gen_buffers (1, &stream->name);
+    if (!stream->name)
+    {
+	free (stream);
+	return NULL;
+    }
+
+    gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, stream->name);
+
+    if (PERSISTENT_MAPPING (drawable))
+    {
+	gl->buffer_storage (GLITZ_GL_ARRAY_BUFFER, GLITZ_STREAM_SIZE, NULL,
+			    GLITZ_GL_MAP_WRITE_BIT      |
+			    GLITZ_GL_MAP_PERSISTENT_BIT |
+			    GLITZ_GL_MAP_COHERENT_BIT   |
+			    GLITZ_GL_DYNAMIC_STORAGE_BIT);
+	stream->pointer =
+	    gl->map_buffer_range (GLITZ_GL_ARRAY_BUFFER, 0, GLITZ_STREAM_SIZE,
+				  GLITZ_GL_MAP_WRITE_BIT      |
+				  GLITZ_GL_MAP_PERSISTENT_BIT |
+				  GLITZ_GL_MAP_COHERENT_BIT);
+    }
+    else
+	gl->buffer_data (GLITZ_GL_ARRAY_BUFFER, GLITZ_STREAM_SIZE, NULL,
+			 GLITZ_GL_STREAM_DRAW);
+
+    gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, 0);
+
+    if (PERSISTENT_MAPPING (drawable) && !stream->pointer)
+    {
+	gl->delete_buffers (1, &stream->name);
+	free (stream);
+	return NULL;
+    }
+
+    return stream;
+}
+
+/* called with a context current */
+void
+glitz_stream_destroy (glitz_drawable_t *drawable)
+{
+    glitz_stream_t *stream = drawable->stream;
+    int            i;
+
+    GLITZ_GL_DRAWABLE (drawable);
+
+    if (!stream)
+	return;
+
+    for (i = 0; i < GLITZ_STREAM_SEGMENTS; i++)
+    {
+	if (stream->fence[i])
+	    gl->delete_sync (stream->fence[i]);
+    }
+
+    if (stream->pointer)
+    {
+	gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, stream->name);
+	gl->unmap_buffer (GLITZ_GL_ARRAY_BUFFER);
+	gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, 0);
+    }
+
+    gl->delete_buffers (1, &stream->name);
+    free (stream);
+
+    drawable->stream = NULL;
+}
+
+static glitz_bool_t
+_glitz_stream_enter_segment (glitz_drawable_t *drawable,
+			     glitz_stream_t   *stream,
+			     int              segment)
+{
+    glitz_gl_enum_t status;
+    int             i;
+
+    GLITZ_GL_DRAWABLE (drawable);
+
+    if (stream->n_ranges[segment])
+	return 0;
+
+    if (PERSISTENT_MAPPING (drawable))
+    {
+	if (stream->fence[segment])
+	{
+	    do {
+		status = gl->client_wait_sync (stream->fence[segment],
+					       GLITZ_GL_SYNC_FLUSH_COMMANDS_BIT,
+					       GLITZ_STREAM_TIMEOUT);
+	    } while (status == GLITZ_GL_TIMEOUT_EXPIRED);
+
+	    if (status == GLITZ_GL_WAIT_FAILED)
+		return 0;
+
+	    gl->delete_sync (stream->fence[segment]);
+	    stream->fence[segment] = NULL;
+	}
+    }
+    else if (segment == 0)
+    {
+	for (i = 0; i < GLITZ_STREAM_SEGMENTS; i++)
+	{
+	    if (stream->n_ranges[i])
+		return 0;
+	}
+
+	gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, stream->name);
+	gl->buffer_data (GLITZ_GL_ARRAY_BUFFER, GLITZ_STREAM_SIZE, NULL,
+			 GLITZ_GL_STREAM_DRAW);
+	gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, 0);
+    }
+
+    /* the segment we leave is fenced here if it is already idle and by
+       glitz_stream_release otherwise */
+    if (PERSISTENT_MAPPING (drawable) && !stream->n_ranges[stream->segment])
+	stream->fence[stream->segment] =
+	    gl->fence_sync (GLITZ_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    stream->segment = segment;
+
+    return 1;
+}
+
+/* reserves size bytes of stream memory and returns its offset in
+   offset. returns false when no memory is available without waiting
+   for a range that is still held. called with a context current. */
+glitz_bool_t
+glitz_stream_alloc (glitz_drawable_t *drawable,
+		    unsigned int     size,
+		    unsigned int     *offset)
+{
+    glitz_stream_t *stream;
+    unsigned int   start;
+    int            segment;
+
+    size = (size + GLITZ_STREAM_ALIGN - 1) & ~(GLITZ_STREAM_ALIGN - 1);
+    if (size == 0 || size > GLITZ_STREAM_SEGMENT_SIZE)
+	return 0;
+
+    if (!drawable->stream)
+    {
+	drawable->stream = _glitz_stream_create (drawable);
+	if (!drawable->stream)
+	    return 0;
+    }
+
+    stream = drawable->stream;
+
+    start   = stream->head;
+    segment = start / GLITZ_STREAM_SEGMENT_SIZE;
+
+    if (start == GLITZ_STREAM_SIZE ||
+	(start % GLITZ_STREAM_SEGMENT_SIZE) + size >
+	GLITZ_STREAM_SEGMENT_SIZE)
+    {
+	segment = (stream->segment + 1) % GLITZ_STREAM_SEGMENTS;
+	start   = segment * GLITZ_STREAM_SEGMENT_SIZE;
+    }
+
+    /* a range that ended exactly on a segment boundary leaves head at
+       the start of the next segment without having entered it */
+    if (segment != stream->segment &&
+	!_glitz_stream_enter_segment (drawable, stream, segment))
+	return 0;
+
+    stream->n_ranges[segment]++;
+    stream->head = start + size;
+
+    *offset = start;
+
+    return 1;
+}
+
+/* called with a context current once all GL commands that read the
+   range have been issued */
+void
+glitz_stream_release (glitz_drawable_t *drawable,
+		      unsigned int     offset)
+{
+    glitz_stream_t *stream = drawable->stream;
+    int            segment = offset / GLITZ_STREAM_SEGMENT_SIZE;
+
+    GLITZ_GL_DRAWABLE (drawable);
+
+    if (--stream->n_ranges[segment])
+	return;
+
+    if (PERSISTENT_MAPPING (drawable) && segment != stream->segment)
+    {
+	if (stream->fence[segment])
+	    gl->delete_sync (stream->fence[segment]);
+
+	stream->fence[segment] =
+	    gl->fence_sync (GLITZ_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+/* only one range can be mapped at a time. mappings are write only. */
+void *
+glitz_stream_map (glitz_drawable_t *drawable,
+		  unsigned int     offset,
+		  unsigned int     size)
+{
+    glitz_stream_t *stream = drawable->stream;
+    char           *pointer;
+
+    GLITZ_GL_DRAWABLE (drawable);
+
+    if (stream->pointer)
+	return stream->pointer + offset;
+
+    gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, stream->name);
+
+    if (drawable->backend->feature_mask & GLITZ_FEATURE_MAP_BUFFER_RANGE_MASK)
+	pointer = gl->map_buffer_range (GLITZ_GL_ARRAY_BUFFER, offset, size,
+					GLITZ_GL_MAP_WRITE_BIT	       |
+					GLITZ_GL_MAP_INVALIDATE_RANGE_BIT |
+					GLITZ_GL_MAP_UNSYNCHRONIZED_BIT);
+    else
+    {
+	pointer = gl->map_buffer (GLITZ_GL_ARRAY_BUFFER, GLITZ_GL_WRITE_ONLY);
+	if (pointer)
+	    pointer += offset;
+    }
+
+    gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, 0);
+
+    return pointer;
+}
+
+glitz_status_t
+glitz_stream_unmap (glitz_drawable_t *drawable)
+{
+    glitz_stream_t *stream = drawable->stream;
+    glitz_status_t status = GLITZ_STATUS_SUCCESS;
+
+    GLITZ_GL_DRAWABLE (drawable);
+
+    if (stream->pointer)
+	return status;
+
+    gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, stream->name);
+    if (gl->unmap_buffer (GLITZ_GL_ARRAY_BUFFER) == GLITZ_GL_FALSE)
+	status = GLITZ_STATUS_CONTENT_DESTROYED;
+    gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, 0);
+
+    return status;
+}
+
+/* vertex data for a single draw. the returned memory is written by the
+   caller and handed to glitz_stream_bind_vertices, the draw is issued
+   and glitz_stream_unbind_vertices returns the range to the ring. */
+void *
+glitz_stream_map_vertices (glitz_drawable_t *drawable,
+			   unsigned int     size,
+			   unsigned int     *offset)
+{
+    void *pointer;
+
+    if (!glitz_stream_alloc (drawable, size, offset))
+	return NULL;
+
+    pointer = glitz_stream_map (drawable, *offset, size);
+    if (!pointer)
+	glitz_stream_release (drawable, *offset);
+
+    return pointer;
+}
+
+void *
+glitz_stream_bind_vertices (glitz_drawable_t *drawable,
+			    unsigned int     offset)
+{
+    GLITZ_GL_DRAWABLE (drawable);
+
+    glitz_stream_unmap (drawable);
+
+    gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, drawable->stream->name);
+
+    return (char *) NULL + offset;
+}
+
+void
+glitz_stream_unbind_vertices (glitz_drawable_t *drawable,
+			      unsigned int     offset)
+{
+    GLITZ_GL_DRAWABLE (drawable);
+
+    gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, 0);
+
+    glitz_stream_release (drawable, offset);
+}
+
+glitz_gl_uint_t
+glitz_stream_name (glitz_drawable_t *drawable)
+{
+    return drawable->stream->name;
+}
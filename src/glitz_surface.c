@@ -32,6 +32,20 @@
 #include <stdlib.h>
 #include <string.h>
 
+static unsigned int _glitz_clip_serial = 0;
+
+void
+glitz_surface_clip_changed (glitz_surface_t *surface)
+{
+    unsigned int serial;
+
+    serial = GLITZ_ATOMIC_INC (&_glitz_clip_serial);
+    if (!serial)
+	serial = GLITZ_ATOMIC_INC (&_glitz_clip_serial);
+
+    surface->clip_serial = serial;
+}
+
 glitz_surface_t *
 glitz_surface_create (glitz_drawable_t           *drawable,
 		      glitz_format_t             *format,
@@ -47,6 +61,11 @@ glitz_surface_create (glitz_drawable_t           *drawable,
     if (!width || !height)
 	return NULL;
 
+    if (DRAWABLE_QUEUED (drawable))
+	return glitz_queue_surface_create (drawable, format, width, height,
+					   mask & ~GLITZ_SURFACE_ATLAS_MASK,
+					   attributes);
+
     if (mask & GLITZ_SURFACE_UNNORMALIZED_MASK)
     {
 	if (attributes->unnormalized)
@@ -74,6 +93,8 @@ glitz_surface_create (glitz_drawable_t           *drawable,
     surface->n_clip    = 1;
     surface->buffer    = GLITZ_GL_FRONT;
 
+    glitz_surface_clip_changed (surface);
+
     if (width == 1 && height == 1)
     {
 	surface->flags |= GLITZ_SURFACE_FLAG_SOLID_MASK;
@@ -95,6 +116,14 @@ glitz_surface_create (glitz_drawable_t           *drawable,
 
     glitz_surface_set_filter (surface, GLITZ_FILTER_NEAREST, NULL, 0);
 
+    /* small surfaces can share atlas textures if requested */
+    if ((mask & GLITZ_SURFACE_ATLAS_MASK) && attributes->atlas &&
+	!unnormalized && !SURFACE_SOLID (surface)	      &&
+	width <= 64 && height <= 64			      &&
+	drawable->backend->texture_memory		      &&
+	glitz_backing_store_format (surface))
+	surface->flags |= GLITZ_SURFACE_FLAG_ATLAS_MASK;
+
     if (width > 64 || height > 64)
     {
 	glitz_surface_push_current (surface, GLITZ_CONTEXT_CURRENT);
@@ -103,28 +132,53 @@ glitz_surface_create (glitz_drawable_t           *drawable,
 				  drawable->backend->max_texture_rect_size);
 	glitz_surface_pop_current (surface);
 
+	/* surfaces larger than the maximum texture size can be backed
+	   by a grid of textures if requested */
 	if (TEXTURE_INVALID_SIZE (&surface->texture))
 	{
-	    glitz_surface_destroy (surface);
-	    return NULL;
+	    if (!(mask & GLITZ_SURFACE_TILED_MASK) ||
+		!attributes->tiled                 ||
+		unnormalized                       ||
+		!glitz_tile_grid_create (surface))
+	    {
+		glitz_surface_destroy (surface);
+		return NULL;
+	    }
 	}
     }
 
     return surface;
 }
 
+static void
+_glitz_surface_end_batch (glitz_surface_t *surface)
+{
+    surface->batch = 0;
+
+    glitz_surface_apply_batch_damage (surface);
+    glitz_surface_pop_current (surface);
+}
+
 void
 glitz_surface_destroy (glitz_surface_t *surface)
 {
     if (!surface)
 	return;
 
-    surface->ref_count--;
-    if (surface->ref_count)
+    if (SURFACE_QUEUED (surface))
+    {
+	glitz_queue_surface_destroy (surface);
+	return;
+    }
+
+    if (GLITZ_ATOMIC_DEC (&surface->ref_count))
 	return;
 
     if (surface->attached)
     {
+	if (surface->batch)
+	    _glitz_surface_end_batch (surface);
+
 	surface->attached->backend->detach_notify (surface->attached, surface);
 	if (surface->attached->front == surface)
 	    surface->attached->front = NULL;
@@ -135,9 +189,23 @@ glitz_surface_destroy (glitz_surface_t *surface)
 	surface->attached = NULL;
     }
 
+    glitz_tile_grid_destroy (surface);
+
+    glitz_texture_memory_release (surface);
+
+    if (surface->backing_store)
+	free (surface->backing_store);
+
     if (surface->texture.name) {
 	glitz_surface_push_current (surface, GLITZ_ANY_CONTEXT_CURRENT);
-	glitz_texture_fini (surface->drawable->backend->gl, &surface->texture);
+	if (surface->upload)
+	    glitz_upload_wait (surface);
+
+	if (surface->atlas)
+	    glitz_atlas_release (surface);
+	else
+	    glitz_texture_fini (surface->drawable->backend->gl,
+				&surface->texture);
 	glitz_surface_pop_current (surface);
     }
 
@@ -150,6 +218,12 @@ glitz_surface_destroy (glitz_surface_t *surface)
     if (surface->geometry.array)
 	glitz_multi_array_destroy (surface->geometry.array);
 
+    if (surface->geometry.index.buffer)
+	glitz_buffer_destroy (surface->geometry.index.buffer);
+
+    if (surface->geometry.index.restarts)
+	free (surface->geometry.index.restarts);
+
     if (surface->transform)
 	free (surface->transform);
 
@@ -167,7 +241,20 @@ glitz_surface_reference (glitz_surface_t *surface)
     if (surface == NULL)
 	return;
 
-    surface->ref_count++;
+    GLITZ_ATOMIC_INC (&surface->ref_count);
+}
+
+/* merging may only grow region into areas that are up to date on both
+   sides, which is not the case while the other region is damaged */
+static void
+_glitz_surface_coalesce_damage (glitz_surface_t *surface,
+				glitz_region_t  *region,
+				glitz_region_t  *other)
+{
+    glitz_damage_policy_t *policy = surface->drawable->backend->damage_policy;
+
+    if (policy && !GLITZ_REGION_NOTEMPTY (other))
+	policy->over_copy += glitz_region_coalesce (region, policy->call_cost);
 }
 
 void
@@ -181,7 +268,7 @@ _glitz_surface_sync_texture (glitz_surface_t *surface)
 	GLITZ_GL_SURFACE (surface);
 
 	if (!(TEXTURE_ALLOCATED (&surface->texture)))
-	    glitz_texture_allocate (gl, &surface->texture);
+	    glitz_texture_memory_allocate (surface);
 
 	if (SURFACE_SOLID (surface) && (!SURFACE_SOLID_DAMAGE (surface)))
 	{
@@ -215,6 +302,9 @@ _glitz_surface_sync_texture (glitz_surface_t *surface)
 
 	glitz_texture_bind (gl, &surface->texture);
 
+	_glitz_surface_coalesce_damage (surface, &surface->texture_damage,
+					&surface->drawable_damage);
+
 	box = GLITZ_REGION_RECTS (&surface->texture_damage);
 	n_box = GLITZ_REGION_NUM_RECTS (&surface->texture_damage);
 
@@ -259,6 +349,9 @@ glitz_surface_sync_drawable (glitz_surface_t *surface)
 	if (!texture)
 	    return;
 
+	_glitz_surface_coalesce_damage (surface, &surface->drawable_damage,
+					&surface->texture_damage);
+
 	box = GLITZ_REGION_RECTS (&surface->drawable_damage);
 	ext = GLITZ_REGION_EXTENTS (&surface->drawable_damage);
 	n_box = GLITZ_REGION_NUM_RECTS (&surface->drawable_damage);
@@ -291,12 +384,20 @@ glitz_surface_sync_drawable (glitz_surface_t *surface)
 	    glitz_float_t *data;
 	    void          *ptr;
 	    int           vertices;
+	    unsigned int  offset;
+	    glitz_bool_t  streamed = 1;
 
-	    ptr = malloc (n_box * 8 * sizeof (glitz_float_t));
+	    ptr = glitz_stream_map_vertices (surface->drawable,
+					     n_box * 8 * sizeof (glitz_float_t),
+					     &offset);
 	    if (!ptr) {
-		glitz_surface_status_add (surface,
-					  GLITZ_STATUS_NO_MEMORY_MASK);
-		return;
+		streamed = 0;
+		ptr = malloc (n_box * 8 * sizeof (glitz_float_t));
+		if (!ptr) {
+		    glitz_surface_status_add (surface,
+					      GLITZ_STATUS_NO_MEMORY_MASK);
+		    return;
+		}
 	    }
 
 	    data = (glitz_float_t *) ptr;
@@ -316,10 +417,16 @@ glitz_surface_sync_drawable (glitz_surface_t *surface)
 		box++;
 	    }
 
+	    if (streamed)
+		ptr = glitz_stream_bind_vertices (surface->drawable, offset);
+
 	    gl->vertex_pointer (2, GLITZ_GL_FLOAT, 0, ptr);
 	    gl->draw_arrays (GLITZ_GL_QUADS, 0, vertices);
 
-	    free (ptr);
+	    if (streamed)
+		glitz_stream_unbind_vertices (surface->drawable, offset);
+	    else
+		free (ptr);
 	}
 	else
 	{
@@ -372,7 +479,14 @@ glitz_texture_t *
 glitz_surface_get_texture (glitz_surface_t *surface,
 			   glitz_bool_t    allocate)
 {
-    GLITZ_GL_SURFACE (surface);
+    if (SURFACE_TILED (surface))
+	return NULL;
+
+    if (SURFACE_EVICTED (surface))
+	glitz_texture_memory_restore (surface);
+
+    if (surface->batch)
+	glitz_surface_apply_batch_damage (surface);
 
     if (GLITZ_REGION_NOTEMPTY (&surface->texture_damage))
     {
@@ -381,11 +495,17 @@ glitz_surface_get_texture (glitz_surface_t *surface,
     else if (allocate)
     {
 	if (!(TEXTURE_ALLOCATED (&surface->texture)))
-	    glitz_texture_allocate (gl, &surface->texture);
+	    glitz_texture_memory_allocate (surface);
     }
 
     if (TEXTURE_ALLOCATED (&surface->texture))
+    {
+	if (surface->upload)
+	    glitz_upload_wait (surface);
+
+	glitz_texture_memory_touch (surface);
 	return &surface->texture;
+    }
 
     return NULL;
 }
@@ -395,8 +515,31 @@ glitz_surface_damage (glitz_surface_t *surface,
 		      glitz_box_t     *box,
 		      int             what)
 {
-    if (surface->attached && !DRAWABLE_IS_FBO (surface->attached))
+    if (surface->attached &&
+	!DRAWABLE_RENDERS_TO_TEXTURE (surface->attached))
     {
+	/* texture damage is only collected during a batch and added to
+	   the region when the texture is needed or the batch ends */
+	if (surface->batch && (what & GLITZ_DAMAGE_TEXTURE_MASK))
+	{
+	    glitz_box_t *damage = &surface->batch_damage;
+
+	    if (!box)
+		box = &surface->box;
+
+	    if (damage->x1 >= damage->x2 || damage->y1 >= damage->y2)
+		*damage = *box;
+	    else
+	    {
+		damage->x1 = MIN (damage->x1, box->x1);
+		damage->y1 = MIN (damage->y1, box->y1);
+		damage->x2 = MAX (damage->x2, box->x2);
+		damage->y2 = MAX (damage->y2, box->y2);
+	    }
+
+	    what &= ~GLITZ_DAMAGE_TEXTURE_MASK;
+	}
+
 	if (box)
 	{
 	    if (what & GLITZ_DAMAGE_DRAWABLE_MASK)
@@ -425,6 +568,17 @@ glitz_surface_damage (glitz_surface_t *surface,
 	surface->flags |= GLITZ_SURFACE_FLAG_SOLID_DAMAGE_MASK;
 }
 
+void
+glitz_surface_apply_batch_damage (glitz_surface_t *surface)
+{
+    glitz_box_t *damage = &surface->batch_damage;
+
+    if (damage->x1 < damage->x2 && damage->y1 < damage->y2)
+	GLITZ_REGION_UNION (&surface->texture_damage, damage);
+
+    damage->x1 = damage->y1 = damage->x2 = damage->y2 = 0;
+}
+
 void
 glitz_surface_status_add (glitz_surface_t *surface,
 			  int             flags)
@@ -487,6 +641,18 @@ glitz_surface_attach (glitz_surface_t         *surface,
 		      glitz_drawable_t        *drawable,
 		      glitz_drawable_buffer_t buffer)
 {
+    if (SURFACE_TILED (surface))
+    {
+	glitz_surface_status_add (surface, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	return;
+    }
+
+    if (SURFACE_EVICTED (surface))
+	glitz_texture_memory_restore (surface);
+
+    if (drawable && SURFACE_ATLAS (surface))
+	glitz_atlas_migrate (surface);
+
     if (drawable)
     {
 	if (buffer == GLITZ_DRAWABLE_BUFFER_FRONT_COLOR)
@@ -554,6 +720,9 @@ glitz_surface_detach (glitz_surface_t *surface)
     if (!surface->attached)
 	return;
 
+    if (surface->batch)
+	_glitz_surface_end_batch (surface);
+
     if (GLITZ_REGION_NOTEMPTY (&surface->texture_damage))
     {
 	glitz_surface_push_current (surface, GLITZ_DRAWABLE_CURRENT);
@@ -597,6 +766,17 @@ glitz_surface_push_current (glitz_surface_t    *surface,
 {
     glitz_drawable_t *drawable;
 
+    /* the batch keeps the surface current with its state in place */
+    if (surface->batch)
+    {
+	if (GLITZ_REGION_NOTEMPTY (&surface->drawable_damage))
+	    glitz_surface_sync_drawable (surface);
+
+	surface->attached->flushed = surface->attached->finished = 0;
+
+	return 1;
+    }
+
     if (surface->attached)
     {
 	drawable = surface->attached;
@@ -659,6 +839,9 @@ glitz_surface_pop_current (glitz_surface_t *surface)
     glitz_drawable_t *drawable;
     glitz_surface_t  *other;
 
+    if (surface->batch)
+	return;
+
     drawable = (surface->attached) ? surface->attached : surface->drawable;
 
     other = drawable->backend->pop_current (drawable);
@@ -684,10 +867,17 @@ glitz_surface_set_transform (glitz_surface_t   *surface,
 	}
     };
 
+    if (SURFACE_QUEUED (surface))
+	glitz_queue_sync (surface->drawable);
+
     if (transform &&
 	memcmp (transform, &identity, sizeof (glitz_transform_t)) == 0)
 	transform = NULL;
 
+    /* the texture matrix depends on the final texture layout */
+    if (transform && SURFACE_ATLAS (surface))
+	glitz_atlas_migrate (surface);
+
     if (transform) {
 	glitz_gl_float_t height, *m, *t;
 
@@ -798,6 +988,9 @@ void
 glitz_surface_set_fill (glitz_surface_t *surface,
 			glitz_fill_t    fill)
 {
+    if (SURFACE_QUEUED (surface))
+	glitz_queue_sync (surface->drawable);
+
     switch (fill) {
     case GLITZ_FILL_TRANSPARENT:
 	surface->flags &= ~GLITZ_SURFACE_FLAG_REPEAT_MASK;
@@ -829,6 +1022,9 @@ void
 glitz_surface_set_component_alpha (glitz_surface_t *surface,
 				   glitz_bool_t    component_alpha)
 {
+    if (SURFACE_QUEUED (surface))
+	glitz_queue_sync (surface->drawable);
+
     if (component_alpha && surface->format->color.red_size)
 	surface->flags |= GLITZ_SURFACE_FLAG_COMPONENT_ALPHA_MASK;
     else
@@ -844,6 +1040,13 @@ glitz_surface_set_filter (glitz_surface_t    *surface,
 {
     glitz_status_t status;
 
+    if (SURFACE_QUEUED (surface))
+	glitz_queue_sync (surface->drawable);
+
+    /* linear filtering would sample neighbouring atlas entries */
+    if (SURFACE_ATLAS (surface) && filter != GLITZ_FILTER_NEAREST)
+	glitz_atlas_migrate (surface);
+
     status = glitz_filter_set_params (surface, filter, params, n_params);
     if (status) {
 	glitz_surface_status_add (surface,
@@ -888,6 +1091,12 @@ glitz_surface_set_filter (glitz_surface_t    *surface,
 	    surface->flags |= GLITZ_SURFACE_FLAG_IGNORE_WRAP_MASK;
 	    surface->flags |= GLITZ_SURFACE_FLAG_EYE_COORDS_MASK;
 	    break;
+	case GLITZ_FILTER_EDGE_COVERAGE:
+	    surface->flags |= GLITZ_SURFACE_FLAG_FRAGMENT_FILTER_MASK;
+	    surface->flags &= ~GLITZ_SURFACE_FLAG_LINEAR_TRANSFORM_FILTER_MASK;
+	    surface->flags |= GLITZ_SURFACE_FLAG_IGNORE_WRAP_MASK;
+	    surface->flags &= ~GLITZ_SURFACE_FLAG_EYE_COORDS_MASK;
+	    break;
 	}
 	surface->filter = filter;
     }
@@ -898,6 +1107,9 @@ void
 glitz_surface_set_dither (glitz_surface_t *surface,
 			  glitz_bool_t    dither)
 {
+    if (SURFACE_QUEUED (surface))
+	glitz_queue_sync (surface->drawable);
+
     if (dither)
 	surface->flags |= GLITZ_SURFACE_FLAG_DITHER_MASK;
     else
@@ -908,10 +1120,16 @@ slim_hidden_def(glitz_surface_set_dither);
 void
 glitz_surface_flush (glitz_surface_t *surface)
 {
+    if (SURFACE_QUEUED (surface))
+    {
+	glitz_queue_surface_flush (surface);
+	return;
+    }
+
     if (!surface->attached)
 	return;
 
-    if (!DRAWABLE_IS_FBO (surface->attached))
+    if (!DRAWABLE_RENDERS_TO_TEXTURE (surface->attached))
     {
 	if (GLITZ_REGION_NOTEMPTY (&surface->drawable_damage))
 	{
@@ -922,6 +1140,42 @@ glitz_surface_flush (glitz_surface_t *surface)
 }
 slim_hidden_def(glitz_surface_flush);
 
+/* makes an attached surface current until the matching
+   glitz_surface_end_batch so that the operations in between don't have
+   to make it current and set up its state one by one. batches nest
+   for the same surface but not across surfaces, and no glitz_context
+   may be made current while one is open. the batch is only valid in
+   the thread that opened it. */
+void
+glitz_surface_begin_batch (glitz_surface_t *surface)
+{
+    if (surface->batch)
+    {
+	surface->batch++;
+	return;
+    }
+
+    if (!surface->attached || SURFACE_QUEUED (surface))
+	return;
+
+    if (!glitz_surface_push_current (surface, GLITZ_DRAWABLE_CURRENT))
+    {
+	glitz_surface_pop_current (surface);
+	return;
+    }
+
+    surface->batch = 1;
+}
+
+void
+glitz_surface_end_batch (glitz_surface_t *surface)
+{
+    if (!surface->batch || --surface->batch)
+	return;
+
+    _glitz_surface_end_batch (surface);
+}
+
 unsigned int
 glitz_surface_get_width (glitz_surface_t *surface)
 {
@@ -939,6 +1193,9 @@ slim_hidden_def(glitz_surface_get_height);
 glitz_status_t
 glitz_surface_get_status (glitz_surface_t *surface)
 {
+    if (SURFACE_QUEUED (surface))
+	glitz_queue_sync (surface->drawable);
+
     return glitz_status_pop_from_mask (&surface->status_mask);
 }
 slim_hidden_def(glitz_surface_get_status);
@@ -978,6 +1235,9 @@ glitz_surface_set_clip_region (glitz_surface_t *surface,
 			       glitz_box_t     *box,
 			       int             n_box)
 {
+    if (SURFACE_QUEUED (surface))
+	glitz_queue_sync (surface->drawable);
+
     if (n_box)
     {
 	surface->clip   = box;
@@ -991,5 +1251,7 @@ glitz_surface_set_clip_region (glitz_surface_t *surface,
 	surface->n_clip = 1;
 	surface->x_clip = surface->y_clip = 0;
     }
+
+    glitz_surface_clip_changed (surface);
 }
 slim_hidden_def(glitz_surface_set_clip_region);
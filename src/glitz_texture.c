@@ -157,12 +157,187 @@ glitz_texture_size_check (glitz_gl_proc_address_list_t *gl,
 	texture->flags |= GLITZ_TEXTURE_FLAG_INVALID_SIZE_MASK;
 }
 
+static int
+_glitz_texture_padding (glitz_texture_t *texture,
+			glitz_box_t     *box)
+{
+    int n = 0;
+
+    if (texture->box.y1 > 0)
+    {
+	box[n].x1 = 0;
+	box[n].y1 = 0;
+	box[n].x2 = texture->width;
+	box[n].y2 = texture->box.y1;
+	n++;
+    }
+
+    if (texture->box.y2 < texture->height)
+    {
+	box[n].x1 = 0;
+	box[n].y1 = texture->box.y2;
+	box[n].x2 = texture->width;
+	box[n].y2 = texture->height;
+	n++;
+    }
+
+    if (texture->box.x1 > 0)
+    {
+	box[n].x1 = 0;
+	box[n].y1 = texture->box.y1;
+	box[n].x2 = texture->box.x1;
+	box[n].y2 = texture->box.y2;
+	n++;
+    }
+
+    if (texture->box.x2 < texture->width)
+    {
+	box[n].x1 = texture->box.x2;
+	box[n].y1 = texture->box.y1;
+	box[n].x2 = texture->width;
+	box[n].y2 = texture->box.y2;
+	n++;
+    }
+
+    return n;
+}
+
+static void
+_glitz_texture_upload_padding (glitz_gl_proc_address_list_t *gl,
+			       glitz_texture_t              *texture,
+			       glitz_box_t                  *box,
+			       int                          n_box)
+{
+    char *data;
+    int  i, size = 0;
+
+    for (i = 0; i < n_box; i++)
+	size = MAX (size, (box[i].x2 - box[i].x1) *
+		    (box[i].y2 - box[i].y1));
+
+    data = calloc (size, 1);
+    if (!data)
+	return;
+
+    glitz_texture_bind (gl, texture);
+
+    gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH, 0);
+    gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_ROWS, 0);
+    gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_PIXELS, 0);
+    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 1);
+
+    for (i = 0; i < n_box; i++)
+	gl->tex_sub_image_2d (texture->target, 0,
+			      box[i].x1, box[i].y1,
+			      box[i].x2 - box[i].x1,
+			      box[i].y2 - box[i].y1,
+			      GLITZ_GL_ALPHA, GLITZ_GL_UNSIGNED_BYTE,
+			      data);
+
+    glitz_texture_unbind (gl, texture);
+
+    free (data);
+}
+
+/* alpha and luminance textures aren't color renderable */
+static glitz_bool_t
+_glitz_texture_renderable (glitz_texture_t *texture)
+{
+    switch (texture->format) {
+    case GLITZ_GL_ALPHA:
+    case GLITZ_GL_ALPHA4:
+    case GLITZ_GL_ALPHA8:
+    case GLITZ_GL_ALPHA12:
+    case GLITZ_GL_ALPHA16:
+    case GLITZ_GL_LUMINANCE:
+    case GLITZ_GL_LUMINANCE8:
+	return 0;
+    default:
+	return 1;
+    }
+}
+
+/* clamp to border sampling reads texels outside of texture box so
+   padding left undefined at allocation must be cleared before such
+   sampling, do it on the GPU when possible. fb is the framebuffer bound
+   by the caller. */
 void
-glitz_texture_allocate (glitz_gl_proc_address_list_t *gl,
-			glitz_texture_t              *texture)
+glitz_texture_clear_padding (glitz_gl_proc_address_list_t *gl,
+			     glitz_texture_t              *texture,
+			     unsigned long                feature_mask,
+			     glitz_gl_uint_t              fb)
 {
-    char *data = NULL;
+    glitz_box_t box[4];
+    int         i, n_box;
+
+    if (!TEXTURE_PADDING (texture))
+	return;
+
+    texture->flags &= ~GLITZ_TEXTURE_FLAG_PADDING_MASK;
+
+    n_box = _glitz_texture_padding (texture, box);
+    if (!n_box)
+	return;
+
+    if (feature_mask & GLITZ_FEATURE_CLEAR_TEXTURE_MASK)
+    {
+	for (i = 0; i < n_box; i++)
+	    gl->clear_tex_sub_image (texture->name, 0,
+				     box[i].x1, box[i].y1, 0,
+				     box[i].x2 - box[i].x1,
+				     box[i].y2 - box[i].y1, 1,
+				     GLITZ_GL_RGBA, GLITZ_GL_UNSIGNED_BYTE,
+				     NULL);
+    }
+    else if ((feature_mask & GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK) &&
+	     _glitz_texture_renderable (texture))
+    {
+	glitz_gl_uint_t clear_fb;
+	glitz_bool_t    complete = 0;
+
+	gl->gen_framebuffers (1, &clear_fb);
+	gl->bind_framebuffer (GLITZ_GL_FRAMEBUFFER, clear_fb);
+	gl->framebuffer_texture_2d (GLITZ_GL_FRAMEBUFFER,
+				    GLITZ_GL_COLOR_ATTACHMENT0,
+				    texture->target, texture->name,
+				    0);
+
+	if (gl->check_framebuffer_status (GLITZ_GL_FRAMEBUFFER) ==
+	    GLITZ_GL_FRAMEBUFFER_COMPLETE)
+	{
+	    gl->push_attrib (GLITZ_GL_SCISSOR_BIT | GLITZ_GL_COLOR_BUFFER_BIT);
+	    gl->enable (GLITZ_GL_SCISSOR_TEST);
+	    gl->color_mask (GLITZ_GL_TRUE, GLITZ_GL_TRUE,
+			    GLITZ_GL_TRUE, GLITZ_GL_TRUE);
+	    gl->clear_color (0.0f, 0.0f, 0.0f, 0.0f);
+
+	    for (i = 0; i < n_box; i++)
+	    {
+		gl->scissor (box[i].x1, box[i].y1,
+			     box[i].x2 - box[i].x1,
+			     box[i].y2 - box[i].y1);
+		gl->clear (GLITZ_GL_COLOR_BUFFER_BIT);
+	    }
+
+	    gl->pop_attrib ();
+	    complete = 1;
+	}
 
+	gl->bind_framebuffer (GLITZ_GL_FRAMEBUFFER, fb);
+	gl->delete_framebuffers (1, &clear_fb);
+
+	if (!complete)
+	    _glitz_texture_upload_padding (gl, texture, box, n_box);
+    }
+    else
+	_glitz_texture_upload_padding (gl, texture, box, n_box);
+}
+
+void
+glitz_texture_allocate (glitz_gl_proc_address_list_t *gl,
+			glitz_texture_t              *texture,
+			unsigned long                feature_mask)
+{
     if (!texture->name)
 	gl->gen_textures (1, &texture->name);
 
@@ -170,24 +345,13 @@ glitz_texture_allocate (glitz_gl_proc_address_list_t *gl,
 
     glitz_texture_bind (gl, texture);
 
-    if (TEXTURE_CLAMPABLE (texture) &&
-	(texture->box.x2 > texture->width ||
-	 texture->box.y2 > texture->height))
-    {
-	data = malloc (texture->width * texture->height);
-	if (data)
-	    memset (data, 0, texture->width * texture->height);
-
-	gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH, 0);
-	gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH, 0);
-	gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_ROWS, 0);
-	gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_PIXELS, 0);
-	gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 1);
-    }
-
-    gl->tex_image_2d (texture->target, 0, texture->format,
-		      texture->width, texture->height, 0,
-		      GLITZ_GL_ALPHA, GLITZ_GL_UNSIGNED_BYTE, data);
+    if (feature_mask & GLITZ_FEATURE_TEXTURE_STORAGE_MASK)
+	gl->tex_storage_2d (texture->target, 1, texture->format,
+			    texture->width, texture->height);
+    else
+	gl->tex_image_2d (texture->target, 0, texture->format,
+			  texture->width, texture->height, 0,
+			  GLITZ_GL_ALPHA, GLITZ_GL_UNSIGNED_BYTE, NULL);
 
     gl->tex_parameter_i (texture->target,
 			 GLITZ_GL_TEXTURE_MAG_FILTER,
@@ -198,8 +362,14 @@ glitz_texture_allocate (glitz_gl_proc_address_list_t *gl,
 
     glitz_texture_unbind (gl, texture);
 
-    if (data)
-	free (data);
+    /* cleared by glitz_texture_clear_padding once it can be sampled */
+    if (TEXTURE_CLAMPABLE (texture))
+    {
+	glitz_box_t box[4];
+
+	if (_glitz_texture_padding (texture, box))
+	    texture->flags |= GLITZ_TEXTURE_FLAG_PADDING_MASK;
+    }
 }
 
 void
@@ -243,6 +413,14 @@ glitz_texture_copy_drawable (glitz_gl_proc_address_list_t *gl,
 			     int                          x_texture,
 			     int                          y_texture)
 {
+    if (DRAWABLE_IS_MULTISAMPLE_FBO (drawable))
+    {
+	glitz_framebuffer_resolve (drawable, texture,
+				   x_drawable, y_drawable, width, height,
+				   x_texture, y_texture);
+	return;
+    }
+
     gl->copy_tex_sub_image_2d (texture->target, 0,
 			       texture->box.x1 + x_texture,
 			       texture->box.y2 - y_texture - height,
@@ -342,7 +520,8 @@ glitz_texture_object_create (glitz_surface_t *surface)
 {
     glitz_texture_object_t *texture;
 
-    GLITZ_GL_SURFACE (surface);
+    if (SURFACE_ATLAS (surface))
+	glitz_atlas_migrate (surface);
 
     /* texture dimensions must match surface dimensions */
     if (surface->texture.width  != surface->box.x2 &&
@@ -358,8 +537,11 @@ glitz_texture_object_create (glitz_surface_t *surface)
     glitz_surface_reference (surface);
     texture->surface = surface;
 
+    if (SURFACE_EVICTED (surface))
+	glitz_texture_memory_restore (surface);
+
     if (!(TEXTURE_ALLOCATED (&surface->texture)))
-	glitz_texture_allocate (gl, &surface->texture);
+	glitz_texture_memory_allocate (surface);
 
     texture->param = surface->texture.param;
 
@@ -369,8 +551,7 @@ glitz_texture_object_create (glitz_surface_t *surface)
 void
 glitz_texture_object_destroy (glitz_texture_object_t *texture)
 {
-    texture->ref_count--;
-    if (texture->ref_count)
+    if (GLITZ_ATOMIC_DEC (&texture->ref_count))
 	return;
 
     glitz_surface_destroy (texture->surface);
@@ -380,7 +561,7 @@ glitz_texture_object_destroy (glitz_texture_object_t *texture)
 void
 glitz_texture_object_reference (glitz_texture_object_t *texture)
 {
-    texture->ref_count++;
+    GLITZ_ATOMIC_INC (&texture->ref_count);
 }
 
 void
@@ -450,6 +631,14 @@ glitz_texture_ensure_parameters (glitz_gl_proc_address_list_t *gl,
     if (!texture->name)
 	return;
 
+    /* other surfaces may have changed the state of a shared texture */
+    if (TEXTURE_SHARED (texture))
+    {
+	texture->param.filter[0] = texture->param.filter[1] = 0;
+	texture->param.wrap[0] = texture->param.wrap[1] = 0;
+	texture->param.border_color.alpha = ~param->border_color.alpha;
+    }
+
     for (i = 0; i < 2; i++)
     {
 	if (texture->param.filter[i] != param->filter[i])
@@ -0,0 +1,235 @@
+/*
+ * Copyright © 2006 David Reveman
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * David Reveman not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * David Reveman makes no representations about the suitability of this
+ * software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * DAVID REVEMAN DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL DAVID REVEMAN BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Author: David Reveman <davidr@novell.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
+/* number of threads worth splitting CPU work across */
+int
+glitz_thread_count (void)
+{
+
+#ifdef HAVE_PTHREAD
+    static int count = 0;
+
+    if (!count)
+    {
+	long n = 1;
+
+#  ifdef _SC_NPROCESSORS_ONLN
+	n = sysconf (_SC_NPROCESSORS_ONLN);
+#  endif
+
+	count = (int) MAX (1, MIN (n, GLITZ_MAX_THREADS));
+    }
+
+    return count;
+#else
+    return 1;
+#endif
+
+}
+
+#ifdef HAVE_PTHREAD
+/* scratch buffers larger than this are freed when the pool is released */
+#define GLITZ_THREAD_SCRATCH_KEEP (1 << 20)
+
+/* workers are started on first use and live as long as the process.
+   lock is held by the caller between glitz_thread_pool_acquire and
+   glitz_thread_pool_release, mutex protects the job state. */
+static struct {
+    pthread_mutex_t     lock;
+    pthread_mutex_t     mutex;
+    pthread_cond_t      work_cond;
+    pthread_cond_t      done_cond;
+    glitz_bool_t        started;
+    glitz_thread_func_t func;
+    char                *jobs;
+    int                 size;
+    int                 n_jobs, next, n_done;
+    char                *scratch;
+    unsigned int        scratch_size;
+} _glitz_thread_pool = {
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    PTHREAD_COND_INITIALIZER
+};
+
+/* runs jobs until none are left to take, called with mutex held */
+static void
+_glitz_thread_pool_drain (void)
+{
+    int i;
+
+    while (_glitz_thread_pool.next < _glitz_thread_pool.n_jobs)
+    {
+	i = _glitz_thread_pool.next++;
+
+	pthread_mutex_unlock (&_glitz_thread_pool.mutex);
+	_glitz_thread_pool.func (_glitz_thread_pool.jobs +
+				 i * _glitz_thread_pool.size);
+	pthread_mutex_lock (&_glitz_thread_pool.mutex);
+
+	if (++_glitz_thread_pool.n_done == _glitz_thread_pool.n_jobs)
+	    pthread_cond_signal (&_glitz_thread_pool.done_cond);
+    }
+}
+
+static void *
+_glitz_thread_main (void *data)
+{
+    pthread_mutex_lock (&_glitz_thread_pool.mutex);
+
+    for (;;)
+    {
+	while (_glitz_thread_pool.next >= _glitz_thread_pool.n_jobs)
+	    pthread_cond_wait (&_glitz_thread_pool.work_cond,
+			       &_glitz_thread_pool.mutex);
+
+	_glitz_thread_pool_drain ();
+    }
+
+    return NULL;
+}
+#endif
+
+/* takes the worker pool for the calling thread and returns a scratch
+   buffer of at least size bytes that stays valid until
+   glitz_thread_pool_release. returns NULL if another thread has the
+   pool or memory is short, callers then do the work serially. */
+void *
+glitz_thread_pool_acquire (unsigned int size)
+{
+
+#ifdef HAVE_PTHREAD
+    if (pthread_mutex_trylock (&_glitz_thread_pool.lock))
+	return NULL;
+
+    if (!_glitz_thread_pool.started)
+    {
+	pthread_t thread;
+	int       i;
+
+	for (i = 1; i < glitz_thread_count (); i++)
+	{
+	    if (pthread_create (&thread, NULL, _glitz_thread_main, NULL))
+		break;
+
+	    pthread_detach (thread);
+	}
+
+	_glitz_thread_pool.started = 1;
+    }
+
+    if (size > _glitz_thread_pool.scratch_size)
+    {
+	char *scratch;
+
+	scratch = realloc (_glitz_thread_pool.scratch, size);
+	if (!scratch)
+	{
+	    pthread_mutex_unlock (&_glitz_thread_pool.lock);
+	    return NULL;
+	}
+
+	_glitz_thread_pool.scratch      = scratch;
+	_glitz_thread_pool.scratch_size = size;
+    }
+
+    if (!_glitz_thread_pool.scratch)
+	pthread_mutex_unlock (&_glitz_thread_pool.lock);
+
+    return _glitz_thread_pool.scratch;
+#else
+    return NULL;
+#endif
+
+}
+
+void
+glitz_thread_pool_release (void)
+{
+
+#ifdef HAVE_PTHREAD
+    if (_glitz_thread_pool.scratch_size > GLITZ_THREAD_SCRATCH_KEEP)
+    {
+	free (_glitz_thread_pool.scratch);
+	_glitz_thread_pool.scratch      = NULL;
+	_glitz_thread_pool.scratch_size = 0;
+    }
+
+    pthread_mutex_unlock (&_glitz_thread_pool.lock);
+#endif
+
+}
+
+/* calls func once for each of the n_jobs items of size bytes in jobs.
+   the calling thread must have the pool and takes items too, the call
+   returns when all items are done. items run inline if no workers
+   could be started. */
+void
+glitz_thread_run (glitz_thread_func_t func,
+		  void                *jobs,
+		  int                 n_jobs,
+		  int                 size)
+{
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock (&_glitz_thread_pool.mutex);
+
+    _glitz_thread_pool.func   = func;
+    _glitz_thread_pool.jobs   = jobs;
+    _glitz_thread_pool.size   = size;
+    _glitz_thread_pool.n_jobs = n_jobs;
+    _glitz_thread_pool.next   = 0;
+    _glitz_thread_pool.n_done = 0;
+
+    pthread_cond_broadcast (&_glitz_thread_pool.work_cond);
+
+    _glitz_thread_pool_drain ();
+
+    while (_glitz_thread_pool.n_done < n_jobs)
+	pthread_cond_wait (&_glitz_thread_pool.done_cond,
+			   &_glitz_thread_pool.mutex);
+
+    pthread_mutex_unlock (&_glitz_thread_pool.mutex);
+#else
+    char *job = jobs;
+    int  i;
+
+    for (i = 0; i < n_jobs; i++)
+	func (job + i * size);
+#endif
+
+}
@@ -0,0 +1,529 @@
+/*
+ * Copyright © 2006 David Reveman
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * David Reveman not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * David Reveman makes no representations about the suitability of this
+ * software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * DAVID REVEMAN DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL DAVID REVEMAN BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Author: David Reveman <davidr@novell.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define GLITZ_TILE_MAX_SIZE 2048
+
+#define GLITZ_TILE_FLAGS_MASK                     \
+    (GLITZ_SURFACE_FLAG_COMPONENT_ALPHA_MASK    | \
+     GLITZ_SURFACE_FLAG_DITHER_MASK             | \
+     GLITZ_SURFACE_FLAG_MULTISAMPLE_MASK        | \
+     GLITZ_SURFACE_FLAG_NICEST_MULTISAMPLE_MASK)
+
+#define GLITZ_TILE_WRAP_MASK             \
+    (GLITZ_SURFACE_FLAG_REPEAT_MASK    | \
+     GLITZ_SURFACE_FLAG_MIRRORED_MASK  | \
+     GLITZ_SURFACE_FLAG_PAD_MASK)
+
+glitz_bool_t
+glitz_tile_grid_create (glitz_surface_t *surface)
+{
+    glitz_backend_t   *backend = surface->drawable->backend;
+    glitz_tile_grid_t *grid;
+    int               size, n;
+
+    if (surface->format->color.fourcc != GLITZ_FOURCC_RGB)
+	return 0;
+
+    size = GLITZ_TILE_MAX_SIZE;
+    while (size > backend->max_texture_2d_size)
+	size >>= 1;
+
+    if (size < 64)
+	return 0;
+
+    n = ((surface->box.x2 + size - 1) / size) *
+	((surface->box.y2 + size - 1) / size);
+
+    grid = calloc (1, sizeof (glitz_tile_grid_t) +
+		   n * (sizeof (glitz_surface_t *) + sizeof (unsigned int)));
+    if (!grid)
+	return 0;
+
+    grid->size  = size;
+    grid->n_x   = (surface->box.x2 + size - 1) / size;
+    grid->n_y   = (surface->box.y2 + size - 1) / size;
+    grid->tiles = (glitz_surface_t **) (grid + 1);
+    grid->clip_serials = (unsigned int *) (grid->tiles + n);
+
+    surface->grid   = grid;
+    surface->flags |= GLITZ_SURFACE_FLAG_TILED_MASK;
+
+    return 1;
+}
+
+void
+glitz_tile_grid_destroy (glitz_surface_t *surface)
+{
+    glitz_tile_grid_t *grid = surface->grid;
+    int               i;
+
+    if (!grid)
+	return;
+
+    for (i = 0; i < grid->n_x * grid->n_y; i++)
+	if (grid->tiles[i])
+	    glitz_surface_destroy (grid->tiles[i]);
+
+    free (grid);
+
+    surface->grid   = NULL;
+    surface->flags &= ~GLITZ_SURFACE_FLAG_TILED_MASK;
+}
+
+static void
+_glitz_tile_box (glitz_surface_t *surface,
+		 int             col,
+		 int             row,
+		 glitz_box_t     *box)
+{
+    int size = surface->grid->size;
+
+    box->x1 = col * size;
+    box->y1 = row * size;
+    box->x2 = MIN (box->x1 + size, surface->box.x2);
+    box->y2 = MIN (box->y1 + size, surface->box.y2);
+}
+
+/* tiles are created on first use and start out fully transparent */
+static glitz_surface_t *
+_glitz_tile_get (glitz_surface_t *surface,
+		 int             col,
+		 int             row,
+		 glitz_bool_t    create)
+{
+    static const glitz_color_t clear = { 0, 0, 0, 0 };
+    glitz_surface_t            **tile;
+    glitz_box_t                box;
+
+    tile = &surface->grid->tiles[row * surface->grid->n_x + col];
+    if (*tile || !create)
+	return *tile;
+
+    _glitz_tile_box (surface, col, row, &box);
+
+    *tile = glitz_surface_create (surface->drawable, surface->format,
+				  box.x2 - box.x1, box.y2 - box.y1,
+				  0, NULL);
+    if (!*tile)
+    {
+	glitz_surface_status_add (surface, GLITZ_STATUS_NO_MEMORY_MASK);
+	return NULL;
+    }
+
+    glitz_set_rectangle (*tile, &clear, 0, 0,
+			 box.x2 - box.x1, box.y2 - box.y1);
+
+    return *tile;
+}
+
+/* propagate state of the tiled surface to a tile before it's used. the
+   clip is only set again when the tiled surface's clip changed, so the
+   tile keeps its clip serial and stencil contents. */
+static void
+_glitz_tile_validate (glitz_surface_t *surface,
+		      glitz_surface_t *tile,
+		      glitz_box_t     *box)
+{
+    glitz_tile_grid_t *grid = surface->grid;
+    unsigned int      *serial;
+
+    serial = &grid->clip_serials[(box->y1 / grid->size) * grid->n_x +
+				 box->x1 / grid->size];
+
+    tile->flags &= ~GLITZ_TILE_FLAGS_MASK;
+    tile->flags |= surface->flags & GLITZ_TILE_FLAGS_MASK;
+
+    if (tile->filter != surface->filter)
+	glitz_surface_set_filter (tile, surface->filter, NULL, 0);
+
+    if (*serial != surface->clip_serial)
+    {
+	glitz_surface_set_clip_region (tile,
+				       surface->x_clip - box->x1,
+				       surface->y_clip - box->y1,
+				       surface->clip, surface->n_clip);
+	*serial = surface->clip_serial;
+    }
+}
+
+static void
+_glitz_tile_status (glitz_surface_t *surface,
+		    glitz_surface_t *tile)
+{
+    surface->status_mask |= tile->status_mask;
+    tile->status_mask = 0;
+}
+
+/* only untransformed, non-repeating sources can be split at tile
+   boundaries without changing the result */
+static glitz_bool_t
+_glitz_tile_source_supported (glitz_surface_t *surface)
+{
+    if (surface->transform || (surface->flags & GLITZ_TILE_WRAP_MASK))
+	return 0;
+
+    switch (surface->filter) {
+    case GLITZ_FILTER_NEAREST:
+    case GLITZ_FILTER_BILINEAR:
+	return 1;
+    default:
+	return 0;
+    }
+}
+
+static glitz_bool_t
+_glitz_tile_clip (glitz_surface_t *surface,
+		  int             x,
+		  int             y,
+		  int             width,
+		  int             height,
+		  glitz_box_t     *bounds)
+{
+    bounds->x1 = MAX (x, 0);
+    bounds->y1 = MAX (y, 0);
+    bounds->x2 = MIN (x + width,  surface->box.x2);
+    bounds->y2 = MIN (y + height, surface->box.y2);
+
+    return (bounds->x1 < bounds->x2 && bounds->y1 < bounds->y2);
+}
+
+void
+glitz_tiled_composite (glitz_operator_t op,
+		       glitz_surface_t  *src,
+		       glitz_surface_t  *mask,
+		       glitz_surface_t  *dst,
+		       int              x_src,
+		       int              y_src,
+		       int              x_mask,
+		       int              y_mask,
+		       int              x_dst,
+		       int              y_dst,
+		       int              width,
+		       int              height)
+{
+    glitz_surface_t *tiled, *tile;
+    glitz_box_t     bounds, box, tbox;
+    int             x, y, col, row, size;
+
+    if (SURFACE_TILED (dst))
+    {
+	tiled = dst;
+	x = x_dst;
+	y = y_dst;
+    }
+    else if (src && SURFACE_TILED (src))
+    {
+	tiled = src;
+	x = x_src;
+	y = y_src;
+    }
+    else
+    {
+	tiled = mask;
+	x = x_mask;
+	y = y_mask;
+    }
+
+    /* tiles don't share the geometry of the tiled surface, so only
+       plain rectangles can be split across them */
+    if ((tiled != dst && !_glitz_tile_source_supported (tiled)) ||
+	(SURFACE_TILED (dst) &&
+	 (dst->geometry.type != GLITZ_GEOMETRY_TYPE_NONE ||
+	  dst->geometry.array || dst->geometry.path)))
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	return;
+    }
+
+    if (!_glitz_tile_clip (tiled, x, y, width, height, &bounds))
+	return;
+
+    size = tiled->grid->size;
+
+    for (row = bounds.y1 / size; row <= (bounds.y2 - 1) / size; row++)
+    {
+	for (col = bounds.x1 / size; col <= (bounds.x2 - 1) / size; col++)
+	{
+	    glitz_surface_t *s = src, *m = mask, *d = dst;
+	    int             dx, dy;
+
+	    tile = _glitz_tile_get (tiled, col, row, 1);
+	    if (!tile)
+		continue;
+
+	    _glitz_tile_box (tiled, col, row, &tbox);
+	    _glitz_tile_validate (tiled, tile, &tbox);
+
+	    box.x1 = MAX (tbox.x1, bounds.x1);
+	    box.y1 = MAX (tbox.y1, bounds.y1);
+	    box.x2 = MIN (tbox.x2, bounds.x2);
+	    box.y2 = MIN (tbox.y2, bounds.y2);
+
+	    dx = box.x1 - x;
+	    dy = box.y1 - y;
+
+	    if (tiled == dst)
+		d = tile;
+	    else if (tiled == src)
+		s = tile;
+	    else
+		m = tile;
+
+	    glitz_composite (op, s, m, d,
+			     x_src  + dx - ((s == tile) ? tbox.x1 : 0),
+			     y_src  + dy - ((s == tile) ? tbox.y1 : 0),
+			     x_mask + dx - ((m == tile) ? tbox.x1 : 0),
+			     y_mask + dy - ((m == tile) ? tbox.y1 : 0),
+			     x_dst  + dx - ((d == tile) ? tbox.x1 : 0),
+			     y_dst  + dy - ((d == tile) ? tbox.y1 : 0),
+			     box.x2 - box.x1, box.y2 - box.y1);
+
+	    _glitz_tile_status (dst, tile);
+	}
+    }
+}
+
+void
+glitz_tiled_copy_area (glitz_surface_t *src,
+		       glitz_surface_t *dst,
+		       int             x_src,
+		       int             y_src,
+		       int             width,
+		       int             height,
+		       int             x_dst,
+		       int             y_dst)
+{
+    glitz_surface_t *tiled, *tile;
+    glitz_box_t     bounds, box, tbox;
+    int             x, y, col, row, size;
+
+    if (SURFACE_TILED (dst))
+    {
+	tiled = dst;
+	x = x_dst;
+	y = y_dst;
+    }
+    else
+    {
+	tiled = src;
+	x = x_src;
+	y = y_src;
+    }
+
+    if (!_glitz_tile_clip (tiled, x, y, width, height, &bounds))
+	return;
+
+    size = tiled->grid->size;
+
+    for (row = bounds.y1 / size; row <= (bounds.y2 - 1) / size; row++)
+    {
+	for (col = bounds.x1 / size; col <= (bounds.x2 - 1) / size; col++)
+	{
+	    int dx, dy;
+
+	    /* copying from a tile that was never written is a no-op */
+	    tile = _glitz_tile_get (tiled, col, row, tiled == dst);
+	    if (!tile)
+		continue;
+
+	    _glitz_tile_box (tiled, col, row, &tbox);
+	    _glitz_tile_validate (tiled, tile, &tbox);
+
+	    box.x1 = MAX (tbox.x1, bounds.x1);
+	    box.y1 = MAX (tbox.y1, bounds.y1);
+	    box.x2 = MIN (tbox.x2, bounds.x2);
+	    box.y2 = MIN (tbox.y2, bounds.y2);
+
+	    dx = box.x1 - x;
+	    dy = box.y1 - y;
+
+	    if (tiled == dst)
+		glitz_copy_area (src, tile,
+				 x_src + dx, y_src + dy,
+				 box.x2 - box.x1, box.y2 - box.y1,
+				 box.x1 - tbox.x1, box.y1 - tbox.y1);
+	    else
+		glitz_copy_area (tile, dst,
+				 box.x1 - tbox.x1, box.y1 - tbox.y1,
+				 box.x2 - box.x1, box.y2 - box.y1,
+				 x_dst + dx, y_dst + dy);
+
+	    _glitz_tile_status (dst, tile);
+	}
+    }
+}
+
+/* pixel format addressing the part of a client image that covers box */
+static void
+_glitz_tile_pixel_format (glitz_pixel_format_t *format,
+			  int                  x,
+			  int                  y,
+			  int                  width,
+			  int                  height,
+			  glitz_box_t          *box,
+			  glitz_pixel_format_t *tile_format)
+{
+    *tile_format = *format;
+
+    if (!tile_format->bytes_per_line)
+	tile_format->bytes_per_line = (width * format->masks.bpp) / 8;
+
+    tile_format->xoffset += box->x1 - x;
+
+    if (format->scanline_order == GLITZ_PIXEL_SCANLINE_ORDER_TOP_DOWN)
+	tile_format->skip_lines += box->y1 - y;
+    else
+	tile_format->skip_lines += (y + height) - box->y2;
+}
+
+void
+glitz_tiled_set_pixels (glitz_surface_t      *dst,
+			int                  x_dst,
+			int                  y_dst,
+			int                  width,
+			int                  height,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer)
+{
+    glitz_pixel_format_t tile_format;
+    glitz_surface_t      *tile;
+    glitz_box_t          bounds, box, tbox;
+    int                  col, row, size;
+
+    if (!_glitz_tile_clip (dst, x_dst, y_dst, width, height, &bounds))
+	return;
+
+    size = dst->grid->size;
+
+    for (row = bounds.y1 / size; row <= (bounds.y2 - 1) / size; row++)
+    {
+	for (col = bounds.x1 / size; col <= (bounds.x2 - 1) / size; col++)
+	{
+	    tile = _glitz_tile_get (dst, col, row, 1);
+	    if (!tile)
+		continue;
+
+	    _glitz_tile_box (dst, col, row, &tbox);
+	    _glitz_tile_validate (dst, tile, &tbox);
+
+	    box.x1 = MAX (tbox.x1, bounds.x1);
+	    box.y1 = MAX (tbox.y1, bounds.y1);
+	    box.x2 = MIN (tbox.x2, bounds.x2);
+	    box.y2 = MIN (tbox.y2, bounds.y2);
+
+	    _glitz_tile_pixel_format (format, x_dst, y_dst, width, height,
+				      &box, &tile_format);
+
+	    glitz_set_pixels (tile,
+			      box.x1 - tbox.x1, box.y1 - tbox.y1,
+			      box.x2 - box.x1, box.y2 - box.y1,
+			      &tile_format, buffer);
+
+	    _glitz_tile_status (dst, tile);
+	}
+    }
+}
+
+void
+glitz_tiled_get_pixels (glitz_surface_t      *src,
+			int                  x_src,
+			int                  y_src,
+			int                  width,
+			int                  height,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer)
+{
+    glitz_pixel_format_t tile_format;
+    glitz_surface_t      *tile;
+    glitz_box_t          bounds, box, tbox;
+    int                  col, row, size;
+
+    if (!_glitz_tile_clip (src, x_src, y_src, width, height, &bounds))
+	return;
+
+    size = src->grid->size;
+
+    for (row = bounds.y1 / size; row <= (bounds.y2 - 1) / size; row++)
+    {
+	for (col = bounds.x1 / size; col <= (bounds.x2 - 1) / size; col++)
+	{
+	    _glitz_tile_box (src, col, row, &tbox);
+
+	    box.x1 = MAX (tbox.x1, bounds.x1);
+	    box.y1 = MAX (tbox.y1, bounds.y1);
+	    box.x2 = MIN (tbox.x2, bounds.x2);
+	    box.y2 = MIN (tbox.y2, bounds.y2);
+
+	    _glitz_tile_pixel_format (format, x_src, y_src, width, height,
+				      &box, &tile_format);
+
+	    /* unwritten tiles read back as transparent without being
+	       allocated */
+	    tile = _glitz_tile_get (src, col, row,
+				    format->masks.bpp % 8);
+	    if (!tile)
+	    {
+		int  bpp = format->masks.bpp / 8;
+		int  y;
+		char *data;
+
+		data = glitz_buffer_map (buffer,
+					 GLITZ_BUFFER_ACCESS_WRITE_ONLY);
+		if (!data)
+		    continue;
+
+		data += tile_format.skip_lines * tile_format.bytes_per_line +
+		    tile_format.xoffset * bpp;
+
+		for (y = box.y1; y < box.y2; y++)
+		{
+		    memset (data, 0, (box.x2 - box.x1) * bpp);
+		    data += tile_format.bytes_per_line;
+		}
+
+		glitz_buffer_unmap (buffer);
+		continue;
+	    }
+
+	    _glitz_tile_validate (src, tile, &tbox);
+
+	    glitz_get_pixels (tile,
+			      box.x1 - tbox.x1, box.y1 - tbox.y1,
+			      box.x2 - box.x1, box.y2 - box.y1,
+			      &tile_format, buffer);
+
+	    _glitz_tile_status (src, tile);
+	}
+    }
+}
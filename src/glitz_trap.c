@@ -281,25 +281,33 @@ _glitz_pixel_area (glitz_float_t pixel_x,
 
 #define UNIT  glitz_short_t
 #define TRAPS _glitz_add_trapezoids_short
+#define EDGES _glitz_add_trapezoid_edges_short
 #include "glitz_trapimp.h"
+#undef  EDGES
 #undef  TRAPS
 #undef  UNIT
 
 #define UNIT  glitz_int_t
 #define TRAPS _glitz_add_trapezoids_int
+#define EDGES _glitz_add_trapezoid_edges_int
 #include "glitz_trapimp.h"
+#undef  EDGES
 #undef  TRAPS
 #undef  UNIT
 
 #define UNIT  glitz_float_t
 #define TRAPS _glitz_add_trapezoids_float
+#define EDGES _glitz_add_trapezoid_edges_float
 #include "glitz_trapimp.h"
+#undef  EDGES
 #undef  TRAPS
 #undef  UNIT
 
 #define UNIT  glitz_double_t
 #define TRAPS _glitz_add_trapezoids_double
+#define EDGES _glitz_add_trapezoid_edges_double
 #include "glitz_trapimp.h"
+#undef  EDGES
 #undef  TRAPS
 #undef  UNIT
 
@@ -331,31 +339,159 @@ _glitz_pixel_area (glitz_float_t pixel_x,
 
 #define UNIT  glitz_short_t
 #define TRAPS _glitz_add_traps_short
+#define EDGES _glitz_add_trap_edges_short
 #include "glitz_trapimp.h"
+#undef  EDGES
 #undef  TRAPS
 #undef  UNIT
 
 #define UNIT  glitz_int_t
 #define TRAPS _glitz_add_traps_int
+#define EDGES _glitz_add_trap_edges_int
 #include "glitz_trapimp.h"
+#undef  EDGES
 #undef  TRAPS
 #undef  UNIT
 
 #define UNIT  glitz_float_t
 #define TRAPS _glitz_add_traps_float
+#define EDGES _glitz_add_trap_edges_float
 #include "glitz_trapimp.h"
+#undef  EDGES
 #undef  TRAPS
 #undef  UNIT
 
 #define UNIT  glitz_double_t
 #define TRAPS _glitz_add_traps_double
+#define EDGES _glitz_add_trap_edges_double
 #include "glitz_trapimp.h"
+#undef  EDGES
 #undef  TRAPS
 #undef  UNIT
 
 #undef  TRAP
 #undef  TRAPINIT
 
+typedef unsigned int (*glitz_traps_func_t) (void            *ptr,
+					    unsigned int    size,
+					    glitz_surface_t *mask,
+					    void            *traps,
+					    int             *n_traps);
+
+typedef struct _glitz_traps_job {
+    glitz_traps_func_t func;
+    glitz_surface_t    *mask;
+    void               *traps;
+    int                n_traps;
+    void               *ptr;
+    unsigned int       size;
+    unsigned int       count;
+} glitz_traps_job_t;
+
+/* fewer trapezoids than this per thread are not worth a thread */
+#define GLITZ_TRAPS_PER_THREAD 1024
+
+/* scratch space given to each part per trapezoid and in total. a part
+   that doesn't fit is tessellated again serially, so these only trade
+   memory for how much work runs in parallel */
+#define GLITZ_TRAPS_SCRATCH_PER_TRAP 512
+#define GLITZ_TRAPS_SCRATCH_MAX      (4 << 20)
+
+static void
+_glitz_traps_job_run (void *data)
+{
+    glitz_traps_job_t *job = (glitz_traps_job_t *) data;
+
+    job->count = job->func (job->ptr, job->size, job->mask,
+			    job->traps, &job->n_traps);
+}
+
+/*
+  Large trapezoid arrays are split in equal parts. The first part is
+  tessellated straight into the vertex buffer and every other part into
+  a scratch buffer of its own, in parallel. Parts are then appended in
+  order for as long as they fit. The part that doesn't fit is
+  tessellated again directly into what remains of the vertex buffer so
+  that the partially added semantics are the same as when running
+  serially.
+*/
+static unsigned int
+_glitz_add_traps_parallel (glitz_traps_func_t func,
+			   int                trap_size,
+			   void               *ptr,
+			   unsigned int       size,
+			   glitz_surface_t    *mask,
+			   void               *traps,
+			   int                *n_traps)
+{
+    glitz_traps_job_t job[GLITZ_MAX_THREADS];
+    char              *scratch;
+    unsigned int      count, part_size;
+    int               i, n_jobs, n, n_total, start, end;
+
+    n_jobs = MIN (glitz_thread_count (), *n_traps / GLITZ_TRAPS_PER_THREAD);
+    if (n_jobs < 2)
+	return func (ptr, size, mask, traps, n_traps);
+
+    n = *n_traps / n_jobs;
+
+    /* the last part is the largest */
+    part_size = (*n_traps - (n_jobs - 1) * n) * GLITZ_TRAPS_SCRATCH_PER_TRAP;
+    part_size = MIN (part_size, size);
+    part_size = MIN (part_size, GLITZ_TRAPS_SCRATCH_MAX / (n_jobs - 1));
+    part_size &= ~15;
+
+    scratch = glitz_thread_pool_acquire ((n_jobs - 1) * part_size);
+    if (!scratch)
+	return func (ptr, size, mask, traps, n_traps);
+
+    for (i = 0; i < n_jobs; i++)
+    {
+	job[i].func    = func;
+	job[i].mask    = mask;
+	job[i].traps   = (char *) traps + i * n * trap_size;
+	job[i].n_traps = (i == n_jobs - 1)? *n_traps - i * n: n;
+	job[i].ptr     = (i)? scratch + (i - 1) * part_size: ptr;
+	job[i].size    = (i)? part_size: size;
+    }
+
+    glitz_thread_run (_glitz_traps_job_run, job, n_jobs,
+		      sizeof (glitz_traps_job_t));
+
+    n_total = *n_traps;
+    count = 0;
+
+    for (i = 0; i < n_jobs; i++)
+    {
+	start = i * n;
+	end = (i == n_jobs - 1)? n_total: start + n;
+
+	if (i)
+	{
+	    if (job[i].n_traps || job[i].count > size - count)
+	    {
+		/* redo this part with the space that is left */
+		*n_traps = n_total - start;
+		count += func ((char *) ptr + count, size - count, mask,
+			       job[i].traps, n_traps);
+		break;
+	    }
+
+	    memcpy ((char *) ptr + count, job[i].ptr, job[i].count);
+	}
+
+	count += job[i].count;
+
+	*n_traps = n_total - end + job[i].n_traps;
+	if (job[i].n_traps)
+	    break;
+    }
+
+    glitz_thread_pool_release ();
+
+    return count;
+}
+
 int
 glitz_add_trapezoids (glitz_buffer_t    *buffer,
 		      int               offset,
@@ -366,33 +502,41 @@ glitz_add_trapezoids (glitz_buffer_t    *buffer,
 		      int               n_traps,
 		      int               *n_added)
 {
-    int     count, n = n_traps;
-    uint8_t *ptr;
+    glitz_traps_func_t func;
+    int                count, n = n_traps;
+    uint8_t            *ptr;
 
     *n_added = 0;
 
-    ptr = glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_WRITE_ONLY);
+    /* what follows the written vertices is undefined afterwards */
+    ptr = glitz_buffer_map_range (buffer, offset, size,
+				  GLITZ_BUFFER_ACCESS_WRITE_ONLY,
+				  GLITZ_BUFFER_MAP_INVALIDATE_RANGE_MASK |
+				  GLITZ_BUFFER_MAP_FLUSH_EXPLICIT_MASK);
     if (!ptr)
 	return 0;
 
-    ptr += offset;
-
     switch (type) {
     case GLITZ_DATA_TYPE_SHORT:
-	count = _glitz_add_trapezoids_short (ptr, size, mask, traps, &n_traps);
+	func = _glitz_add_trapezoids_short;
 	break;
     case GLITZ_DATA_TYPE_INT:
-	count = _glitz_add_trapezoids_int (ptr, size, mask, traps, &n_traps);
+	func = _glitz_add_trapezoids_int;
 	break;
     case GLITZ_DATA_TYPE_DOUBLE:
-	count = _glitz_add_trapezoids_double (ptr, size, mask,
-					      traps, &n_traps);
+	func = _glitz_add_trapezoids_double;
 	break;
     default:
-	count = _glitz_add_trapezoids_float (ptr, size, mask, traps, &n_traps);
+	func = _glitz_add_trapezoids_float;
 	break;
     }
 
+    count = _glitz_add_traps_parallel (func, sizeof (glitz_trapezoid_t),
+				       ptr, size, mask, traps, &n_traps);
+
+    if (count)
+	glitz_buffer_flush_range (buffer, 0, count);
+
     if (glitz_buffer_unmap (buffer))
 	return 0;
 
@@ -411,32 +555,142 @@ glitz_add_traps (glitz_buffer_t    *buffer,
 		 int               n_traps,
 		 int               *n_added)
 {
-    int     count, n = n_traps;
-    uint8_t *ptr;
+    glitz_traps_func_t func;
+    int                count, n = n_traps;
+    uint8_t            *ptr;
 
     *n_added = 0;
 
-    ptr = glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_WRITE_ONLY);
+    ptr = glitz_buffer_map_range (buffer, offset, size,
+				  GLITZ_BUFFER_ACCESS_WRITE_ONLY,
+				  GLITZ_BUFFER_MAP_INVALIDATE_RANGE_MASK |
+				  GLITZ_BUFFER_MAP_FLUSH_EXPLICIT_MASK);
     if (!ptr)
 	return 0;
 
-    ptr += offset;
+    switch (type) {
+    case GLITZ_DATA_TYPE_SHORT:
+	func = _glitz_add_traps_short;
+	break;
+    case GLITZ_DATA_TYPE_INT:
+	func = _glitz_add_traps_int;
+	break;
+    case GLITZ_DATA_TYPE_DOUBLE:
+	func = _glitz_add_traps_double;
+	break;
+    default:
+	func = _glitz_add_traps_float;
+	break;
+    }
+
+    count = _glitz_add_traps_parallel (func, sizeof (glitz_trap_t),
+				       ptr, size, mask, traps, &n_traps);
+
+    if (count)
+	glitz_buffer_flush_range (buffer, 0, count);
+
+    if (glitz_buffer_unmap (buffer))
+	return 0;
+
+    *n_added = n - n_traps;
+
+    return count;
+}
+
+int
+glitz_add_trapezoid_edges (glitz_buffer_t    *buffer,
+			   int               offset,
+			   unsigned int      size,
+			   glitz_data_type_t type,
+			   glitz_trapezoid_t *traps,
+			   int               n_traps,
+			   int               *n_added)
+{
+    glitz_traps_func_t func;
+    int                count, n = n_traps;
+    uint8_t            *ptr;
+
+    *n_added = 0;
+
+    ptr = glitz_buffer_map_range (buffer, offset, size,
+				  GLITZ_BUFFER_ACCESS_WRITE_ONLY,
+				  GLITZ_BUFFER_MAP_INVALIDATE_RANGE_MASK |
+				  GLITZ_BUFFER_MAP_FLUSH_EXPLICIT_MASK);
+    if (!ptr)
+	return 0;
 
     switch (type) {
     case GLITZ_DATA_TYPE_SHORT:
-	count = _glitz_add_traps_short (ptr, size, mask, traps, &n_traps);
+	func = _glitz_add_trapezoid_edges_short;
 	break;
     case GLITZ_DATA_TYPE_INT:
-	count = _glitz_add_traps_int (ptr, size, mask, traps, &n_traps);
+	func = _glitz_add_trapezoid_edges_int;
 	break;
     case GLITZ_DATA_TYPE_DOUBLE:
-	count = _glitz_add_traps_double (ptr, size, mask, traps, &n_traps);
+	func = _glitz_add_trapezoid_edges_double;
 	break;
     default:
-	count = _glitz_add_traps_float (ptr, size, mask, traps, &n_traps);
+	func = _glitz_add_trapezoid_edges_float;
 	break;
     }
 
+    count = _glitz_add_traps_parallel (func, sizeof (glitz_trapezoid_t),
+				       ptr, size, NULL, traps, &n_traps);
+
+    if (count)
+	glitz_buffer_flush_range (buffer, 0, count);
+
+    if (glitz_buffer_unmap (buffer))
+	return 0;
+
+    *n_added = n - n_traps;
+
+    return count;
+}
+
+int
+glitz_add_trap_edges (glitz_buffer_t    *buffer,
+		      int               offset,
+		      unsigned int      size,
+		      glitz_data_type_t type,
+		      glitz_trap_t      *traps,
+		      int               n_traps,
+		      int               *n_added)
+{
+    glitz_traps_func_t func;
+    int                count, n = n_traps;
+    uint8_t            *ptr;
+
+    *n_added = 0;
+
+    ptr = glitz_buffer_map_range (buffer, offset, size,
+				  GLITZ_BUFFER_ACCESS_WRITE_ONLY,
+				  GLITZ_BUFFER_MAP_INVALIDATE_RANGE_MASK |
+				  GLITZ_BUFFER_MAP_FLUSH_EXPLICIT_MASK);
+    if (!ptr)
+	return 0;
+
+    switch (type) {
+    case GLITZ_DATA_TYPE_SHORT:
+	func = _glitz_add_trap_edges_short;
+	break;
+    case GLITZ_DATA_TYPE_INT:
+	func = _glitz_add_trap_edges_int;
+	break;
+    case GLITZ_DATA_TYPE_DOUBLE:
+	func = _glitz_add_trap_edges_double;
+	break;
+    default:
+	func = _glitz_add_trap_edges_float;
+	break;
+    }
+
+    count = _glitz_add_traps_parallel (func, sizeof (glitz_trap_t),
+				       ptr, size, NULL, traps, &n_traps);
+
+    if (count)
+	glitz_buffer_flush_range (buffer, 0, count);
+
     if (glitz_buffer_unmap (buffer))
 	return 0;
 
@@ -27,6 +27,7 @@
   Define the following before including this file:
 
   TRAPS    name of function for adding trapezoids
+  EDGES    name of function for adding trapezoid edges
   UNIT     type of underlying vertex unit
   TRAP     type of underlying trapezoid structure
   TRAPINIT initialization code for underlying trapezoid structure
@@ -204,9 +205,10 @@ static unsigned int
 TRAPS (void            *ptr,
        unsigned int    size,
        glitz_surface_t *mask,
-       TRAP            *traps,
+       void            *data,
        int             *n_traps)
 {
+    TRAP          *traps = (TRAP *) data;
     unsigned int  toff = 0, offset = 0;
     UNIT          *vptr = (UNIT *) ptr;
     glitz_float_t *tptr = (glitz_float_t *) (vptr + 2);
@@ -730,6 +732,97 @@ TRAPS (void            *ptr,
     return toff;
 }
 
+#define EDGE_BYTES_PER_VERTEX (2 * sizeof (UNIT) + 4 * sizeof (glitz_float_t))
+#define EDGE_BYTES_PER_QUAD   (4 * EDGE_BYTES_PER_VERTEX)
+
+#define EDGE_VSKIP (EDGE_BYTES_PER_VERTEX / sizeof (UNIT))
+#define EDGE_TSKIP (EDGE_BYTES_PER_VERTEX / sizeof (glitz_float_t))
+
+#define ADD_EDGE_VERTEX(vptr, tptr, _x, _y)                     \
+    (vptr)[0]  = (UNIT) (_x);                                   \
+    (vptr)[1]  = (UNIT) (_y);                                   \
+    (tptr)[0]  = ((_x) - EDGE_X (&left, _y)) * lscale;          \
+    (tptr)[1]  = (EDGE_X (&right, _y) - (_x)) * rscale;         \
+    (tptr)[2]  = (_y) - top;                                    \
+    (tptr)[3]  = bottom - (_y);                                 \
+    (vptr)    += EDGE_VSKIP;                                    \
+    (tptr)    += EDGE_TSKIP
+
+/*
+  This function generates one quad per trapezoid for analytic
+  anti-aliasing with the EDGE_COVERAGE filter. The quad covers the
+  trapezoid bounds and each vertex carries its distance to the left,
+  right, top and bottom edges. Distances are measured along the major
+  axis of each edge so that the interpolated value is pixel coverage
+  for pixels crossed by a single edge, except in the corners where a
+  slanted edge enters and leaves the pixel.
+
+  primitive   : QUADS
+  type        : SHORT|INT|FLOAT|DOUBLE
+  stride      : 2 * sizeof (type) + 4 * sizeof (FLOAT)
+  attributes  : MASK_COORD
+  mask.type   : FLOAT
+  mask.size   : COORDINATE_SIZE_XYZW
+  mask.offset : 2 * sizeof (type)
+*/
+static unsigned int
+EDGES (void            *ptr,
+       unsigned int    size,
+       glitz_surface_t *mask,
+       void            *data,
+       int             *n_traps)
+{
+    TRAP          *traps = (TRAP *) data;
+    unsigned int  offset = 0;
+    UNIT          *vptr = (UNIT *) ptr;
+    glitz_float_t *tptr = (glitz_float_t *) (vptr + 2);
+
+    glitz_edge_t  left, right;
+    glitz_float_t top, bottom;
+    glitz_float_t lscale, rscale;
+    glitz_float_t x1, x2, y1, y2;
+
+    size -= size % EDGE_BYTES_PER_QUAD;
+
+    for (; *n_traps; (*n_traps)--, traps++)
+    {
+	TRAPINIT (traps, top, bottom, &left, &right);
+
+	x1 = floorf (MIN (left.tx, left.bx));
+	x2 = ceilf (MAX (right.tx, right.bx));
+	if (x2 <= x1)
+	    continue;
+
+	if (offset == size)
+	    break;
+
+	offset += EDGE_BYTES_PER_QUAD;
+
+	y1 = floorf (top);
+	y2 = ceilf (bottom);
+
+	lscale = fabsf (left.ky);
+	if (!left.dx || lscale > 1.0f)
+	    lscale = 1.0f;
+
+	rscale = fabsf (right.ky);
+	if (!right.dx || rscale > 1.0f)
+	    rscale = 1.0f;
+
+	ADD_EDGE_VERTEX (vptr, tptr, x1, y1);
+	ADD_EDGE_VERTEX (vptr, tptr, x2, y1);
+	ADD_EDGE_VERTEX (vptr, tptr, x2, y2);
+	ADD_EDGE_VERTEX (vptr, tptr, x1, y2);
+    }
+
+    return offset;
+}
+
+#undef ADD_EDGE_VERTEX
+#undef EDGE_TSKIP
+#undef EDGE_VSKIP
+#undef EDGE_BYTES_PER_QUAD
+#undef EDGE_BYTES_PER_VERTEX
 #undef ADD_RIGHT_EDGE
 #undef ADD_LEFT_EDGE
 #undef CALC_RIGHT_EDGE
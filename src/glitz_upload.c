@@ -0,0 +1,467 @@
+/*
+ * Copyright © 2006 David Reveman
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * David Reveman not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * David Reveman makes no representations about the suitability of this
+ * software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * DAVID REVEMAN DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL DAVID REVEMAN BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Author: David Reveman <davidr@novell.com>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+typedef struct _glitz_upload_rect {
+    glitz_box_t   box;
+    unsigned long offset;
+} glitz_upload_rect_t;
+
+/* a texture update handed to an upload worker. the worker owns it
+   until done is set, the surface it belongs to after that. */
+struct _glitz_upload {
+    glitz_upload_t      *next;
+    glitz_gl_uint_t     name;
+    glitz_gl_enum_t     target;
+    int                 x, y2;
+    glitz_gl_enum_t     format, type;
+    int                 alignment, row_length;
+    char                *data;
+    glitz_upload_rect_t *rects;
+    int                 n_rects;
+    glitz_gl_sync_t     ready;
+    glitz_gl_sync_t     fence;
+    int                 done;
+};
+
+#ifdef HAVE_PTHREAD
+typedef struct _glitz_upload_worker {
+    glitz_uploader_t *uploader;
+    glitz_drawable_t *drawable;
+    glitz_context_t  *context;
+    pthread_t        thread;
+} glitz_upload_worker_t;
+
+struct _glitz_uploader {
+    pthread_mutex_t       mutex;
+    pthread_cond_t        work_cond;
+    pthread_cond_t        done_cond;
+    glitz_upload_t        *head, *tail;
+    glitz_bool_t          quit;
+    int                   n_workers;
+    glitz_upload_worker_t *workers;
+};
+
+static void
+_glitz_upload_run (glitz_gl_proc_address_list_t *gl,
+		   glitz_upload_t               *upload)
+{
+    glitz_upload_rect_t *rect = upload->rects;
+    int                 n = upload->n_rects;
+
+    /* rendering queued before the upload may still sample the texture */
+    gl->wait_sync (upload->ready, 0, GLITZ_GL_TIMEOUT_IGNORED);
+    gl->delete_sync (upload->ready);
+    upload->ready = NULL;
+
+    gl->bind_texture (upload->target, upload->name);
+
+    gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_PIXELS, 0);
+    gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_ROWS, 0);
+    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, upload->alignment);
+    gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH, upload->row_length);
+
+    for (; n; n--, rect++)
+	gl->tex_sub_image_2d (upload->target, 0,
+			      upload->x + rect->box.x1,
+			      upload->y2 - rect->box.y2,
+			      rect->box.x2 - rect->box.x1,
+			      rect->box.y2 - rect->box.y1,
+			      upload->format, upload->type,
+			      upload->data + rect->offset);
+
+    gl->bind_texture (upload->target, 0);
+
+    upload->fence = gl->fence_sync (GLITZ_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    /* the fence must reach the server before another context waits
+       for it */
+    gl->flush ();
+
+    free (upload->data);
+    upload->data = NULL;
+}
+
+static void *
+_glitz_upload_main (void *data)
+{
+    glitz_upload_worker_t        *worker = data;
+    glitz_uploader_t             *uploader = worker->uploader;
+    glitz_gl_proc_address_list_t *gl = worker->drawable->backend->gl;
+    glitz_upload_t               *upload;
+
+    worker->drawable->backend->make_current (worker->drawable,
+					     worker->context);
+
+    for (;;)
+    {
+	pthread_mutex_lock (&uploader->mutex);
+
+	while (!uploader->head && !uploader->quit)
+	    pthread_cond_wait (&uploader->work_cond, &uploader->mutex);
+
+	upload = uploader->head;
+	if (upload)
+	{
+	    uploader->head = upload->next;
+	    if (!uploader->head)
+		uploader->tail = NULL;
+	}
+
+	pthread_mutex_unlock (&uploader->mutex);
+
+	if (!upload)
+	    break;
+
+	_glitz_upload_run (gl, upload);
+
+	pthread_mutex_lock (&uploader->mutex);
+	upload->done = 1;
+	pthread_cond_broadcast (&uploader->done_cond);
+	pthread_mutex_unlock (&uploader->mutex);
+    }
+
+    /* destroying the context here also releases it */
+    glitz_context_destroy (worker->context);
+
+    return NULL;
+}
+#endif
+
+/* starts n_workers threads with contexts that share textures with the
+   context of drawable. glitz_set_pixels then hands uploads of client
+   memory into unattached surfaces of drawable to the workers and
+   returns after copying the pixels. using the surface as a source, or
+   anything else that needs its texture, waits for the upload with a
+   fence. */
+glitz_status_t
+glitz_drawable_start_uploads (glitz_drawable_t *drawable,
+			      int              n_workers)
+{
+
+#ifdef HAVE_PTHREAD
+    glitz_uploader_t        *uploader;
+    glitz_upload_worker_t   *worker;
+    glitz_drawable_format_t *format = &drawable->format->d;
+    int                     i;
+
+    if (drawable->uploader)
+	return GLITZ_STATUS_SUCCESS;
+
+    /* only backends that can hand contexts between threads qualify */
+    if (!(drawable->backend->feature_mask & GLITZ_FEATURE_SYNC_MASK) ||
+	!drawable->backend->release_current ||
+	DRAWABLE_IS_FBO (drawable))
+	return GLITZ_STATUS_NOT_SUPPORTED;
+
+    n_workers = MAX (1, MIN (n_workers, GLITZ_MAX_THREADS));
+
+    uploader = malloc (sizeof (glitz_uploader_t) +
+		       sizeof (glitz_upload_worker_t) * n_workers);
+    if (!uploader)
+	return GLITZ_STATUS_NO_MEMORY;
+
+    uploader->head      = uploader->tail = NULL;
+    uploader->quit      = 0;
+    uploader->n_workers = 0;
+    uploader->workers   = (glitz_upload_worker_t *) (uploader + 1);
+
+    pthread_mutex_init (&uploader->mutex, NULL);
+    pthread_cond_init (&uploader->work_cond, NULL);
+    pthread_cond_init (&uploader->done_cond, NULL);
+
+    drawable->uploader = uploader;
+
+    for (i = 0; i < n_workers; i++)
+    {
+	worker = &uploader->workers[uploader->n_workers];
+
+	worker->uploader = uploader;
+	worker->context  = glitz_context_create (drawable, format);
+	if (!worker->context)
+	    break;
+
+	/* a drawable of its own keeps the worker from competing with the
+	   rendering thread for the window, where the backend allows it */
+	worker->drawable = NULL;
+	if (drawable->format->types & GLITZ_DRAWABLE_TYPE_PBUFFER_MASK)
+	    worker->drawable = glitz_create_pbuffer_drawable (drawable,
+							      format, 1, 1);
+	if (!worker->drawable)
+	{
+	    worker->drawable = drawable;
+	    glitz_drawable_reference (drawable);
+	}
+
+	if (pthread_create (&worker->thread, NULL, _glitz_upload_main,
+			    worker))
+	{
+	    glitz_context_destroy (worker->context);
+	    glitz_drawable_destroy (worker->drawable);
+	    break;
+	}
+
+	uploader->n_workers++;
+    }
+
+    if (!uploader->n_workers)
+    {
+	glitz_drawable_stop_uploads (drawable);
+	return GLITZ_STATUS_NOT_SUPPORTED;
+    }
+
+    return GLITZ_STATUS_SUCCESS;
+#else
+    return GLITZ_STATUS_NOT_SUPPORTED;
+#endif
+
+}
+
+/* finishes queued uploads and joins the workers */
+void
+glitz_drawable_stop_uploads (glitz_drawable_t *drawable)
+{
+
+#ifdef HAVE_PTHREAD
+    glitz_uploader_t *uploader = drawable->uploader;
+    int              i;
+
+    if (!uploader)
+	return;
+
+    pthread_mutex_lock (&uploader->mutex);
+    uploader->quit = 1;
+    pthread_cond_broadcast (&uploader->work_cond);
+    pthread_mutex_unlock (&uploader->mutex);
+
+    for (i = 0; i < uploader->n_workers; i++)
+    {
+	pthread_join (uploader->workers[i].thread, NULL);
+	glitz_drawable_destroy (uploader->workers[i].drawable);
+    }
+
+    pthread_cond_destroy (&uploader->done_cond);
+    pthread_cond_destroy (&uploader->work_cond);
+    pthread_mutex_destroy (&uploader->mutex);
+
+    drawable->uploader = NULL;
+    free (uploader);
+#endif
+
+}
+
+/* queues a direct upload of client memory pixels into the texture of
+   dst. gl_format and gl_type must describe format without conversion.
+   returns false if the upload has to take the synchronous path. */
+glitz_bool_t
+glitz_upload_set_pixels (glitz_surface_t      *dst,
+			 int                  x_dst,
+			 int                  y_dst,
+			 int                  width,
+			 int                  height,
+			 glitz_pixel_format_t *format,
+			 glitz_gl_enum_t      gl_format,
+			 glitz_gl_enum_t      gl_type,
+			 glitz_buffer_t       *buffer)
+{
+
+#ifdef HAVE_PTHREAD
+    glitz_uploader_t *uploader = dst->drawable->uploader;
+    glitz_upload_t   *upload;
+    glitz_texture_t  *texture;
+    glitz_box_t      *clip = dst->clip;
+    glitz_box_t      box;
+    int              n_clip = dst->n_clip;
+    int              bytes_per_line = format->bytes_per_line;
+    int              bytes_per_pixel = format->masks.bpp / 8;
+    unsigned int     size;
+    char             *data;
+
+    GLITZ_GL_SURFACE (dst);
+
+    if (!uploader || dst->attached || SURFACE_ATLAS (dst) ||
+	buffer->drawable || bytes_per_line <= 0 || bytes_per_pixel == 0)
+	return 0;
+
+    size = bytes_per_line * (format->skip_lines + height);
+
+    upload = malloc (sizeof (glitz_upload_t) +
+		     sizeof (glitz_upload_rect_t) * n_clip);
+    if (!upload)
+	return 0;
+
+    upload->data = malloc (size);
+    if (!upload->data)
+    {
+	free (upload);
+	return 0;
+    }
+
+    upload->rects   = (glitz_upload_rect_t *) (upload + 1);
+    upload->n_rects = 0;
+
+    glitz_surface_push_current (dst, GLITZ_ANY_CONTEXT_CURRENT);
+
+    /* waits for an earlier upload into the same texture */
+    texture = glitz_surface_get_texture (dst, 1);
+    if (!texture)
+    {
+	glitz_surface_pop_current (dst);
+	free (upload->data);
+	free (upload);
+	return 1;
+    }
+
+    /* the worker waits for this fence before it writes to the texture.
+       the flush also makes a new texture object visible to it. */
+    upload->ready = gl->fence_sync (GLITZ_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl->flush ();
+
+    glitz_surface_pop_current (dst);
+
+    if (!upload->ready)
+    {
+	free (upload->data);
+	free (upload);
+	return 0;
+    }
+
+    data = glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_READ_ONLY);
+    memcpy (upload->data, data, size);
+    glitz_buffer_unmap (buffer);
+
+    while (n_clip--)
+    {
+	box.x1 = clip->x1 + dst->x_clip;
+	box.y1 = clip->y1 + dst->y_clip;
+	box.x2 = clip->x2 + dst->x_clip;
+	box.y2 = clip->y2 + dst->y_clip;
+	if (x_dst > box.x1)
+	    box.x1 = x_dst;
+	if (y_dst > box.y1)
+	    box.y1 = y_dst;
+	if (x_dst + width < box.x2)
+	    box.x2 = x_dst + width;
+	if (y_dst + height < box.y2)
+	    box.y2 = y_dst + height;
+
+	if (box.x1 < box.x2 && box.y1 < box.y2)
+	{
+	    upload->rects[upload->n_rects].box = box;
+	    upload->rects[upload->n_rects].offset =
+		(format->skip_lines + y_dst + height - box.y2) *
+		bytes_per_line +
+		(format->xoffset + box.x1 - x_dst) * bytes_per_pixel;
+	    upload->n_rects++;
+
+	    glitz_surface_damage (dst, &box,
+				  GLITZ_DAMAGE_DRAWABLE_MASK |
+				  GLITZ_DAMAGE_SOLID_MASK);
+	}
+	clip++;
+    }
+
+    upload->next       = NULL;
+    upload->name       = texture->name;
+    upload->target     = texture->target;
+    upload->x          = texture->box.x1;
+    upload->y2         = texture->box.y2;
+    upload->format     = gl_format;
+    upload->type       = gl_type;
+    upload->row_length = bytes_per_line / bytes_per_pixel;
+    upload->fence      = NULL;
+    upload->done       = 0;
+
+    if ((bytes_per_line % 4) == 0)
+	upload->alignment = 4;
+    else if ((bytes_per_line % 2) == 0)
+	upload->alignment = 2;
+    else
+	upload->alignment = 1;
+
+    pthread_mutex_lock (&uploader->mutex);
+
+    if (uploader->tail)
+	uploader->tail->next = upload;
+    else
+	uploader->head = upload;
+    uploader->tail = upload;
+
+    pthread_cond_signal (&uploader->work_cond);
+    pthread_mutex_unlock (&uploader->mutex);
+
+    dst->upload = upload;
+
+    return 1;
+#else
+    return 0;
+#endif
+
+}
+
+/* makes the context current on the calling thread wait for the pending
+   upload into the texture of surface. called with that context current. */
+void
+glitz_upload_wait (glitz_surface_t *surface)
+{
+
+#ifdef HAVE_PTHREAD
+    glitz_uploader_t *uploader = surface->drawable->uploader;
+    glitz_upload_t   *upload = surface->upload;
+
+    GLITZ_GL_SURFACE (surface);
+
+    /* without an uploader all workers have been joined */
+    if (uploader)
+    {
+	pthread_mutex_lock (&uploader->mutex);
+	while (!upload->done)
+	    pthread_cond_wait (&uploader->done_cond, &uploader->mutex);
+	pthread_mutex_unlock (&uploader->mutex);
+    }
+
+    if (upload->fence)
+    {
+	gl->wait_sync (upload->fence, 0, GLITZ_GL_TIMEOUT_IGNORED);
+	gl->delete_sync (upload->fence);
+    }
+
+    surface->upload = NULL;
+    free (upload);
+#endif
+
+}
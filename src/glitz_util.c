@@ -65,6 +65,14 @@ static glitz_extension_map gl_extensions[] = {
     { 0.0, "GL_APPLE_packed_pixels", GLITZ_FEATURE_PACKED_PIXELS_MASK },
     { 0.0, "GL_EXT_framebuffer_object",
       GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK },
+    { 4.2, "GL_ARB_texture_storage", GLITZ_FEATURE_TEXTURE_STORAGE_MASK },
+    { 4.4, "GL_ARB_clear_texture", GLITZ_FEATURE_CLEAR_TEXTURE_MASK },
+    { 3.0, "GL_EXT_framebuffer_multisample",
+      GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK },
+    { 3.1, "GL_NV_primitive_restart", GLITZ_FEATURE_PRIMITIVE_RESTART_MASK },
+    { 3.0, "GL_ARB_map_buffer_range", GLITZ_FEATURE_MAP_BUFFER_RANGE_MASK },
+    { 3.2, "GL_ARB_sync", GLITZ_FEATURE_SYNC_MASK },
+    { 4.4, "GL_ARB_buffer_storage", GLITZ_FEATURE_BUFFER_STORAGE_MASK },
     { 0.0, NULL, 0 }
 };
 
@@ -204,8 +212,11 @@ _glitz_gl_proc_address_lookup (glitz_backend_t               *backend,
     if (backend->feature_mask & GLITZ_FEATURE_MULTI_DRAW_ARRAYS_MASK) {
 	backend->gl->multi_draw_arrays = (glitz_gl_multi_draw_arrays_t)
 	    get_proc_address ("glMultiDrawArraysEXT", closure);
+	backend->gl->multi_draw_elements = (glitz_gl_multi_draw_elements_t)
+	    get_proc_address ("glMultiDrawElementsEXT", closure);
 
-	if (!backend->gl->multi_draw_arrays)
+	if ((!backend->gl->multi_draw_arrays) ||
+	    (!backend->gl->multi_draw_elements))
 	    backend->feature_mask &= ~GLITZ_FEATURE_MULTI_DRAW_ARRAYS_MASK;
     }
 
@@ -283,6 +294,50 @@ _glitz_gl_proc_address_lookup (glitz_backend_t               *backend,
 	}
     }
 
+    if (((backend->feature_mask & GLITZ_FEATURE_VERTEX_BUFFER_OBJECT_MASK) ||
+	 (backend->feature_mask & GLITZ_FEATURE_PIXEL_BUFFER_OBJECT_MASK)) &&
+	(backend->feature_mask & GLITZ_FEATURE_MAP_BUFFER_RANGE_MASK)) {
+	backend->gl->map_buffer_range = (glitz_gl_map_buffer_range_t)
+	    get_proc_address ("glMapBufferRange", closure);
+	backend->gl->flush_mapped_buffer_range =
+	    (glitz_gl_flush_mapped_buffer_range_t)
+	    get_proc_address ("glFlushMappedBufferRange", closure);
+
+	if ((!backend->gl->map_buffer_range) ||
+	    (!backend->gl->flush_mapped_buffer_range))
+	    backend->feature_mask &= ~GLITZ_FEATURE_MAP_BUFFER_RANGE_MASK;
+    } else
+	backend->feature_mask &= ~GLITZ_FEATURE_MAP_BUFFER_RANGE_MASK;
+
+    if (backend->feature_mask & GLITZ_FEATURE_SYNC_MASK) {
+	backend->gl->fence_sync = (glitz_gl_fence_sync_t)
+	    get_proc_address ("glFenceSync", closure);
+	backend->gl->delete_sync = (glitz_gl_delete_sync_t)
+	    get_proc_address ("glDeleteSync", closure);
+	backend->gl->client_wait_sync = (glitz_gl_client_wait_sync_t)
+	    get_proc_address ("glClientWaitSync", closure);
+	backend->gl->wait_sync = (glitz_gl_wait_sync_t)
+	    get_proc_address ("glWaitSync", closure);
+
+	if ((!backend->gl->fence_sync) ||
+	    (!backend->gl->delete_sync) ||
+	    (!backend->gl->client_wait_sync) ||
+	    (!backend->gl->wait_sync))
+	    backend->feature_mask &= ~GLITZ_FEATURE_SYNC_MASK;
+    }
+
+    /* persistent mappings are only useful with range mapping and fences */
+    if ((backend->feature_mask & GLITZ_FEATURE_BUFFER_STORAGE_MASK) &&
+	(backend->feature_mask & GLITZ_FEATURE_MAP_BUFFER_RANGE_MASK) &&
+	(backend->feature_mask & GLITZ_FEATURE_SYNC_MASK)) {
+	backend->gl->buffer_storage = (glitz_gl_buffer_storage_t)
+	    get_proc_address ("glBufferStorage", closure);
+
+	if (!backend->gl->buffer_storage)
+	    backend->feature_mask &= ~GLITZ_FEATURE_BUFFER_STORAGE_MASK;
+    } else
+	backend->feature_mask &= ~GLITZ_FEATURE_BUFFER_STORAGE_MASK;
+
     if (backend->feature_mask & GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK) {
 	backend->gl->gen_framebuffers = (glitz_gl_gen_framebuffers_t)
 	    get_proc_address ("glGenFramebuffersEXT", closure);
@@ -324,6 +379,54 @@ _glitz_gl_proc_address_lookup (glitz_backend_t               *backend,
 	    (!backend->gl->get_renderbuffer_parameter_iv))
 	    backend->feature_mask &= ~GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK;
     }
+
+    if (backend->feature_mask & GLITZ_FEATURE_TEXTURE_STORAGE_MASK) {
+	backend->gl->tex_storage_2d = (glitz_gl_tex_storage_2d_t)
+	    get_proc_address ("glTexStorage2D", closure);
+
+	if (!backend->gl->tex_storage_2d)
+	    backend->feature_mask &= ~GLITZ_FEATURE_TEXTURE_STORAGE_MASK;
+    }
+
+    if (backend->feature_mask & GLITZ_FEATURE_CLEAR_TEXTURE_MASK) {
+	backend->gl->clear_tex_sub_image = (glitz_gl_clear_tex_sub_image_t)
+	    get_proc_address ("glClearTexSubImage", closure);
+
+	if (!backend->gl->clear_tex_sub_image)
+	    backend->feature_mask &= ~GLITZ_FEATURE_CLEAR_TEXTURE_MASK;
+    }
+
+    /* resolving needs GL_EXT_framebuffer_blit, which every implementation
+       of GL_EXT_framebuffer_multisample has */
+    if ((backend->feature_mask & GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK) &&
+	(backend->feature_mask & GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK)) {
+	backend->gl->renderbuffer_storage_multisample =
+	    (glitz_gl_renderbuffer_storage_multisample_t)
+	    get_proc_address ("glRenderbufferStorageMultisampleEXT", closure);
+	backend->gl->blit_framebuffer = (glitz_gl_blit_framebuffer_t)
+	    get_proc_address ("glBlitFramebufferEXT", closure);
+
+	if ((!backend->gl->renderbuffer_storage_multisample) ||
+	    (!backend->gl->blit_framebuffer))
+	    backend->feature_mask &=
+		~GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK;
+    } else
+	backend->feature_mask &= ~GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK;
+
+    if (backend->feature_mask & GLITZ_FEATURE_PRIMITIVE_RESTART_MASK) {
+	if (backend->gl_version >= 3.1f) {
+	    backend->gl->primitive_restart_index =
+		(glitz_gl_primitive_restart_index_t)
+		get_proc_address ("glPrimitiveRestartIndex", closure);
+	} else {
+	    backend->gl->primitive_restart_index =
+		(glitz_gl_primitive_restart_index_t)
+		get_proc_address ("glPrimitiveRestartIndexNV", closure);
+	}
+
+	if (!backend->gl->primitive_restart_index)
+	    backend->feature_mask &= ~GLITZ_FEATURE_PRIMITIVE_RESTART_MASK;
+    }
 }
 
 void
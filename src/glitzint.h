@@ -67,6 +67,7 @@
 # define atanf(a)     atan (a)
 # define atan2f(a, b) atan2 (a, b)
 # define sqrtf(a)     sqrt (a)
+# define fabsf(a)     fabs (a)
 #endif
 
 #if __GNUC__ >= 3 && defined(__ELF__) && 0
@@ -122,6 +123,7 @@ typedef struct _glitz_gl_proc_address_list_t {
   glitz_gl_vertex_pointer_t             vertex_pointer;
   glitz_gl_tex_coord_pointer_t          tex_coord_pointer;
   glitz_gl_draw_arrays_t                draw_arrays;
+  glitz_gl_draw_elements_t              draw_elements;
   glitz_gl_tex_env_f_t                  tex_env_f;
   glitz_gl_tex_env_fv_t                 tex_env_fv;
   glitz_gl_tex_gen_i_t                  tex_gen_i;
@@ -135,6 +137,8 @@ typedef struct _glitz_gl_proc_address_list_t {
   glitz_gl_clear_stencil_t              clear_stencil;
   glitz_gl_stencil_func_t               stencil_func;
   glitz_gl_stencil_op_t                 stencil_op;
+  glitz_gl_cull_face_t                  cull_face;
+  glitz_gl_alpha_func_t                 alpha_func;
   glitz_gl_push_attrib_t                push_attrib;
   glitz_gl_pop_attrib_t                 pop_attrib;
   glitz_gl_matrix_mode_t                matrix_mode;
@@ -203,6 +207,20 @@ typedef struct _glitz_gl_proc_address_list_t {
   glitz_gl_bind_renderbuffer_t          bind_renderbuffer;
   glitz_gl_renderbuffer_storage_t       renderbuffer_storage;
   glitz_gl_get_renderbuffer_parameter_iv_t get_renderbuffer_parameter_iv;
+  glitz_gl_tex_storage_2d_t             tex_storage_2d;
+  glitz_gl_clear_tex_sub_image_t        clear_tex_sub_image;
+  glitz_gl_renderbuffer_storage_multisample_t
+					renderbuffer_storage_multisample;
+  glitz_gl_blit_framebuffer_t           blit_framebuffer;
+  glitz_gl_multi_draw_elements_t        multi_draw_elements;
+  glitz_gl_primitive_restart_index_t    primitive_restart_index;
+  glitz_gl_map_buffer_range_t           map_buffer_range;
+  glitz_gl_flush_mapped_buffer_range_t  flush_mapped_buffer_range;
+  glitz_gl_buffer_storage_t             buffer_storage;
+  glitz_gl_fence_sync_t                 fence_sync;
+  glitz_gl_delete_sync_t                delete_sync;
+  glitz_gl_client_wait_sync_t           client_wait_sync;
+  glitz_gl_wait_sync_t                  wait_sync;
 } glitz_gl_proc_address_list_t;
 
 typedef int glitz_surface_type_t;
@@ -254,8 +272,9 @@ typedef int glitz_combine_type_t;
 #define GLITZ_FP_RADIAL_GRADIENT_REPEAT      7
 #define GLITZ_FP_RADIAL_GRADIENT_REFLECT     8
 #define GLITZ_FP_COLORSPACE_YV12             9
-#define GLITZ_FP_UNSUPPORTED                 10
-#define GLITZ_FP_TYPES                       11
+#define GLITZ_FP_EDGE_COVERAGE               10
+#define GLITZ_FP_UNSUPPORTED                 11
+#define GLITZ_FP_TYPES                       12
 
 typedef struct _glitz_program_t {
   glitz_gl_int_t *name;
@@ -270,6 +289,37 @@ typedef struct _glitz_program_map_t {
   glitz_filter_map_t filters[GLITZ_COMBINE_TYPES][GLITZ_FP_TYPES];
 } glitz_program_map_t;
 
+typedef struct _glitz_atlas glitz_atlas_t;
+
+typedef struct _glitz_bitmap_texture glitz_bitmap_texture_t;
+
+typedef struct _glitz_stream glitz_stream_t;
+
+typedef struct _glitz_arena glitz_arena_t;
+typedef struct _glitz_arena_block glitz_arena_block_t;
+
+typedef struct _glitz_queue glitz_queue_t;
+
+typedef struct _glitz_upload glitz_upload_t;
+typedef struct _glitz_uploader glitz_uploader_t;
+
+typedef struct _glitz_texture_memory_t {
+  unsigned long   budget;
+  unsigned long   size;
+  glitz_surface_t *head;
+  glitz_surface_t *tail;
+  glitz_atlas_t   *atlas;
+  unsigned int    serial;
+  int             transfer;
+} glitz_texture_memory_t;
+
+#define GLITZ_DAMAGE_CALL_COST_DEFAULT 4096
+
+typedef struct _glitz_damage_policy_t {
+  unsigned long call_cost;
+  unsigned long over_copy;
+} glitz_damage_policy_t;
+
 typedef enum {
   GLITZ_NONE,
   GLITZ_ANY_CONTEXT_CURRENT,
@@ -277,12 +327,15 @@ typedef enum {
   GLITZ_DRAWABLE_CURRENT
 } glitz_constraint_t;
 
+#define GLITZ_REGION_INLINE_SIZE 4
+
 typedef struct _glitz_region_t {
   glitz_box_t extents;
   glitz_box_t *box;
   int         n_box;
   void        *data;
   int         size;
+  glitz_box_t inline_box[GLITZ_REGION_INLINE_SIZE];
 } glitz_region_t;
 
 #define GLITZ_NULL_BOX ((glitz_box_t *) 0)
@@ -337,10 +390,28 @@ typedef struct _glitz_region_t {
 #define GLITZ_REGION_UNION(region, box) \
   glitz_region_union (region, box)
 
+#define GLITZ_REGION_INTERSECT(region, box) \
+  glitz_region_intersect (region, box)
+
+#define GLITZ_REGION_SUBTRACT(region, box) \
+  glitz_region_subtract (region, box)
+
 extern glitz_status_t __internal_linkage
 glitz_region_union (glitz_region_t *region,
 		    glitz_box_t    *box);
 
+extern glitz_status_t __internal_linkage
+glitz_region_intersect (glitz_region_t *region,
+			glitz_box_t    *box);
+
+extern glitz_status_t __internal_linkage
+glitz_region_subtract (glitz_region_t *region,
+		       glitz_box_t    *box);
+
+extern unsigned long __internal_linkage
+glitz_region_coalesce (glitz_region_t *region,
+		       unsigned long  call_cost);
+
 #define GLITZ_DRAWABLE_TYPE_WINDOW_MASK  (1L << 0)
 #define GLITZ_DRAWABLE_TYPE_PBUFFER_MASK (1L << 1)
 #define GLITZ_DRAWABLE_TYPE_FBO_MASK     (1L << 2)
@@ -380,6 +451,9 @@ typedef struct glitz_backend {
   glitz_surface_t *
   (*pop_current)               (void *drawable);
 
+  void
+  (*release_current)           (void *drawable);
+
   void
   (*attach_notify)             (void            *drawable,
 				glitz_surface_t *surface);
@@ -442,6 +516,8 @@ typedef struct glitz_backend {
   unsigned long                feature_mask;
 
   glitz_program_map_t          *program_map;
+  glitz_texture_memory_t       *texture_memory;
+  glitz_damage_policy_t        *damage_policy;
 } glitz_backend_t;
 
 struct _glitz_drawable {
@@ -455,6 +531,13 @@ struct _glitz_drawable {
   glitz_bool_t                finished;
   glitz_surface_t             *front;
   glitz_surface_t             *back;
+  unsigned int                stencil_clip_serial;
+  int                         stencil_clip_x, stencil_clip_y;
+  int                         stencil_clip_height;
+  glitz_stream_t              *stream;
+  glitz_arena_t               *arena;
+  glitz_queue_t               *queue;
+  glitz_uploader_t            *uploader;
 };
 
 #define GLITZ_GL_DRAWABLE(drawable) \
@@ -463,6 +546,17 @@ struct _glitz_drawable {
 #define DRAWABLE_IS_FBO(drawable) \
   ((drawable)->format->types == GLITZ_DRAWABLE_TYPE_FBO_MASK)
 
+#define DRAWABLE_IS_MULTISAMPLE_FBO(drawable) \
+  (DRAWABLE_IS_FBO (drawable) && (drawable)->format->d.samples > 1)
+
+/* rendering goes straight into the texture of the attached surface */
+#define DRAWABLE_RENDERS_TO_TEXTURE(drawable) \
+  (DRAWABLE_IS_FBO (drawable) && (drawable)->format->d.samples <= 1)
+
+/* calls on the drawable are handed to its submission thread */
+#define DRAWABLE_QUEUED(drawable) \
+  ((drawable)->queue && !glitz_queue_is_current ((drawable)->queue))
+
 typedef struct _glitz_vec2_t {
   glitz_float_t v[2];
 } glitz_vec2_t;
@@ -476,6 +570,8 @@ typedef struct _glitz_vec4_t {
 #define GLITZ_TEXTURE_FLAG_REPEATABLE_MASK   (1L <<  2)
 #define GLITZ_TEXTURE_FLAG_PADABLE_MASK      (1L <<  3)
 #define GLITZ_TEXTURE_FLAG_INVALID_SIZE_MASK (1L <<  4)
+#define GLITZ_TEXTURE_FLAG_SHARED_MASK       (1L <<  5)
+#define GLITZ_TEXTURE_FLAG_PADDING_MASK      (1L <<  6)
 
 #define TEXTURE_ALLOCATED(texture) \
   ((texture)->flags & GLITZ_TEXTURE_FLAG_ALLOCATED_MASK)
@@ -483,6 +579,9 @@ typedef struct _glitz_vec4_t {
 #define TEXTURE_CLAMPABLE(texture) \
   ((texture)->flags & GLITZ_TEXTURE_FLAG_CLAMPABLE_MASK)
 
+#define TEXTURE_PADDING(texture) \
+  ((texture)->flags & GLITZ_TEXTURE_FLAG_PADDING_MASK)
+
 #define TEXTURE_REPEATABLE(texture) \
   ((texture)->flags & GLITZ_TEXTURE_FLAG_REPEATABLE_MASK)
 
@@ -492,6 +591,9 @@ typedef struct _glitz_vec4_t {
 #define TEXTURE_INVALID_SIZE(texture) \
   ((texture)->flags & GLITZ_TEXTURE_FLAG_INVALID_SIZE_MASK)
 
+#define TEXTURE_SHARED(texture) \
+  ((texture)->flags & GLITZ_TEXTURE_FLAG_SHARED_MASK)
+
 typedef struct _glitz_texture_parameters {
     glitz_gl_enum_t filter[2];
     glitz_gl_enum_t wrap[2];
@@ -531,6 +633,16 @@ struct _glitz_buffer {
   glitz_surface_t  *front_surface;
   glitz_surface_t  *back_surface;
   glitz_drawable_t *drawable;
+  unsigned int     serial;
+  glitz_bool_t     flush_explicit;
+  glitz_bitmap_texture_t *bitmaps;
+  glitz_bool_t     streamed;
+  glitz_arena_block_t *block;
+  unsigned int     offset;
+  unsigned int     size;
+  void             *mapping;
+  unsigned long    mapping_size;
+  unsigned int     chunk_size;
 };
 
 struct _glitz_multi_array {
@@ -557,11 +669,36 @@ typedef struct _glitz_vertex_info {
 } glitz_vertex_info_t;
 
 typedef struct _glitz_bitmap_info {
-  glitz_bool_t     top_down;
-  glitz_gl_int_t   pad;
-  glitz_gl_ubyte_t *base;
+  glitz_bool_t      top_down;
+  glitz_gl_int_t    pad;
+  int               repeat;
+  glitz_gl_ushort_t alpha;
+  glitz_gl_ubyte_t  *base;
 } glitz_bitmap_info_t;
 
+typedef struct _glitz_index_info {
+  glitz_buffer_t   *buffer;
+  glitz_gl_enum_t  type;
+  int              size;
+  glitz_bool_t     restart;
+  glitz_gl_uint_t  restart_index;
+  glitz_gl_ubyte_t *base;
+  int              *restarts;
+  int              n_restarts;
+  unsigned int     restarts_serial;
+  glitz_bool_t     restarts_valid;
+} glitz_index_info_t;
+
+/* polygons filled by stencil-then-cover. uncovered pixels keep the
+   stencil value ref under mask. */
+typedef struct _glitz_path_info {
+  glitz_fill_rule_t fill_rule;
+  glitz_polygon_t   *polygons;
+  int               n_polygons;
+  glitz_gl_uint_t   ref;
+  glitz_gl_uint_t   mask;
+} glitz_path_info_t;
+
 typedef struct _glitz_geometry {
   glitz_geometry_type_t type;
   glitz_buffer_t        *buffer;
@@ -573,6 +710,8 @@ typedef struct _glitz_geometry {
   glitz_vec2_t          off;
   glitz_multi_array_t   *array;
   unsigned long         attributes;
+  glitz_path_info_t     *path;
+  glitz_index_info_t    index;
   union {
     glitz_vertex_info_t v;
     glitz_bitmap_info_t b;
@@ -596,6 +735,9 @@ typedef struct _glitz_geometry {
 #define GLITZ_SURFACE_FLAG_PROJECTIVE_TRANSFORM_MASK    (1L << 14)
 #define GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK            (1L << 15)
 #define GLITZ_SURFACE_FLAG_GEN_T_COORDS_MASK            (1L << 16)
+#define GLITZ_SURFACE_FLAG_EVICTED_MASK                 (1L << 17)
+#define GLITZ_SURFACE_FLAG_TILED_MASK                   (1L << 18)
+#define GLITZ_SURFACE_FLAG_ATLAS_MASK                   (1L << 19)
 
 #define GLITZ_SURFACE_FLAGS_GEN_COORDS_MASK  \
     (GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK | \
@@ -639,6 +781,25 @@ typedef struct _glitz_geometry {
 #define SURFACE_PROJECTIVE_TRANSFORM(surface) \
   ((surface)->flags & GLITZ_SURFACE_FLAG_PROJECTIVE_TRANSFORM_MASK)
 
+#define SURFACE_EVICTED(surface) \
+  ((surface)->flags & GLITZ_SURFACE_FLAG_EVICTED_MASK)
+
+#define SURFACE_TILED(surface) \
+  ((surface)->flags & GLITZ_SURFACE_FLAG_TILED_MASK)
+
+#define SURFACE_ATLAS(surface) \
+  ((surface)->flags & GLITZ_SURFACE_FLAG_ATLAS_MASK)
+
+#define SURFACE_QUEUED(surface) \
+  DRAWABLE_QUEUED ((surface)->drawable)
+
+typedef struct _glitz_tile_grid_t {
+  int             size;
+  int             n_x, n_y;
+  glitz_surface_t **tiles;
+  unsigned int    *clip_serials;
+} glitz_tile_grid_t;
+
 typedef struct _glitz_filter_params_t glitz_filter_params_t;
 
 typedef struct _glitz_matrix {
@@ -665,6 +826,7 @@ struct _glitz_surface {
   short                 x_clip, y_clip;
   glitz_box_t           *clip;
   int                   n_clip;
+  unsigned int          clip_serial;
   glitz_gl_enum_t       buffer;
   unsigned long         flags;
   glitz_color_t         solid;
@@ -682,6 +844,17 @@ struct _glitz_surface {
   glitz_region_t        drawable_damage;
   unsigned int          flip_count;
   glitz_gl_int_t        fb;
+  unsigned long         texture_size;
+  glitz_surface_t       *lru_prev;
+  glitz_surface_t       *lru_next;
+  unsigned int          memory_serial;
+  void                  *backing_store;
+  glitz_tile_grid_t     *grid;
+  glitz_atlas_t         *atlas;
+  int                   atlas_cell;
+  glitz_upload_t        *upload;
+  int                   batch;
+  glitz_box_t           batch_damage;
 };
 
 #define GLITZ_GL_SURFACE(surface) \
@@ -805,7 +978,14 @@ glitz_texture_size_check (glitz_gl_proc_address_list_t *gl,
 
 void
 glitz_texture_allocate (glitz_gl_proc_address_list_t *gl,
-			glitz_texture_t              *texture);
+			glitz_texture_t              *texture,
+			unsigned long                feature_mask);
+
+extern void __internal_linkage
+glitz_texture_clear_padding (glitz_gl_proc_address_list_t *gl,
+			     glitz_texture_t              *texture,
+			     unsigned long                feature_mask,
+			     glitz_gl_uint_t              fb);
 
 extern void __internal_linkage
 glitz_texture_ensure_parameters (glitz_gl_proc_address_list_t *gl,
@@ -865,10 +1045,296 @@ glitz_surface_damage (glitz_surface_t *surface,
 extern void __internal_linkage
 glitz_surface_sync_drawable (glitz_surface_t *surface);
 
+extern void __internal_linkage
+glitz_surface_apply_batch_damage (glitz_surface_t *surface);
+
 extern void __internal_linkage
 glitz_surface_status_add (glitz_surface_t *surface,
 			  int             flags);
 
+void
+glitz_texture_memory_init (glitz_texture_memory_t *memory);
+
+void
+glitz_damage_policy_init (glitz_damage_policy_t *policy,
+			  unsigned long         call_cost);
+
+extern void __internal_linkage
+glitz_texture_memory_allocate (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_texture_memory_release (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_texture_memory_touch (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_texture_memory_begin (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_texture_memory_restore (glitz_surface_t *surface);
+
+extern glitz_pixel_format_t __internal_linkage *
+glitz_backing_store_format (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_surface_clip_changed (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_surface_transfer (glitz_surface_t      *surface,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer,
+			glitz_bool_t         store);
+
+extern glitz_bool_t __internal_linkage
+glitz_atlas_allocate (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_atlas_release (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_atlas_migrate (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_atlas_validate_source (glitz_surface_t *surface,
+			     glitz_surface_t *dst,
+			     unsigned long   coord_attribute,
+			     int             x,
+			     int             y,
+			     int             width,
+			     int             height);
+
+extern glitz_texture_t __internal_linkage *
+glitz_bitmap_get_texture (glitz_gl_proc_address_list_t *gl,
+			  glitz_surface_t              *dst,
+			  int                          first,
+			  int                          width,
+			  int                          height,
+			  glitz_gl_ubyte_t             **bits);
+
+extern void __internal_linkage
+glitz_bitmap_cache_fini (glitz_buffer_t *buffer);
+
+extern void __internal_linkage
+glitz_stream_destroy (glitz_drawable_t *drawable);
+
+extern glitz_bool_t __internal_linkage
+glitz_stream_alloc (glitz_drawable_t *drawable,
+		    unsigned int     size,
+		    unsigned int     *offset);
+
+extern void __internal_linkage
+glitz_stream_release (glitz_drawable_t *drawable,
+		      unsigned int     offset);
+
+extern void __internal_linkage *
+glitz_stream_map (glitz_drawable_t *drawable,
+		  unsigned int     offset,
+		  unsigned int     size);
+
+extern glitz_status_t __internal_linkage
+glitz_stream_unmap (glitz_drawable_t *drawable);
+
+extern void __internal_linkage *
+glitz_stream_map_vertices (glitz_drawable_t *drawable,
+			   unsigned int     size,
+			   unsigned int     *offset);
+
+extern void __internal_linkage *
+glitz_stream_bind_vertices (glitz_drawable_t *drawable,
+			    unsigned int     offset);
+
+extern void __internal_linkage
+glitz_stream_unbind_vertices (glitz_drawable_t *drawable,
+			      unsigned int     offset);
+
+extern glitz_gl_uint_t __internal_linkage
+glitz_stream_name (glitz_drawable_t *drawable);
+
+extern void __internal_linkage
+glitz_arena_destroy (glitz_drawable_t *drawable);
+
+extern glitz_bool_t __internal_linkage
+glitz_arena_alloc (glitz_drawable_t    *drawable,
+		   unsigned int        size,
+		   glitz_gl_enum_t     usage,
+		   glitz_arena_block_t **block,
+		   unsigned int        *offset);
+
+extern void __internal_linkage
+glitz_arena_free (glitz_drawable_t    *drawable,
+		  glitz_arena_block_t *block,
+		  unsigned int        offset,
+		  unsigned int        size);
+
+extern glitz_gl_uint_t __internal_linkage
+glitz_arena_name (glitz_arena_block_t *block);
+
+extern glitz_bool_t __internal_linkage
+glitz_queue_is_current (glitz_queue_t *queue);
+
+extern void __internal_linkage
+glitz_queue_sync (glitz_drawable_t *drawable);
+
+extern void __internal_linkage
+glitz_queue_composite (glitz_operator_t op,
+		       glitz_surface_t  *src,
+		       glitz_surface_t  *mask,
+		       glitz_surface_t  *dst,
+		       int              x_src,
+		       int              y_src,
+		       int              x_mask,
+		       int              y_mask,
+		       int              x_dst,
+		       int              y_dst,
+		       int              width,
+		       int              height);
+
+extern void __internal_linkage
+glitz_queue_copy_area (glitz_surface_t *src,
+		       glitz_surface_t *dst,
+		       int             x_src,
+		       int             y_src,
+		       int             width,
+		       int             height,
+		       int             x_dst,
+		       int             y_dst);
+
+extern void __internal_linkage
+glitz_queue_set_rectangles (glitz_surface_t         *dst,
+			    const glitz_color_t     *color,
+			    const glitz_rectangle_t *rects,
+			    int                     n_rects);
+
+extern void __internal_linkage
+glitz_queue_set_pixels (glitz_surface_t      *dst,
+			int                  x_dst,
+			int                  y_dst,
+			int                  width,
+			int                  height,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer);
+
+extern void __internal_linkage
+glitz_queue_get_pixels (glitz_surface_t      *src,
+			int                  x_src,
+			int                  y_src,
+			int                  width,
+			int                  height,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer);
+
+extern glitz_surface_t __internal_linkage *
+glitz_queue_surface_create (glitz_drawable_t           *drawable,
+			    glitz_format_t             *format,
+			    unsigned int               width,
+			    unsigned int               height,
+			    unsigned long              mask,
+			    glitz_surface_attributes_t *attributes);
+
+extern void __internal_linkage
+glitz_queue_surface_flush (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_queue_surface_destroy (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_queue_buffer_destroy (glitz_buffer_t *buffer);
+
+extern void __internal_linkage
+glitz_queue_swap_buffer_region (glitz_drawable_t *drawable,
+				int              x_origin,
+				int              y_origin,
+				glitz_box_t      *box,
+				int              n_box);
+
+extern void __internal_linkage
+glitz_queue_flush (glitz_drawable_t *drawable);
+
+extern void __internal_linkage
+glitz_queue_finish (glitz_drawable_t *drawable);
+
+extern glitz_bool_t __internal_linkage
+glitz_upload_set_pixels (glitz_surface_t      *dst,
+			 int                  x_dst,
+			 int                  y_dst,
+			 int                  width,
+			 int                  height,
+			 glitz_pixel_format_t *format,
+			 glitz_gl_enum_t      gl_format,
+			 glitz_gl_enum_t      gl_type,
+			 glitz_buffer_t       *buffer);
+
+extern void __internal_linkage
+glitz_upload_wait (glitz_surface_t *surface);
+
+#define GLITZ_MAX_THREADS 8
+
+typedef void (*glitz_thread_func_t) (void *data);
+
+extern int __internal_linkage
+glitz_thread_count (void);
+
+extern void __internal_linkage *
+glitz_thread_pool_acquire (unsigned int size);
+
+extern void __internal_linkage
+glitz_thread_pool_release (void);
+
+extern void __internal_linkage
+glitz_thread_run (glitz_thread_func_t func,
+		  void                *jobs,
+		  int                 n_jobs,
+		  int                 size);
+
+extern glitz_bool_t __internal_linkage
+glitz_tile_grid_create (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_tile_grid_destroy (glitz_surface_t *surface);
+
+extern void __internal_linkage
+glitz_tiled_composite (glitz_operator_t op,
+		       glitz_surface_t  *src,
+		       glitz_surface_t  *mask,
+		       glitz_surface_t  *dst,
+		       int              x_src,
+		       int              y_src,
+		       int              x_mask,
+		       int              y_mask,
+		       int              x_dst,
+		       int              y_dst,
+		       int              width,
+		       int              height);
+
+extern void __internal_linkage
+glitz_tiled_copy_area (glitz_surface_t *src,
+		       glitz_surface_t *dst,
+		       int             x_src,
+		       int             y_src,
+		       int             width,
+		       int             height,
+		       int             x_dst,
+		       int             y_dst);
+
+extern void __internal_linkage
+glitz_tiled_set_pixels (glitz_surface_t      *dst,
+			int                  x_dst,
+			int                  y_dst,
+			int                  width,
+			int                  height,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer);
+
+extern void __internal_linkage
+glitz_tiled_get_pixels (glitz_surface_t      *src,
+			int                  x_src,
+			int                  y_src,
+			int                  width,
+			int                  height,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer);
+
 extern unsigned long __internal_linkage
 glitz_status_to_status_mask (glitz_status_t status);
 
@@ -907,6 +1373,11 @@ glitz_buffer_bind (glitz_buffer_t  *buffer,
 extern void __internal_linkage
 glitz_buffer_unbind (glitz_buffer_t *buffer);
 
+extern void __internal_linkage
+glitz_buffer_discard_range (glitz_buffer_t *buffer,
+			    unsigned long  offset,
+			    unsigned long  size);
+
 extern glitz_status_t __internal_linkage
 glitz_filter_set_params (glitz_surface_t    *surface,
 			 glitz_filter_t     filter,
@@ -949,6 +1420,24 @@ glitz_geometry_draw_arrays (glitz_gl_proc_address_list_t *gl,
 			    glitz_box_t                  *bounds,
 			    int                          damage);
 
+extern glitz_bool_t __internal_linkage
+glitz_geometry_draw_boxes (glitz_gl_proc_address_list_t *gl,
+			   glitz_surface_t              *dst,
+			   glitz_box_t                  *boxes,
+			   int                          n_boxes,
+			   int                          damage);
+
+extern void __internal_linkage
+glitz_path_enable (glitz_gl_proc_address_list_t *gl,
+		   glitz_surface_t              *dst,
+		   glitz_box_t                  *bounds);
+
+extern void __internal_linkage
+glitz_path_draw (glitz_gl_proc_address_list_t *gl,
+		 glitz_surface_t              *dst,
+		 glitz_box_t                  *bounds,
+		 int                          damage);
+
 void
 _glitz_drawable_init (glitz_drawable_t	          *drawable,
 		      glitz_int_drawable_format_t *format,
@@ -970,6 +1459,27 @@ _glitz_fbo_drawable_create (glitz_drawable_t	        *other,
 			    int	                        width,
 			    int	                        height);
 
+extern void __internal_linkage
+glitz_framebuffer_resolve (glitz_drawable_t *drawable,
+			   glitz_texture_t  *texture,
+			   int              x_drawable,
+			   int              y_drawable,
+			   int              width,
+			   int              height,
+			   int              x_texture,
+			   int              y_texture);
+
+extern glitz_bool_t __internal_linkage
+glitz_framebuffer_copy_texture (glitz_drawable_t *drawable,
+				glitz_texture_t  *src,
+				glitz_texture_t  *dst,
+				int              x_src,
+				int              y_src,
+				int              width,
+				int              height,
+				int              x_dst,
+				int              y_dst);
+
 void
 _glitz_context_init (glitz_context_t  *context,
 		     glitz_drawable_t *drawable);
@@ -984,6 +1494,21 @@ _glitz_context_fini (glitz_context_t *context);
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 
+/* reference counts and serials shared between threads. both return the
+   new value. */
+#if defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#  define GLITZ_ATOMIC_INC(p) __sync_add_and_fetch ((p), 1)
+#  define GLITZ_ATOMIC_DEC(p) __sync_sub_and_fetch ((p), 1)
+#elif defined(_MSC_VER)
+#  include <intrin.h>
+#  define GLITZ_ATOMIC_INC(p) _InterlockedIncrement ((long volatile *) (p))
+#  define GLITZ_ATOMIC_DEC(p) _InterlockedDecrement ((long volatile *) (p))
+#else
+#  define GLITZ_ATOMIC_INC(p) (++*(p))
+#  define GLITZ_ATOMIC_DEC(p) (--*(p))
+#endif
+
 #define LSBFirst 0
 #define MSBFirst 1
 
@@ -1062,6 +1587,7 @@ typedef glitz_fixed_16_16 glitz_fixed;
 #define cosf(_X) ((float)cos((double)(_X)))
 #define atan2f(_X,_Y) ((float)atan2((double)(_X),(double)(_Y)))
 #define sqrtf(_X) ((float)sqrt((double)(_X)))
+#define fabsf(_X) ((float)fabs((double)(_X)))
 #endif
 
 /* Avoid unnecessary PLT entries. */
@@ -1095,6 +1621,7 @@ slim_hidden_proto(glitz_surface_set_clip_region)
 slim_hidden_proto(glitz_set_rectangle)
 slim_hidden_proto(glitz_set_rectangles)
 slim_hidden_proto(glitz_set_geometry)
+slim_hidden_proto(glitz_set_index_buffer)
 slim_hidden_proto(glitz_set_array)
 slim_hidden_proto(glitz_multi_array_create)
 slim_hidden_proto(glitz_multi_array_add)
@@ -89,6 +89,12 @@ glitz_glx_create_pbuffer_drawable (Display                 *display,
 				   unsigned int            height);
 
 
+/* glitz_glx_context.c */
+
+unsigned long
+glitz_glx_get_make_current_count (void);
+
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }
 #endif
@@ -144,14 +144,16 @@ _glitz_glx_context_destroy (void *abstract_context)
     glitz_glx_context_t *context = (glitz_glx_context_t *) abstract_context;
     glitz_glx_drawable_t *drawable = (glitz_glx_drawable_t *)
 	context->base.drawable;
+    glitz_glx_thread_info_t *thread_info = glitz_glx_thread_info_get ();
 
-    if (drawable->screen_info->display_info->thread_info->cctx ==
+    if (thread_info->cctx ==
 	&context->base)
     {
-	glXMakeCurrent (drawable->screen_info->display_info->display,
-			None, NULL);
+	glitz_glx_set_current (thread_info,
+			       drawable->screen_info->display_info->display,
+			       None, NULL);
 
-	drawable->screen_info->display_info->thread_info->cctx = NULL;
+	thread_info->cctx = NULL;
     }
 
     glXDestroyContext (drawable->screen_info->display_info->display,
@@ -185,6 +187,7 @@ _glitz_glx_make_current (void *abstract_drawable,
 	abstract_drawable;
     glitz_glx_display_info_t *display_info =
 	drawable->screen_info->display_info;
+    glitz_glx_thread_info_t *thread_info = glitz_glx_thread_info_get ();
 
     if (drawable->base.width  != drawable->width ||
 	drawable->base.height != drawable->height)
@@ -192,22 +195,22 @@ _glitz_glx_make_current (void *abstract_drawable,
 					 drawable->base.width,
 					 drawable->base.height);
 
-    if ((glXGetCurrentContext () != context->context) ||
-	(glXGetCurrentDrawable () != drawable->drawable))
+    if ((thread_info->current_context  != context->context) ||
+	(thread_info->current_drawable != drawable->drawable))
     {
-	if (display_info->thread_info->cctx)
+	if (thread_info->cctx)
 	{
-	    glitz_context_t *ctx = display_info->thread_info->cctx;
+	    glitz_context_t *ctx = thread_info->cctx;
 
 	    if (ctx->lose_current)
 		ctx->lose_current (ctx->closure);
 	}
 
-	glXMakeCurrent (display_info->display, drawable->drawable,
-			context->context);
+	glitz_glx_set_current (thread_info, display_info->display,
+			       drawable->drawable, context->context);
     }
 
-    display_info->thread_info->cctx = &context->base;
+    thread_info->cctx = &context->base;
 }
 
 static void
@@ -276,6 +279,7 @@ glitz_glx_context_get (glitz_glx_screen_info_t *screen_info,
     context->backend.destroy = glitz_glx_destroy;
     context->backend.push_current = glitz_glx_push_current;
     context->backend.pop_current = glitz_glx_pop_current;
+    context->backend.release_current = glitz_glx_release_current;
     context->backend.attach_notify = _glitz_glx_notify_dummy;
     context->backend.detach_notify = _glitz_glx_notify_dummy;
     context->backend.swap_buffers = glitz_glx_swap_buffers;
@@ -312,6 +316,9 @@ glitz_glx_context_get (glitz_glx_screen_info_t *screen_info,
     context->backend.n_formats = 0;
 
     context->backend.program_map = &screen_info->program_map;
+
+    context->backend.texture_memory = &screen_info->texture_memory;
+    context->backend.damage_policy = &screen_info->damage_policy;
     context->backend.feature_mask = 0;
 
     context->initialized = 0;
@@ -380,6 +387,7 @@ _glitz_glx_context_make_current (glitz_glx_drawable_t *drawable,
 {
     glitz_glx_display_info_t *display_info =
 	drawable->screen_info->display_info;
+    glitz_glx_thread_info_t *thread_info = glitz_glx_thread_info_get ();
 
     if (finish)
     {
@@ -387,19 +395,18 @@ _glitz_glx_context_make_current (glitz_glx_drawable_t *drawable,
 	drawable->base.finished = 1;
     }
 
-    if (display_info->thread_info->cctx)
+    if (thread_info->cctx)
     {
-	glitz_context_t *ctx = display_info->thread_info->cctx;
+	glitz_context_t *ctx = thread_info->cctx;
 
 	if (ctx->lose_current)
 	    ctx->lose_current (ctx->closure);
 
-	display_info->thread_info->cctx = NULL;
+	thread_info->cctx = NULL;
     }
 
-    glXMakeCurrent (display_info->display,
-		    drawable->drawable,
-		    drawable->context->context);
+    glitz_glx_set_current (thread_info, display_info->display,
+			   drawable->drawable, drawable->context->context);
 
     drawable->base.update_all = 1;
 
@@ -413,12 +420,12 @@ _glitz_glx_context_update (glitz_glx_drawable_t *drawable,
 			   glitz_constraint_t   constraint,
 			   glitz_bool_t         *restore_state)
 {
-    glitz_glx_display_info_t *dinfo = drawable->screen_info->display_info;
+    glitz_glx_thread_info_t *thread_info = glitz_glx_thread_info_get ();
     GLXContext context = NULL;
 
     if (restore_state && constraint == GLITZ_ANY_CONTEXT_CURRENT)
     {
-	if (dinfo->thread_info->cctx)
+	if (thread_info->cctx)
 	{
 	    *restore_state = 1;
 	    return;
@@ -431,15 +438,15 @@ _glitz_glx_context_update (glitz_glx_drawable_t *drawable,
     case GLITZ_NONE:
 	break;
     case GLITZ_ANY_CONTEXT_CURRENT:
-	if (!dinfo->thread_info->cctx)
-	    context = glXGetCurrentContext ();
+	if (!thread_info->cctx)
+	    context = thread_info->current_context;
 
 	if (context == (GLXContext) 0)
 	    _glitz_glx_context_make_current (drawable, 0);
 	break;
     case GLITZ_CONTEXT_CURRENT:
-	if (!dinfo->thread_info->cctx)
-	    context = glXGetCurrentContext ();
+	if (!thread_info->cctx)
+	    context = thread_info->current_context;
 
 	if (context != drawable->context->context)
 	    _glitz_glx_context_make_current (drawable, (context)? 1: 0);
@@ -451,11 +458,11 @@ _glitz_glx_context_update (glitz_glx_drawable_t *drawable,
 					     drawable->base.width,
 					     drawable->base.height);
 
-	if (!dinfo->thread_info->cctx)
-	    context = glXGetCurrentContext ();
+	if (!thread_info->cctx)
+	    context = thread_info->current_context;
 
 	if ((context != drawable->context->context) ||
-	    (glXGetCurrentDrawable () != drawable->drawable))
+	    (thread_info->current_drawable != drawable->drawable))
 	    _glitz_glx_context_make_current (drawable, (context)? 1: 0);
 	break;
     }
@@ -469,15 +476,16 @@ glitz_glx_push_current (void               *abstract_drawable,
 {
     glitz_glx_drawable_t *drawable = (glitz_glx_drawable_t *)
 	abstract_drawable;
+    glitz_glx_thread_info_t *thread_info = glitz_glx_thread_info_get ();
     glitz_glx_context_info_t *context_info;
     int index;
 
     if (restore_state)
 	*restore_state = 0;
 
-    index = drawable->screen_info->context_stack_size++;
+    index = thread_info->context_stack_size++;
 
-    context_info = &drawable->screen_info->context_stack[index];
+    context_info = &thread_info->context_stack[index];
     context_info->drawable = drawable;
     context_info->surface = surface;
     context_info->constraint = constraint;
@@ -491,15 +499,14 @@ glitz_glx_push_current (void               *abstract_drawable,
 glitz_surface_t *
 glitz_glx_pop_current (void *abstract_drawable)
 {
-    glitz_glx_drawable_t *drawable = (glitz_glx_drawable_t *)
-	abstract_drawable;
+    glitz_glx_thread_info_t *thread_info = glitz_glx_thread_info_get ();
     glitz_glx_context_info_t *context_info = NULL;
     int index;
 
-    drawable->screen_info->context_stack_size--;
-    index = drawable->screen_info->context_stack_size - 1;
+    thread_info->context_stack_size--;
+    index = thread_info->context_stack_size - 1;
 
-    context_info = &drawable->screen_info->context_stack[index];
+    context_info = &thread_info->context_stack[index];
 
     if (context_info->drawable)
 	_glitz_glx_context_update (context_info->drawable,
@@ -511,3 +518,47 @@ glitz_glx_pop_current (void *abstract_drawable)
 
     return NULL;
 }
+
+void
+glitz_glx_release_current (void *abstract_drawable)
+{
+    glitz_glx_drawable_t *drawable = (glitz_glx_drawable_t *)
+	abstract_drawable;
+    glitz_glx_thread_info_t *thread_info = glitz_glx_thread_info_get ();
+
+    if (thread_info->current_context == drawable->context->context)
+	glitz_glx_set_current (thread_info,
+			       drawable->screen_info->display_info->display,
+			       None, NULL);
+}
+
+/* glitz keeps track of what it has made current on each thread, so code
+   that calls glXMakeCurrent on its own has to restore the previous
+   context before calling into glitz again */
+void
+glitz_glx_set_current (glitz_glx_thread_info_t *thread_info,
+		       Display                 *display,
+		       GLXDrawable             drawable,
+		       GLXContext              context)
+{
+    /* what is current after a failed switch isn't known, so the next
+       switch must not be skipped */
+    if (!glXMakeCurrent (display, drawable, context))
+    {
+	thread_info->current_context  = NULL;
+	thread_info->current_drawable = None;
+	return;
+    }
+
+    thread_info->current_context  = context;
+    thread_info->current_drawable = drawable;
+    thread_info->make_current_count++;
+}
+
+/* number of times glitz changed the current context on the calling
+   thread */
+unsigned long
+glitz_glx_get_make_current_count (void)
+{
+    return glitz_glx_thread_info_get ()->make_current_count;
+}
@@ -79,9 +79,12 @@ _glitz_glx_drawable_update_size (glitz_glx_drawable_t *drawable,
 {
     if (drawable->pbuffer)
     {
-	if (glXGetCurrentDrawable () == drawable->drawable)
-	    glXMakeCurrent (drawable->screen_info->display_info->display,
-			    None, NULL);
+	glitz_glx_thread_info_t *thread_info = glitz_glx_thread_info_get ();
+
+	if (thread_info->current_drawable == drawable->drawable)
+	    glitz_glx_set_current (thread_info,
+				   drawable->screen_info->display_info->display,
+				   None, NULL);
 
 	glitz_glx_pbuffer_destroy (drawable->screen_info, drawable->pbuffer);
 	drawable->drawable = drawable->pbuffer =
@@ -209,6 +212,7 @@ glitz_glx_destroy (void *abstract_drawable)
 {
     glitz_glx_drawable_t *drawable = (glitz_glx_drawable_t *)
 	abstract_drawable;
+    glitz_glx_thread_info_t *thread_info = glitz_glx_thread_info_get ();
 
     drawable->screen_info->drawables--;
     if (drawable->screen_info->drawables == 0) {
@@ -224,9 +228,10 @@ glitz_glx_destroy (void *abstract_drawable)
 	glitz_glx_pop_current (abstract_drawable);
     }
 
-    if (glXGetCurrentDrawable () == drawable->drawable)
-	glXMakeCurrent (drawable->screen_info->display_info->display,
-			None, NULL);
+    if (thread_info->current_drawable == drawable->drawable)
+	glitz_glx_set_current (thread_info,
+			       drawable->screen_info->display_info->display,
+			       None, NULL);
 
     if (drawable->pbuffer)
 	glitz_glx_pbuffer_destroy (drawable->screen_info, drawable->pbuffer);
@@ -44,6 +44,7 @@ glitz_gl_proc_address_list_t _glitz_glx_gl_proc_address = {
     (glitz_gl_vertex_pointer_t) glVertexPointer,
     (glitz_gl_tex_coord_pointer_t) glTexCoordPointer,
     (glitz_gl_draw_arrays_t) glDrawArrays,
+    (glitz_gl_draw_elements_t) glDrawElements,
     (glitz_gl_tex_env_f_t) glTexEnvf,
     (glitz_gl_tex_env_fv_t) glTexEnvfv,
     (glitz_gl_tex_gen_i_t) glTexGeni,
@@ -57,6 +58,8 @@ glitz_gl_proc_address_list_t _glitz_glx_gl_proc_address = {
     (glitz_gl_clear_stencil_t) glClearStencil,
     (glitz_gl_stencil_func_t) glStencilFunc,
     (glitz_gl_stencil_op_t) glStencilOp,
+    (glitz_gl_cull_face_t) glCullFace,
+    (glitz_gl_alpha_func_t) glAlphaFunc,
     (glitz_gl_push_attrib_t) glPushAttrib,
     (glitz_gl_pop_attrib_t) glPopAttrib,
     (glitz_gl_matrix_mode_t) glMatrixMode,
@@ -124,7 +127,20 @@ glitz_gl_proc_address_list_t _glitz_glx_gl_proc_address = {
     (glitz_gl_delete_renderbuffers_t) 0,
     (glitz_gl_bind_renderbuffer_t) 0,
     (glitz_gl_renderbuffer_storage_t) 0,
-    (glitz_gl_get_renderbuffer_parameter_iv_t) 0
+    (glitz_gl_get_renderbuffer_parameter_iv_t) 0,
+    (glitz_gl_tex_storage_2d_t) 0,
+    (glitz_gl_clear_tex_sub_image_t) 0,
+    (glitz_gl_renderbuffer_storage_multisample_t) 0,
+    (glitz_gl_blit_framebuffer_t) 0,
+    (glitz_gl_multi_draw_elements_t) 0,
+    (glitz_gl_primitive_restart_index_t) 0,
+    (glitz_gl_map_buffer_range_t) 0,
+    (glitz_gl_flush_mapped_buffer_range_t) 0,
+    (glitz_gl_buffer_storage_t) 0,
+    (glitz_gl_fence_sync_t) 0,
+    (glitz_gl_delete_sync_t) 0,
+    (glitz_gl_client_wait_sync_t) 0,
+    (glitz_gl_wait_sync_t) 0
 };
 
 glitz_function_pointer_t
@@ -315,11 +331,23 @@ _glitz_glx_thread_info_fini (glitz_glx_thread_info_t *thread_info)
     }
 
     thread_info->cctx = NULL;
+
+    thread_info->current_context = (GLXContext) 0;
+    thread_info->current_drawable = None;
 }
 
+#if defined(XTHREADS) || defined(HAVE_PTHREAD)
+
 #ifdef XTHREADS
+#  include <X11/Xthreads.h>
+#else
+#  include <pthread.h>
+typedef pthread_key_t xthread_key_t;
+#  define xthread_key_create(kp, d)    pthread_key_create (kp, d)
+#  define xthread_set_specific(k, p)   pthread_setspecific (k, p)
+#  define xthread_get_specific(k, pp)  (*(pp) = pthread_getspecific (k))
+#endif
 
-#include <X11/Xthreads.h>
 #include <stdlib.h>
 
 /* thread safe */
@@ -334,6 +362,15 @@ _glitz_glx_thread_info_init (glitz_glx_thread_info_t *thread_info)
     thread_info->gl_library = NULL;
     thread_info->dlhand = NULL;
     thread_info->cctx = NULL;
+
+    thread_info->context_stack_size = 1;
+    thread_info->context_stack->drawable = NULL;
+    thread_info->context_stack->surface = NULL;
+    thread_info->context_stack->constraint = GLITZ_NONE;
+
+    thread_info->current_context = (GLXContext) 0;
+    thread_info->current_drawable = None;
+    thread_info->make_current_count = 0;
 }
 
 static void
@@ -402,7 +439,13 @@ static glitz_glx_thread_info_t thread_info = {
     NULL,
     0,
     NULL,
-    NULL
+    NULL,
+    NULL,
+    { { NULL, NULL, GLITZ_NONE } },
+    1,
+    (GLXContext) 0,
+    None,
+    0
 };
 
 static void
@@ -435,6 +478,12 @@ _glitz_glx_thread_info_get (const char *gl_library)
 
 #endif
 
+glitz_glx_thread_info_t *
+glitz_glx_thread_info_get (void)
+{
+    return _glitz_glx_thread_info_get (NULL);
+}
+
 static glitz_glx_display_info_t *
 _glitz_glx_display_info_get (Display *display)
 {
@@ -516,6 +565,11 @@ glitz_glx_screen_info_get (Display *display,
 
     glitz_program_map_init (&screen_info->program_map);
 
+    glitz_texture_memory_init (&screen_info->texture_memory);
+
+    glitz_damage_policy_init (&screen_info->damage_policy,
+			      GLITZ_DAMAGE_CALL_COST_DEFAULT);
+
     screen_info->root_context = (GLXContext) 0;
     screen_info->glx_feature_mask = 0;
 
@@ -533,11 +587,6 @@ glitz_glx_screen_info_get (Display *display,
 	}
     }
 
-    screen_info->context_stack_size = 1;
-    screen_info->context_stack->drawable = NULL;
-    screen_info->context_stack->surface = NULL;
-    screen_info->context_stack->constraint = GLITZ_NONE;
-
     return screen_info;
 }
 
@@ -548,7 +597,8 @@ _glitz_glx_screen_destroy (glitz_glx_screen_info_t *screen_info)
     int     i;
 
     if (screen_info->root_context)
-	glXMakeCurrent (display, None, NULL);
+	glitz_glx_set_current (screen_info->display_info->thread_info,
+			       display, None, NULL);
 
     for (i = 0; i < screen_info->n_contexts; i++)
 	glitz_glx_context_destroy (screen_info, screen_info->contexts[i]);
@@ -62,12 +62,27 @@ typedef struct _glitz_glx_static_proc_address_list_t {
     glitz_glx_copy_sub_buffer_t          copy_sub_buffer;
 } glitz_glx_static_proc_address_list_t;
 
+typedef struct _glitz_glx_context_info_t {
+    glitz_glx_drawable_t *drawable;
+    glitz_surface_t      *surface;
+    glitz_constraint_t   constraint;
+} glitz_glx_context_info_t;
+
+/* the context stack is per thread so that threads rendering to
+   different drawables never see each other's push_current calls.
+   current_context and current_drawable mirror what glitz last made
+   current on the thread so that GLX doesn't have to be asked. */
 typedef struct _glitz_glx_thread_info_t {
     glitz_glx_display_info_t **displays;
     int                      n_displays;
     char                     *gl_library;
     void                     *dlhand;
     glitz_context_t          *cctx;
+    glitz_glx_context_info_t context_stack[GLITZ_CONTEXT_STACK_SIZE];
+    int                      context_stack_size;
+    GLXContext               current_context;
+    GLXDrawable              current_drawable;
+    unsigned long            make_current_count;
 } glitz_glx_thread_info_t;
 
 struct _glitz_glx_display_info_t {
@@ -77,12 +92,6 @@ struct _glitz_glx_display_info_t {
     int n_screens;
 };
 
-typedef struct _glitz_glx_context_info_t {
-    glitz_glx_drawable_t *drawable;
-    glitz_surface_t      *surface;
-    glitz_constraint_t   constraint;
-} glitz_glx_context_info_t;
-
 typedef struct _glitz_glx_context_t {
     glitz_context_t   base;
     GLXContext        context;
@@ -100,13 +109,13 @@ struct _glitz_glx_screen_info_t {
     int                                  n_formats;
     glitz_glx_context_t                  **contexts;
     int                                  n_contexts;
-    glitz_glx_context_info_t           context_stack[GLITZ_CONTEXT_STACK_SIZE];
-    int                                  context_stack_size;
     GLXContext                           root_context;
     unsigned long                        glx_feature_mask;
     glitz_gl_float_t                     glx_version;
     glitz_glx_static_proc_address_list_t glx;
     glitz_program_map_t                  program_map;
+    glitz_texture_memory_t               texture_memory;
+    glitz_damage_policy_t                damage_policy;
 };
 
 struct _glitz_glx_drawable {
@@ -128,6 +137,15 @@ extern glitz_glx_screen_info_t __internal_linkage *
 glitz_glx_screen_info_get (Display *display,
 			   int     screen);
 
+extern glitz_glx_thread_info_t __internal_linkage *
+glitz_glx_thread_info_get (void);
+
+extern void __internal_linkage
+glitz_glx_set_current (glitz_glx_thread_info_t *thread_info,
+		       Display                 *display,
+		       GLXDrawable             drawable,
+		       GLXContext              context);
+
 extern glitz_function_pointer_t __internal_linkage
 glitz_glx_get_proc_address (const char *name,
 			    void       *closure);
@@ -173,6 +191,9 @@ glitz_glx_push_current (void               *abstract_drawable,
 extern glitz_surface_t __internal_linkage *
 glitz_glx_pop_current (void *abstract_drawable);
 
+extern void __internal_linkage
+glitz_glx_release_current (void *abstract_drawable);
+
 void
 glitz_glx_make_current (void               *abstract_drawable,
 			glitz_constraint_t constraint);
@@ -183,6 +183,7 @@ glitz_wgl_context_get (glitz_wgl_screen_info_t          *screen_info,
     context->backend.destroy = glitz_wgl_destroy;
     context->backend.push_current = glitz_wgl_push_current;
     context->backend.pop_current = glitz_wgl_pop_current;
+    context->backend.release_current = NULL;
     context->backend.attach_notify = _glitz_wgl_notify_dummy;
     context->backend.detach_notify = _glitz_wgl_notify_dummy;
     context->backend.swap_buffers = glitz_wgl_swap_buffers;
@@ -205,6 +206,9 @@ glitz_wgl_context_get (glitz_wgl_screen_info_t          *screen_info,
     context->backend.n_formats = 0;
 
     context->backend.program_map = &screen_info->program_map;
+
+    context->backend.texture_memory = &screen_info->texture_memory;
+    context->backend.damage_policy = &screen_info->damage_policy;
     context->backend.feature_mask = 0;
 
     context->initialized = 0;
@@ -80,6 +80,7 @@ glitz_gl_proc_address_list_t _glitz_wgl_gl_proc_address = {
     (glitz_gl_vertex_pointer_t) glVertexPointer,
     (glitz_gl_tex_coord_pointer_t) glTexCoordPointer,
     (glitz_gl_draw_arrays_t) glDrawArrays,
+    (glitz_gl_draw_elements_t) glDrawElements,
     (glitz_gl_tex_env_f_t) glTexEnvf,
     (glitz_gl_tex_env_fv_t) glTexEnvfv,
     (glitz_gl_tex_gen_i_t) glTexGeni,
@@ -93,6 +94,8 @@ glitz_gl_proc_address_list_t _glitz_wgl_gl_proc_address = {
     (glitz_gl_clear_stencil_t) glClearStencil,
     (glitz_gl_stencil_func_t) glStencilFunc,
     (glitz_gl_stencil_op_t) glStencilOp,
+    (glitz_gl_cull_face_t) glCullFace,
+    (glitz_gl_alpha_func_t) glAlphaFunc,
     (glitz_gl_push_attrib_t) glPushAttrib,
     (glitz_gl_pop_attrib_t) glPopAttrib,
     (glitz_gl_matrix_mode_t) glMatrixMode,
@@ -160,7 +163,20 @@ glitz_gl_proc_address_list_t _glitz_wgl_gl_proc_address = {
     (glitz_gl_delete_renderbuffers_t) 0,
     (glitz_gl_bind_renderbuffer_t) 0,
     (glitz_gl_renderbuffer_storage_t) 0,
-    (glitz_gl_get_renderbuffer_parameter_iv_t) 0
+    (glitz_gl_get_renderbuffer_parameter_iv_t) 0,
+    (glitz_gl_tex_storage_2d_t) 0,
+    (glitz_gl_clear_tex_sub_image_t) 0,
+    (glitz_gl_renderbuffer_storage_multisample_t) 0,
+    (glitz_gl_blit_framebuffer_t) 0,
+    (glitz_gl_multi_draw_elements_t) 0,
+    (glitz_gl_primitive_restart_index_t) 0,
+    (glitz_gl_map_buffer_range_t) 0,
+    (glitz_gl_flush_mapped_buffer_range_t) 0,
+    (glitz_gl_buffer_storage_t) 0,
+    (glitz_gl_fence_sync_t) 0,
+    (glitz_gl_delete_sync_t) 0,
+    (glitz_gl_client_wait_sync_t) 0,
+    (glitz_gl_wait_sync_t) 0
 };
 
 glitz_function_pointer_t
@@ -418,6 +434,11 @@ glitz_wgl_screen_info_get (void)
 
     glitz_program_map_init (&screen_info->program_map);
 
+    glitz_texture_memory_init (&screen_info->texture_memory);
+
+    glitz_damage_policy_init (&screen_info->damage_policy,
+			      GLITZ_DAMAGE_CALL_COST_DEFAULT);
+
     _glitz_wgl_create_root_context (screen_info);
 
     gl_version = glGetString (GL_VERSION);
@@ -117,6 +117,8 @@ struct _glitz_wgl_screen_info_t {
   glitz_gl_float_t                     wgl_version;
   glitz_wgl_static_proc_address_list_t wgl;
   glitz_program_map_t                  program_map;
+  glitz_texture_memory_t               texture_memory;
+  glitz_damage_policy_t                damage_policy;
 };
 
 struct _glitz_wgl_drawable {